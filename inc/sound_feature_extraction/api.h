@@ -72,8 +72,28 @@ typedef enum {
   FEATURE_EXTRACTION_RESULT_ERROR = 1
 } FeatureExtractionResult;
 
+/// @brief The way the buffers are checked for the out of bounds writes.
+typedef enum {
+  /// @brief No checks.
+  GUARD_MODE_OFF = 0,
+  /// @brief The extracted features are made read only with mprotect(),
+  /// which costs several system calls per extraction.
+  GUARD_MODE_PROTECT = 1,
+  /// @brief A canary word after each buffer is checked after each transform.
+  GUARD_MODE_CANARY = 2,
+  /// @brief The same as GUARD_MODE_CANARY, but only every
+  /// get_guard_sampling_period()-th extraction is checked.
+  GUARD_MODE_SAMPLED = 3
+} GuardMode;
+
 typedef struct FeaturesConfiguration FeaturesConfiguration;
 
+typedef struct FeatureStream FeatureStream;
+
+typedef struct ExtractionContext ExtractionContext;
+
+typedef struct FeaturesBatch FeaturesBatch;
+
 /// @brief Allocates and fills the array of transform names.
 void query_transforms_list(char ***names, int *listSize) NOTNULL(1, 2);
 
@@ -103,11 +123,85 @@ FeaturesConfiguration *setup_features_extraction(
     const char *const *features, int featuresCount,
     size_t bufferSize, int samplingRate) NOTNULL(1) WARN_UNUSED_RESULT MALLOC;
 
+/// @brief Does the same as setup_features_extraction(), but reuses
+/// the prepared configurations with the same features, buffer size,
+/// sampling rate, chunk size, threads number and SIMD mode. The features
+/// are compared ignoring the whitespace and the order. The reused
+/// configurations share the transforms and execute them independently, see
+/// clone_features_configuration().
+FeaturesConfiguration *setup_features_extraction_cached(
+    const char *const *features, int featuresCount,
+    size_t bufferSize, int samplingRate) NOTNULL(1) WARN_UNUSED_RESULT MALLOC;
+
+/// @brief Creates the configuration which shares the prepared transforms
+/// with the specified one, but has it's own buffers, so that both can be
+/// used simultaneously.
+FeaturesConfiguration *clone_features_configuration(
+    const FeaturesConfiguration *fc) NOTNULL(1) WARN_UNUSED_RESULT MALLOC;
+
+/// @brief Returns the maximal number of configurations remembered by
+/// setup_features_extraction_cached(). The least recently used ones are
+/// evicted first.
+size_t get_configurations_cache_capacity(void);
+
+void set_configurations_cache_capacity(size_t value);
+
+void clear_configurations_cache(void);
+
+/// @brief Sets the directory where setup_features_extraction_cached() saves
+/// the solved memory allocation plans and looks for them before solving.
+/// NULL disables the plans saving.
+void set_allocation_plans_directory(const char *path);
+
 FeatureExtractionResult extract_sound_features(
     const FeaturesConfiguration *fc, int16_t *buffer,
     char ***featureNames, void ***results, int **resultLengths)
     NOTNULL(1, 2, 3, 4, 5);
 
+/// @brief Returns the size in bytes of each feature's results for the whole
+/// buffer. The features go in the order expected by
+/// extract_sound_features_to().
+void query_feature_output_sizes(const FeaturesConfiguration *fc,
+                                char ***featureNames, size_t **sizes,
+                                int *featuresCount) NOTNULL(1, 2, 3, 4);
+
+void destroy_feature_output_sizes(char **featureNames, size_t *sizes,
+                                  int featuresCount) NOTNULL(1, 2);
+
+/// @brief Does the same as extract_sound_features(), but writes the results
+/// directly into the memory supplied by the caller.
+/// @param outputs The buffers of the sizes returned by
+/// query_feature_output_sizes(), in the same order.
+FeatureExtractionResult extract_sound_features_to(
+    const FeaturesConfiguration *fc, int16_t *buffer, void *const *outputs)
+    NOTNULL(1, 2, 3);
+
+/// @brief Does the same as extract_sound_features_to(), but extracts only
+/// the specified features, skipping the transforms which the other
+/// features need.
+/// @param outputs The buffers of the sizes returned by
+/// query_feature_output_sizes() for the specified features, in the order
+/// of featureNames.
+FeatureExtractionResult extract_selected_sound_features_to(
+    const FeaturesConfiguration *fc, int16_t *buffer,
+    const char *const *featureNames, int featuresCount,
+    void *const *outputs) NOTNULL(1, 2, 3, 5);
+
+/// @brief Creates the independent execution state for the specified
+/// configuration. Different threads may run
+/// extract_sound_features_in_context() on the same configuration
+/// simultaneously, provided that each of them uses it's own context.
+ExtractionContext *create_extraction_context(const FeaturesConfiguration *fc)
+    NOTNULL(1) WARN_UNUSED_RESULT MALLOC;
+
+void destroy_extraction_context(ExtractionContext *ec) NOTNULL(1);
+
+/// @brief Does the same as extract_sound_features_to(), but uses
+/// the specified context instead of the configuration's own one.
+FeatureExtractionResult extract_sound_features_in_context(
+    const FeaturesConfiguration *fc, ExtractionContext *ec,
+    int16_t *buffer, void *const *outputs) NOTNULL(1, 2, 3, 4);
+
 void report_extraction_time(const FeaturesConfiguration *fc,
                             char ***transformNames,
                             float **values, int *length) NOTNULL(1, 2, 3, 4);
@@ -118,11 +212,103 @@ void destroy_extraction_time_report(char **transformNames,
 void report_extraction_graph(const FeaturesConfiguration *fc,
                              const char *fileName) NOTNULL(1, 2);
 
+/// @brief Switches the collection of the per-node statistics, which may be
+/// done at any time. The configurations obtained from the same cached
+/// setup share this switch.
+void set_extraction_statistics(const FeaturesConfiguration *fc,
+                               int enabled) NOTNULL(1);
+
+/// @brief Returns the per-node statistics of the extractions as JSON or,
+/// if chromeTrace is not zero, the nodes of the last extraction in
+/// the Chrome trace event format. The result must be freed with
+/// destroy_extraction_statistics_report().
+char *report_extraction_statistics(const FeaturesConfiguration *fc,
+                                   int chromeTrace) NOTNULL(1);
+
+void destroy_extraction_statistics_report(char *report) NOTNULL(1);
+
+/// @brief Switches the collection of the hardware counters of each
+/// transform, which are included into report_extraction_statistics() and
+/// report_extraction_graph(). If perf_event_open() is not permitted, only
+/// the times are collected.
+void set_extraction_perf_counters(const FeaturesConfiguration *fc,
+                                  int enabled) NOTNULL(1);
+
+void reset_extraction_statistics(FeaturesConfiguration *fc) NOTNULL(1);
+
 void destroy_features_configuration(FeaturesConfiguration *fc) NOTNULL(1);
 
 void free_results(int featuresCount, char **featureNames,
                   void **results, int *resultLengths);
 
+/// @brief Prepares to extract the features from the audio which arrives
+/// piece by piece, e.g. from the microphone.
+/// @param pieceSize The number of samples which are processed at once.
+/// It must be divisible by the step of each window. The less it is, the lower
+/// is the latency and the memory footprint.
+/// @details The results are exactly the same as if the whole stream was
+/// passed to extract_sound_features(). Only the features which split
+/// the signal into windows and then either process each window independently
+/// or look at a bounded number of the neighbour windows (Delta, STMSN) are
+/// supported. The latter output each window after its neighbours arrive.
+FeatureStream *open_feature_stream(
+    const char *const *features, int featuresCount,
+    size_t pieceSize, int samplingRate) NOTNULL(1) WARN_UNUSED_RESULT MALLOC;
+
+/// @brief Appends the samples to the stream, calculating the features of all
+/// the completed pieces.
+FeatureExtractionResult push_samples(FeatureStream *stream,
+                                     const int16_t *samples, size_t count)
+    NOTNULL(1, 2);
+
+/// @brief Returns the features calculated since the previous call.
+/// The results must be freed with free_results().
+/// @param flush If true, the samples which do not fill the whole piece are
+/// processed, too, and the stream is finished: no more samples can be pushed.
+FeatureExtractionResult pull_features(
+    FeatureStream *stream, bool flush,
+    char ***featureNames, void ***results, int **resultLengths)
+    NOTNULL(1, 3, 4, 5);
+
+void close_feature_stream(FeatureStream *stream) NOTNULL(1);
+
+/// @brief Prepares to extract the same features from many clips of
+/// different lengths.
+/// @param bucketSize Each clip is zero padded to the nearest multiple of
+/// this number of samples. The configuration for each padded size is set up
+/// once and then reused by all the clips of that size.
+/// @param threadsCount The number of clips processed simultaneously. If it is
+/// not positive, the number of CPU cores is taken. The best throughput is
+/// usually achieved with set_omp_transforms_max_threads_num(1).
+FeaturesBatch *setup_features_batch(
+    const char *const *features, int featuresCount,
+    size_t bucketSize, int samplingRate, int threadsCount)
+    NOTNULL(1) WARN_UNUSED_RESULT MALLOC;
+
+/// @brief Extracts the features from each clip in parallel. The results
+/// must be freed with free_batch_results().
+/// @details The results are trimmed to the sizes the features would have
+/// without the padding, so the frame wise features match the ones extracted
+/// from each clip alone. The features which reduce the whole clip (e.g.,
+/// Stats, Beat) or look at the neighbour frames (e.g., Delta,
+/// ShortTimeMeanScaleNormalization) still see the zero padding. The clips longer than the extraction chunk
+/// are not trimmed.
+/// @param featureNames The order of the features in results[i] and
+/// resultLengths[i].
+/// @param results The features of each clip, results[clip][feature].
+/// @param resultLengths The sizes in bytes of each of results.
+FeatureExtractionResult extract_sound_features_batch(
+    FeaturesBatch *batch, const int16_t *const *clips,
+    const size_t *clipSizes, int clipsCount,
+    char ***featureNames, void ****results, int ***resultLengths)
+    NOTNULL(1, 2, 3, 5, 6, 7);
+
+void free_batch_results(int featuresCount, int clipsCount,
+                        char **featureNames, void ***results,
+                        int **resultLengths);
+
+void destroy_features_batch(FeaturesBatch *batch) NOTNULL(1);
+
 int get_omp_transforms_max_threads_num(void);
 
 void set_omp_transforms_max_threads_num(int value);
@@ -131,14 +317,44 @@ bool get_use_simd(void);
 
 void set_use_simd(int value);
 
+/// @brief Returns the manually set size of the CPU cache which the buffers
+/// are sliced to fit into. 0 (the default) means that the sizes of
+/// the caches and their sharing are detected and the slices are fit into
+/// the per-core L2.
 size_t get_cpu_cache_size(void);
 
+/// @brief Sets the size of the CPU cache which the buffers are sliced to fit
+/// into. 0 restores the automatic detection.
 void set_cpu_cache_size(size_t value);
 
 size_t get_chunk_size(void);
 
 void set_chunk_size(size_t value);
 
+/// @brief Returns the number of threads which execute the independent
+/// branches of the transform trees simultaneously. The default is 1.
+int get_branch_threads_num(void);
+
+/// @brief Sets the number of threads which execute the independent
+/// branches of the transform trees created afterwards.
+/// @details The values greater than 1 disable the OpenMP threads inside
+/// the transforms (see set_omp_transforms_max_threads_num()), since
+/// the nested parallelism is not enabled. Compare both ways with
+/// "tests/benchmark --threads=1,4 --omp-threads=1,4" for the features used.
+void set_branch_threads_num(int value);
+
+/// @brief Returns the guard mode of the configurations set up afterwards.
+/// The default is GUARD_MODE_CANARY.
+GuardMode get_guard_mode(void);
+
+void set_guard_mode(GuardMode value);
+
+/// @brief Returns the number of extractions per check in GUARD_MODE_SAMPLED.
+/// The default is 64.
+int get_guard_sampling_period(void);
+
+void set_guard_sampling_period(int value);
+
 #if __GNUC__ >= 4
 #pragma GCC visibility pop
 #endif
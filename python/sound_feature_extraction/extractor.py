@@ -78,6 +78,24 @@ class Extractor(object):
         else:
             self.logger.error("Failed to set up features")
             raise SetupFeaturesFailedException()
+        self._query_output_sizes()
+
+    def _query_output_sizes(self):
+        fnames = Library().new("char***")
+        sizes = Library().new("size_t**")
+        count = Library().new("int*")
+        Library().query_feature_output_sizes(self._config, fnames, sizes,
+                                             count)
+        self.output_sizes = [(Library().string(fnames[0][i]).decode(),
+                              sizes[0][i]) for i in range(count[0])]
+        Library().destroy_feature_output_sizes(fnames[0], sizes[0], count[0])
+
+    def _format_name(self, feature):
+        format_name = feature.transforms[-1].output_format
+        if format_name == "":
+            format_name = Explorer().transforms[
+                feature.transforms[-1].name].output_format
+        return format_name
 
     def __del__(self):
         if not self._config:
@@ -112,12 +130,9 @@ class Extractor(object):
             feature = self.features_dict[fname]
             self.logger.debug(feature.name + " yielded %d bytes", length)
             buffer = Library().buffer(results[0][i], length)
-            format_name = feature.transforms[-1].output_format
-            if format_name == "":
-                format_name = Explorer().transforms[
-                    feature.transforms[-1].name].output_format
             ret[fname] = Formatters.parse(numpy.frombuffer(
-                buffer, dtype=numpy.byte, count=length), format_name)
+                buffer, dtype=numpy.byte, count=length),
+                self._format_name(feature))
         ret[Extractor.RAW_KEY_NAME] = results[0]
         Library().free_results(len(self.features), fnames[0],
                                Library().NULL, rlengths[0])
@@ -134,16 +149,49 @@ class Extractor(object):
                                    Library().NULL)
             self.logger.debug("Freed extraction results %s", results["RAW"])
 
-    def calculate(self, buffer):
+    def calculate(self, buffer, features=None):
         """
-        Default is to copy the data from calculate_raw().
+        Calculates the audio features, writing them directly into the numpy
+        arrays owned by the caller. If the names of the features are
+        specified, only those features are calculated.
         """
-        results = self.calculate_raw(buffer)
-        for name in results:
-            if name != Extractor.RAW_KEY_NAME:
-                results[name] = numpy.copy(results[name])
-        self.free_results(results)
-        del(results[Extractor.RAW_KEY_NAME])
+        if not self._config:
+            self.logger.error("Unable to calculate features")
+            return None
+        output_sizes = self.output_sizes
+        if features is not None:
+            sizes = dict(self.output_sizes)
+            unknown = [fname for fname in features if fname not in sizes]
+            if unknown:
+                self.logger.error("Unknown features: %s", ", ".join(unknown))
+                raise ExtractionFailedException()
+            output_sizes = [(fname, sizes[fname]) for fname in features]
+        arrays = [numpy.empty(size, dtype=numpy.byte)
+                  for _, size in output_sizes]
+        outputs = Library().new("void*[]", len(arrays))
+        for i, array in enumerate(arrays):
+            outputs[i] = Library().cast(
+                "void*", array.__array_interface__["data"][0])
+        input_ptr = Library().cast(
+            "int16_t*", buffer.__array_interface__["data"][0])
+        if features is None:
+            status = Library().extract_sound_features_to(
+                self._config, input_ptr, outputs)
+        else:
+            # prevent from garbage collecting fstrs contents
+            fstrs_ref = [Library().new("char[]", fname.encode())
+                         for fname, _ in output_sizes]
+            fstrs = Library().new("char*[]", fstrs_ref)
+            status = Library().extract_selected_sound_features_to(
+                self._config, input_ptr, fstrs, len(fstrs_ref), outputs)
+        self.logger.debug("extract_sound_features_to() returned status %d",
+                          status)
+        if status != 0:
+            raise ExtractionFailedException()
+        results = {}
+        for (fname, _), array in zip(output_sizes, arrays):
+            results[fname] = Formatters.parse(
+                array, self._format_name(self.features_dict[fname]))
         return results
 
     def report(self, file_name):
@@ -57,8 +57,21 @@ typedef enum {
   FEATURE_EXTRACTION_RESULT_ERROR = 1
 } FeatureExtractionResult;
 
+typedef enum {
+  GUARD_MODE_OFF = 0,
+  GUARD_MODE_PROTECT = 1,
+  GUARD_MODE_CANARY = 2,
+  GUARD_MODE_SAMPLED = 3
+} GuardMode;
+
 typedef struct FeaturesConfiguration FeaturesConfiguration;
 
+typedef struct FeatureStream FeatureStream;
+
+typedef struct ExtractionContext ExtractionContext;
+
+typedef struct FeaturesBatch FeaturesBatch;
+
 /// @brief Allocates and fills the array of transform names.
 void query_transforms_list(char ***names, int *listSize);
 
@@ -88,10 +101,48 @@ FeaturesConfiguration *setup_features_extraction(
     const char *const *features, int featuresCount,
     size_t bufferSize, int samplingRate);
 
+FeaturesConfiguration *setup_features_extraction_cached(
+    const char *const *features, int featuresCount,
+    size_t bufferSize, int samplingRate);
+
+FeaturesConfiguration *clone_features_configuration(
+    const FeaturesConfiguration *fc);
+
+size_t get_configurations_cache_capacity(void);
+
+void set_configurations_cache_capacity(size_t value);
+
+void clear_configurations_cache(void);
+
+void set_allocation_plans_directory(const char *path);
+
 FeatureExtractionResult extract_sound_features(
     const FeaturesConfiguration *fc, int16_t *buffer,
     char ***featureNames, void ***results, int **resultLengths);
 
+void query_feature_output_sizes(const FeaturesConfiguration *fc,
+                                char ***featureNames, size_t **sizes,
+                                int *featuresCount);
+
+void destroy_feature_output_sizes(char **featureNames, size_t *sizes,
+                                  int featuresCount);
+
+FeatureExtractionResult extract_sound_features_to(
+    const FeaturesConfiguration *fc, int16_t *buffer, void *const *outputs);
+
+FeatureExtractionResult extract_selected_sound_features_to(
+    const FeaturesConfiguration *fc, int16_t *buffer,
+    const char *const *featureNames, int featuresCount,
+    void *const *outputs);
+
+ExtractionContext *create_extraction_context(const FeaturesConfiguration *fc);
+
+void destroy_extraction_context(ExtractionContext *ec);
+
+FeatureExtractionResult extract_sound_features_in_context(
+    const FeaturesConfiguration *fc, ExtractionContext *ec,
+    int16_t *buffer, void *const *outputs);
+
 void report_extraction_time(const FeaturesConfiguration *fc,
                             char ***transformNames,
                             float **values, int *length);
@@ -102,11 +153,51 @@ void destroy_extraction_time_report(char **transformNames,
 void report_extraction_graph(const FeaturesConfiguration *fc,
                              const char *fileName);
 
+void set_extraction_statistics(const FeaturesConfiguration *fc, int enabled);
+
+char *report_extraction_statistics(const FeaturesConfiguration *fc,
+                                   int chromeTrace);
+
+void destroy_extraction_statistics_report(char *report);
+
+void set_extraction_perf_counters(const FeaturesConfiguration *fc,
+                                  int enabled);
+
+void reset_extraction_statistics(FeaturesConfiguration *fc);
+
 void destroy_features_configuration(FeaturesConfiguration *fc);
 
 void free_results(int featuresCount, char **featureNames,
                   void **results, int *resultLengths);
 
+FeatureStream *open_feature_stream(
+    const char *const *features, int featuresCount,
+    size_t pieceSize, int samplingRate);
+
+FeatureExtractionResult push_samples(FeatureStream *stream,
+                                     const int16_t *samples, size_t count);
+
+FeatureExtractionResult pull_features(
+    FeatureStream *stream, bool flush,
+    char ***featureNames, void ***results, int **resultLengths);
+
+void close_feature_stream(FeatureStream *stream);
+
+FeaturesBatch *setup_features_batch(
+    const char *const *features, int featuresCount,
+    size_t bucketSize, int samplingRate, int threadsCount);
+
+FeatureExtractionResult extract_sound_features_batch(
+    FeaturesBatch *batch, const int16_t *const *clips,
+    const size_t *clipSizes, int clipsCount,
+    char ***featureNames, void ****results, int ***resultLengths);
+
+void free_batch_results(int featuresCount, int clipsCount,
+                        char **featureNames, void ***results,
+                        int **resultLengths);
+
+void destroy_features_batch(FeaturesBatch *batch);
+
 int get_omp_transforms_max_threads_num(void);
 
 void set_omp_transforms_max_threads_num(int value);
@@ -121,7 +212,19 @@ void set_cpu_cache_size(size_t value);
 
 size_t get_chunk_size(void);
 
-void set_chunk_size(size_t value);""")
+void set_chunk_size(size_t value);
+
+int get_branch_threads_num(void);
+
+void set_branch_threads_num(int value);
+
+GuardMode get_guard_mode(void);
+
+void set_guard_mode(GuardMode value);
+
+int get_guard_sampling_period(void);
+
+void set_guard_sampling_period(int value);""")
         return Library._ffi
 
     def __getattr__(self, item):
@@ -29,7 +29,8 @@ under the License.
 import logging
 import numpy
 import unittest
-from sound_feature_extraction.extractor import Extractor
+from sound_feature_extraction.extractor import Extractor, \
+    ExtractionFailedException
 from sound_feature_extraction.feature import Feature
 from sound_feature_extraction.transform import Transform
 
@@ -53,6 +54,8 @@ class Test(unittest.TestCase):
         buffer *= 1000
         results = extr.calculate(buffer)
         print("Calculated results: %s" % results["MFCC"])
+        self.assertRaises(ExtractionFailedException, extr.calculate, buffer,
+                          ["MFCC", "Unknown"])
 
 if __name__ == "__main__":
     # import sys;sys.argv = ['', 'Test.testExtractor']
@@ -0,0 +1,251 @@
+/*! @file heuristic_allocator.cc
+ *  @brief Buffers allocator which picks the traversal order heuristically.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/allocators/heuristic_allocator.h"
+#include <algorithm>
+
+namespace sound_feature_extraction {
+namespace memory_allocation {
+
+HeuristicAllocator::HeuristicAllocator() noexcept
+    : time_budget_(50),
+      lower_bound_(0),
+      iterations_(0) {
+}
+
+std::chrono::milliseconds HeuristicAllocator::time_budget() const noexcept {
+  return time_budget_;
+}
+
+void HeuristicAllocator::set_time_budget(
+    const std::chrono::milliseconds& value) noexcept {
+  time_budget_ = value;
+}
+
+size_t HeuristicAllocator::lower_bound() const noexcept {
+  return lower_bound_;
+}
+
+int HeuristicAllocator::iterations() const noexcept {
+  return iterations_;
+}
+
+size_t HeuristicAllocator::Solve(Node* root) const noexcept {
+  auto deadline = std::chrono::steady_clock::now() + time_budget_;
+  Problem problem;
+  Flatten(root, -1, &problem);
+  lower_bound_ = CalculateLowerBound(problem);
+  Solution best;
+  Evaluate(problem, &best);
+  // Liu's order is optimal for the peak of the live buffers, but not
+  // necessarily for their placement, so keep the original order if it is
+  // better
+  auto original = problem.Children;
+  OrderChildren(&problem);
+  {
+    Solution ordered;
+    Evaluate(problem, &ordered);
+    if (ordered.Peak <= best.Peak) {
+      best = std::move(ordered);
+    } else {
+      problem.Children = original;
+    }
+  }
+  DBG("Initial solution: %zu, lower bound: %zu", best.Peak, lower_bound_);
+  // Local search: swap the adjacent siblings while it helps
+  int iterations = 0;
+  bool improved = true, expired = false;
+  while (improved && !expired && best.Peak > lower_bound_) {
+    improved = false;
+    for (auto& children : problem.Children) {
+      for (int i = 0; i < static_cast<int>(children.size()) - 1; i++) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+          expired = true;
+          break;
+        }
+        iterations++;
+        std::swap(children[i], children[i + 1]);
+        Solution candidate;
+        Evaluate(problem, &candidate);
+        if (candidate.Peak < best.Peak) {
+          best = std::move(candidate);
+          improved = true;
+        } else {
+          std::swap(children[i], children[i + 1]);
+        }
+      }
+      if (expired) {
+        break;
+      }
+    }
+  }
+  iterations_ = iterations;
+  INF("Solved %zu nodes in %d iterations: %zu bytes, the lower bound is "
+      "%zu bytes", problem.Nodes.size(), iterations, best.Peak, lower_bound_);
+  for (size_t i = 0; i < best.Order.size(); i++) {
+    auto node = problem.Nodes[best.Order[i]];
+    node->Address = best.Addresses[best.Order[i]];
+    node->Next = i < best.Order.size() - 1?
+        problem.Nodes[best.Order[i + 1]] : nullptr;
+  }
+  return best.Peak;
+}
+
+void HeuristicAllocator::Flatten(Node* node, int parent,
+                                 Problem* problem) noexcept {
+  int index = problem->Nodes.size();
+  problem->Nodes.push_back(node);
+  problem->Parents.push_back(parent);
+  problem->Children.push_back({});
+  if (parent >= 0) {
+    problem->Children[parent].push_back(index);
+  }
+  for (auto& child : node->Children) {
+    Flatten(&child, index, problem);
+  }
+}
+
+void HeuristicAllocator::OrderChildren(Problem* problem) noexcept {
+  // peak is the estimated maximal memory used while executing the subtree,
+  // residual is the memory left after, that is, the sizes of the leaves
+  size_t count = problem->Nodes.size();
+  std::vector<size_t> peak(count), residual(count);
+  // Flatten() puts the children after their parents
+  for (int i = count - 1; i >= 0; i--) {
+    auto& children = problem->Children[i];
+    size_t size = problem->Nodes[i]->Size;
+    if (children.empty()) {
+      peak[i] = residual[i] = size;
+      continue;
+    }
+    std::sort(children.begin(), children.end(), [&](int a, int b) {
+      return peak[a] - residual[a] > peak[b] - residual[b];
+    });
+    size_t sum = 0;
+    peak[i] = size;
+    residual[i] = 0;
+    for (int child : children) {
+      peak[i] = std::max(peak[i], size + sum + peak[child]);
+      sum += residual[child];
+    }
+    residual[i] = sum;
+  }
+}
+
+size_t HeuristicAllocator::CalculateLowerBound(
+    const Problem& problem) noexcept {
+  // Any node is alive together with each of its children. The last node is
+  // a leaf and all the leaves are alive at that moment, as well as
+  // the parent of the last one
+  size_t pair = 0, leaves = 0, parent = 0;
+  bool has_parent = false;
+  for (size_t i = 0; i < problem.Nodes.size(); i++) {
+    size_t size = problem.Nodes[i]->Size;
+    if (problem.Children[i].empty()) {
+      leaves += size;
+      if (problem.Parents[i] >= 0) {
+        size_t psize = problem.Nodes[problem.Parents[i]]->Size;
+        parent = has_parent? std::min(parent, psize) : psize;
+        has_parent = true;
+      }
+    }
+    for (int child : problem.Children[i]) {
+      pair = std::max(pair, size + problem.Nodes[child]->Size);
+    }
+  }
+  return std::max(pair, leaves + parent);
+}
+
+void HeuristicAllocator::Evaluate(const Problem& problem,
+                                  Solution* solution) noexcept {
+  size_t count = problem.Nodes.size();
+  solution->Order.clear();
+  solution->Order.reserve(count);
+  Traverse(problem, 0, &solution->Order);
+  // Calculate the lifetimes: a leaf lives till the end, any other node
+  // lives till its last child is executed
+  std::vector<size_t> start(count), finish(count);
+  for (size_t i = 0; i < count; i++) {
+    start[solution->Order[i]] = i;
+  }
+  for (size_t i = 0; i < count; i++) {
+    finish[i] = problem.Children[i].empty()?
+        count - 1 : start[problem.Children[i].back()];
+  }
+  // Place the largest buffers first, each at the lowest free address
+  std::vector<int> blocks(count);
+  for (size_t i = 0; i < count; i++) {
+    blocks[i] = i;
+  }
+  std::sort(blocks.begin(), blocks.end(), [&](int a, int b) {
+    auto sa = problem.Nodes[a]->Size, sb = problem.Nodes[b]->Size;
+    return sa > sb || (sa == sb && start[a] < start[b]);
+  });
+  solution->Addresses.assign(count, 0);
+  solution->Peak = 0;
+  std::vector<std::pair<size_t, size_t>> busy;
+  for (size_t i = 0; i < count; i++) {
+    int block = blocks[i];
+    size_t size = problem.Nodes[block]->Size;
+    if (size == 0) {
+      continue;
+    }
+    busy.clear();
+    for (size_t j = 0; j < i; j++) {
+      int other = blocks[j];
+      if (start[other] <= finish[block] && start[block] <= finish[other]) {
+        busy.emplace_back(solution->Addresses[other],
+                          solution->Addresses[other] +
+                          problem.Nodes[other]->Size);
+      }
+    }
+    std::sort(busy.begin(), busy.end());
+    size_t address = 0;
+    for (auto& segment : busy) {
+      if (segment.first >= address + size) {
+        break;
+      }
+      address = std::max(address, segment.second);
+    }
+    solution->Addresses[block] = address;
+    solution->Peak = std::max(solution->Peak, address + size);
+  }
+}
+
+void HeuristicAllocator::Traverse(const Problem& problem, int node,
+                                  std::vector<int>* order) noexcept {
+  order->push_back(node);
+  for (int child : problem.Children[node]) {
+    Traverse(problem, child, order);
+  }
+}
+
+}  // namespace memory_allocation
+}  // namespace sound_feature_extraction
@@ -0,0 +1,98 @@
+/*! @file heuristic_allocator.h
+ *  @brief Buffers allocator which picks the traversal order heuristically.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_ALLOCATORS_HEURISTIC_ALLOCATOR_H_
+#define SRC_ALLOCATORS_HEURISTIC_ALLOCATOR_H_
+
+#include <chrono>
+#include <vector>
+#include "src/allocators/buffers_allocator.h"
+
+namespace sound_feature_extraction {
+namespace memory_allocation {
+
+/// @brief Unlike SlidingBlocksAllocator, which tries every traversal order
+/// of the tree, this allocator orders the children of each node by
+/// the difference of the subtree's peak and residual memory (Liu's rule)
+/// and then improves the order by swapping the adjacent siblings until
+/// the time budget is exhausted. The buffers of the chosen order are placed
+/// greedily by size, each at the lowest address free during its lifetime.
+class HeuristicAllocator : public BuffersAllocator {
+ public:
+  HeuristicAllocator() noexcept;
+
+  virtual size_t Solve(Node* root) const noexcept override;
+
+  /// @brief The maximal time spent on improving the initial order.
+  std::chrono::milliseconds time_budget() const noexcept;
+  void set_time_budget(const std::chrono::milliseconds& value) noexcept;
+
+  /// @brief Returns the size of the buffers which are alive simultaneously
+  /// in any traversal order of the last solved tree. No solution can take
+  /// less memory.
+  size_t lower_bound() const noexcept;
+
+  /// @brief Returns the number of the orders which the local search tried
+  /// while solving the last tree. It is 0 if the time budget is 0.
+  int iterations() const noexcept;
+
+ private:
+  struct Problem {
+    std::vector<Node*> Nodes;
+    std::vector<int> Parents;
+    /// @brief The children of each node in the current traversal order.
+    std::vector<std::vector<int>> Children;
+  };
+
+  struct Solution {
+    Solution() : Peak(0) {
+    }
+
+    /// @brief The indices of the nodes in the execution order.
+    std::vector<int> Order;
+    std::vector<size_t> Addresses;
+    size_t Peak;
+  };
+
+  static void Flatten(Node* node, int parent, Problem* problem) noexcept;
+  static void OrderChildren(Problem* problem) noexcept;
+  static size_t CalculateLowerBound(const Problem& problem) noexcept;
+  static void Evaluate(const Problem& problem, Solution* solution) noexcept;
+  static void Traverse(const Problem& problem, int node,
+                       std::vector<int>* order) noexcept;
+
+  std::chrono::milliseconds time_budget_;
+  mutable size_t lower_bound_;
+  mutable int iterations_;
+};
+
+}  // namespace memory_allocation
+}  // namespace sound_feature_extraction
+#endif  // SRC_ALLOCATORS_HEURISTIC_ALLOCATOR_H_
@@ -32,10 +32,19 @@
 #include <sound_feature_extraction/api.h>
 #undef NOTNULL
 #include <cassert>
+#include <cctype>
 #include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <fftf/api.h>
 #include "src/features_parser.h"
 #include "src/make_unique.h"
+#include "src/parameterizable.h"
 #include "src/safe_omp.h"
 #include "src/simd_aware.h"
 #include "src/transform_tree.h"
@@ -47,25 +56,137 @@ using sound_feature_extraction::ChainNameAlreadyExistsException;
 using sound_feature_extraction::TransformNotRegisteredException;
 using sound_feature_extraction::ChainAlreadyExistsException;
 using sound_feature_extraction::IncompatibleTransformFormatException;
+using sound_feature_extraction::TransformIsNotStreamableException;
+using sound_feature_extraction::FeatureIsNotSplitException;
+using sound_feature_extraction::InvalidStreamedPieceSizeException;
 using sound_feature_extraction::RawFeaturesMap;
 using sound_feature_extraction::features::ParseFeaturesException;
 using sound_feature_extraction::TransformTree;
+using sound_feature_extraction::ExecutionContext;
 using sound_feature_extraction::formats::ArrayFormat16;
 using sound_feature_extraction::BuffersBase;
 using sound_feature_extraction::Buffers;
 using sound_feature_extraction::SimdAware;
+using sound_feature_extraction::Parameterizable;
 
 extern "C" {
 
 struct FeaturesConfiguration {
-  std::unique_ptr<TransformTree> Tree;
+  /// @brief The prepared tree, which may be shared with the other
+  /// configurations.
+  std::shared_ptr<TransformTree> Tree;
+  /// @brief The context to execute Tree with. If it is null, the tree's own
+  /// context is used.
+  std::unique_ptr<ExecutionContext> Context;
   size_t InputSize;
   int Chunks;
 };
 
+struct ExtractionContext {
+  const FeaturesConfiguration* Config;
+  std::unique_ptr<ExecutionContext> Context;
+};
+
+struct FeatureStream {
+  std::unique_ptr<TransformTree> Tree;
+  /// @brief The samples which do not fill the whole piece yet.
+  std::vector<int16_t> Piece;
+  size_t PieceFilled;
+  /// @brief The feature names in the order of pull_features() results.
+  std::vector<std::string> Names;
+  /// @brief The results which were not pulled yet.
+  std::unordered_map<std::string, std::vector<char>> Pending;
+  bool Flushed;
+};
+
+/// @brief The configuration for the clips of one padded size.
+struct BatchBucket {
+  BatchBucket() : LastUse(0), Evicted(false) {
+  }
+
+  /// @brief Guards the setup of Config, which runs outside of
+  /// FeaturesBatch::BucketsMutex.
+  std::once_flag Setup;
+  std::unique_ptr<FeaturesConfiguration> Config;
+  /// @brief The value of FeaturesBatch::Uses when the bucket was requested
+  /// the last time.
+  size_t LastUse;
+  /// @brief Indicates whether the bucket was removed from
+  /// FeaturesBatch::Buckets, so that the workers drop their contexts.
+  std::atomic_bool Evicted;
+};
+
+/// @brief The execution context of a worker together with the bucket it
+/// belongs to, which is kept alive while the context exists.
+struct BatchContext {
+  std::shared_ptr<BatchBucket> Bucket;
+  std::unique_ptr<ExecutionContext> Context;
+  /// @brief The size of the last clip and its unpadded feature sizes.
+  size_t ClipSize = 0;
+  std::unordered_map<std::string, size_t> ClipSizes;
+};
+
+struct FeaturesBatch {
+  FeaturesBatch() : Uses(0), MaxBuckets(16) {
+  }
+
+  std::vector<std::string> Features;
+  /// @brief The sorted feature names, in the order of the results.
+  std::vector<std::string> Names;
+  size_t BucketSize;
+  int SamplingRate;
+  int ThreadsCount;
+  /// @brief The prepared configurations, by the padded clip size.
+  std::unordered_map<size_t, std::shared_ptr<BatchBucket>> Buckets;
+  std::mutex BucketsMutex;
+  /// @brief The number of the bucket requests, which orders the buckets
+  /// by the last use.
+  size_t Uses;
+  /// @brief The least recently used buckets above this number are evicted.
+  size_t MaxBuckets;
+  /// @brief The execution contexts of each worker, by the padded clip size.
+  std::vector<std::unordered_map<size_t, BatchContext>> Contexts;
+  /// @brief Serializes extract_sound_features_batch(), because the workers'
+  /// contexts are reused between the calls.
+  std::mutex ExtractMutex;
+};
+
+/// @brief The LRU cache of the prepared transform trees.
+struct ConfigurationsCache {
+  ConfigurationsCache() : Capacity(16) {
+  }
+
+  struct Item {
+    std::shared_ptr<TransformTree> Tree;
+    size_t InputSize;
+    int Chunks;
+    /// @brief The position of the key in Order.
+    std::list<std::string>::iterator Position;
+  };
+
+  std::mutex Mutex;
+  size_t Capacity;
+  /// @brief The keys of Items, the most recently used first.
+  std::list<std::string> Order;
+  std::unordered_map<std::string, Item> Items;
+  /// @brief Where to keep the solved allocation plans. If it is empty,
+  /// the plans are not saved.
+  std::string PlansDirectory;
+};
+
+static ConfigurationsCache configurations_cache;
+
 /// @brief One second of standard 2-channel 44100Hz audio
 size_t chunk_size = 60 * 44100 * 2;
 
+/// @brief The number of threads which execute the independent branches of
+/// each transform tree.
+int branch_threads_num = 1;
+
+GuardMode guard_mode = GUARD_MODE_CANARY;
+
+int guard_sampling_period = 64;
+
 #define BLAME(x) EINA_LOG_ERR("Error: " #x " is null (function %s, " \
                               "line %i)\n", \
                               __FUNCTION__, __LINE__)
@@ -251,12 +372,11 @@ void destroy_transform_details(char *description,
   delete[] parameterDefaultValues;
 }
 
-FeaturesConfiguration *setup_features_extraction(
-    const char *const *features, int featuresCount,
-    size_t bufferSize, int samplingRate) {
-  CHECK_NULL_RET(features, nullptr);
-  EINA_LOG_DBG("featuresCount=%d, bufferSize=%zu, samplingRate=%i",
-      featuresCount, bufferSize, samplingRate);
+/// @param planFile The file to load the allocation plan from or to save
+/// the solved plan to. If it is empty, the plan is always solved.
+static std::unique_ptr<TransformTree> build_transform_tree(
+    const char *const *features, int featuresCount, size_t size,
+    int samplingRate, bool streaming, const std::string& planFile = "") {
   if (featuresCount < 0) {
     EINA_LOG_ERR("Error: featuresCount is negative (%i)\n", featuresCount);
     return nullptr;
@@ -288,19 +408,16 @@ FeaturesConfiguration *setup_features_extraction(
     return nullptr;
   }
 
-  int chunks = 1;
-  while (bufferSize / chunks > chunk_size) {
-    chunks++;
-  }
-  auto format = std::make_shared<ArrayFormat16>(
-      std::min(bufferSize, bufferSize / chunks), samplingRate);
-  auto config = new FeaturesConfiguration();
-  config->Tree = std::make_unique<TransformTree>(format);
-  config->InputSize = bufferSize;
-  config->Chunks = chunks;
+  auto format = std::make_shared<ArrayFormat16>(size, samplingRate);
+  auto tree = std::make_unique<TransformTree>(format);
+  tree->set_streaming(streaming);
+  tree->set_branch_threads_number(branch_threads_num);
+  tree->set_guard_mode(
+      static_cast<sound_feature_extraction::GuardMode>(guard_mode));
+  tree->set_guard_sampling_period(guard_sampling_period);
   for (auto& featpair : featmap) {
     try {
-      config->Tree->AddFeature(featpair.first, featpair.second);
+      tree->AddFeature(featpair.first, featpair.second);
     }
     catch(const ChainNameAlreadyExistsException& cnaee) {
       EINA_LOG_ERR("Failed to construct the transform tree. %s\n",
@@ -322,70 +439,864 @@ FeaturesConfiguration *setup_features_extraction(
               itfe.what());
       return nullptr;
     }
+    catch(const TransformIsNotStreamableException& tinse) {
+      EINA_LOG_ERR("Failed to construct the transform tree. %s\n",
+              tinse.what());
+      return nullptr;
+    }
+    catch(const InvalidStreamedPieceSizeException& ispse) {
+      EINA_LOG_ERR("Failed to construct the transform tree. %s\n",
+              ispse.what());
+      return nullptr;
+    }
+  }
+  bool plan_loaded = !planFile.empty() && tree->LoadAllocationPlan(planFile);
+  try {
+    tree->PrepareForExecution();
+  }
+  catch(const FeatureIsNotSplitException& finse) {
+    EINA_LOG_ERR("Failed to prepare the transform tree. %s\n",
+            finse.what());
+    return nullptr;
+  }
+  if (!planFile.empty() && !plan_loaded) {
+    try {
+      tree->SaveAllocationPlan(planFile);
+    }
+    catch(const std::exception& ex) {
+      EINA_LOG_WARN("Failed to save the allocation plan to %s. %s\n",
+                    planFile.c_str(), ex.what());
+    }
   }
-  config->Tree->PrepareForExecution();
 #ifdef DEBUG
-  config->Tree->set_validate_after_each_transform(true);
+  tree->set_validate_after_each_transform(true);
 #endif
+  return tree;
+}
+
+static FeaturesConfiguration *setup_configuration(
+    const char *const *features, int featuresCount,
+    size_t bufferSize, int samplingRate, const std::string& planFile) {
+  int chunks = 1;
+  while (bufferSize / chunks > chunk_size) {
+    chunks++;
+  }
+  auto tree = build_transform_tree(
+      features, featuresCount, std::min(bufferSize, bufferSize / chunks),
+      samplingRate, false, planFile);
+  if (tree == nullptr) {
+    return nullptr;
+  }
+  auto config = new FeaturesConfiguration();
+  config->Tree = std::move(tree);
+  config->InputSize = bufferSize;
+  config->Chunks = chunks;
   return config;
 }
 
-FeatureExtractionResult extract_sound_features(
-    const FeaturesConfiguration *fc, int16_t *buffer,
-    char ***featureNames, void ***results, int **resultLengths) {
-  CHECK_NULL_RET(fc, FEATURE_EXTRACTION_RESULT_ERROR);
-  CHECK_NULL_RET(buffer, FEATURE_EXTRACTION_RESULT_ERROR);
-  CHECK_NULL_RET(results, FEATURE_EXTRACTION_RESULT_ERROR);
+FeaturesConfiguration *setup_features_extraction(
+    const char *const *features, int featuresCount,
+    size_t bufferSize, int samplingRate) {
+  CHECK_NULL_RET(features, nullptr);
+  EINA_LOG_DBG("featuresCount=%d, bufferSize=%zu, samplingRate=%i",
+      featuresCount, bufferSize, samplingRate);
+  return setup_configuration(features, featuresCount, bufferSize,
+                             samplingRate, "");
+}
+
+/// @brief Returns the 64-bit FNV-1a digest of the configuration key.
+/// @details Unlike std::hash, it is the same in every build and run, so
+/// the allocation plans saved by one process are found by the others.
+static uint64_t configuration_digest(const std::string& key) noexcept {
+  uint64_t digest = 14695981039346656037ULL;
+  for (char c : key) {
+    digest ^= static_cast<unsigned char>(c);
+    digest *= 1099511628211ULL;
+  }
+  return digest;
+}
 
+/// @brief Builds the key of configurations_cache from the parsed features:
+/// the features and the parameters of each transform are sorted by name and
+/// the whitespace runs inside the values are collapsed to single spaces, so
+/// that the value lists such as "bands=2000 3000" stay distinct.
+/// @return An empty string if the features are invalid.
+static std::string configuration_key(
+    const char *const *features, int featuresCount,
+    size_t bufferSize, int samplingRate) {
+  if (featuresCount < 0 || featuresCount > MAX_FEATURES_COUNT) {
+    return "";
+  }
+  std::vector<std::string> lines;
+  for (int i = 0; i < featuresCount; i++) {
+    if (features[i] == nullptr) {
+      return "";
+    }
+    lines.push_back(features[i]);
+  }
+  auto collapse = [](const std::string& value) {
+    std::string res;
+    for (char c : value) {
+      if (!isspace(static_cast<unsigned char>(c))) {
+        res += c;
+      } else if (!res.empty() && res.back() != ' ') {
+        res += ' ';
+      }
+    }
+    if (!res.empty() && res.back() == ' ') {
+      res.pop_back();
+    }
+    return res;
+  };
+  std::map<std::string, std::string> chains;
+  try {
+    for (auto& feature : sound_feature_extraction::features::Parse(lines)) {
+      std::string chain;
+      for (auto& transform : feature.second) {
+        auto parameters = Parameterizable::Parse(transform.second);
+        std::map<std::string, std::string> sorted;
+        for (auto& parameter : parameters) {
+          sorted[parameter.first] = collapse(parameter.second);
+        }
+        chain += transform.first + "(";
+        for (auto& parameter : sorted) {
+          chain += parameter.first + "=" + parameter.second + ",";
+        }
+        chain += ")";
+      }
+      chains[feature.first] = chain;
+    }
+  }
+  catch(const std::exception&) {
+    return "";
+  }
+  std::string key;
+  for (auto& chain : chains) {
+    key += chain.first + " " + chain.second + "\n";
+  }
+  key += std::to_string(bufferSize) + " " + std::to_string(samplingRate) +
+      " " + std::to_string(chunk_size) +
+      " " + std::to_string(get_omp_transforms_max_threads_num()) +
+      " " + std::to_string(branch_threads_num) +
+      " " + std::to_string(guard_mode) +
+      " " + std::to_string(guard_sampling_period) +
+      " " + std::to_string(get_cpu_cache_size()) +
+      (get_use_simd()? " simd" : " nosimd");
+  return key;
+}
+
+/// @brief Creates the configuration which executes the existing tree using
+/// a separate context.
+static FeaturesConfiguration *share_configuration(
+    const std::shared_ptr<TransformTree>& tree, size_t inputSize,
+    int chunks) {
+  auto config = new FeaturesConfiguration();
+  try {
+    config->Context = tree->CreateExecutionContext();
+  }
+  catch(const std::exception& ex) {
+    EINA_LOG_ERR("Caught an exception with message \"%s\".\n", ex.what());
+    delete config;
+    return nullptr;
+  }
+  config->Tree = tree;
+  config->InputSize = inputSize;
+  config->Chunks = chunks;
+  return config;
+}
+
+FeaturesConfiguration *setup_features_extraction_cached(
+    const char *const *features, int featuresCount,
+    size_t bufferSize, int samplingRate) {
+  CHECK_NULL_RET(features, nullptr);
+  auto key = configuration_key(features, featuresCount, bufferSize,
+                               samplingRate);
+  if (key.empty()) {
+    // Let setup_features_extraction() report the error
+    return setup_features_extraction(features, featuresCount, bufferSize,
+                                     samplingRate);
+  }
+  auto& cache = configurations_cache;
+  std::string plan_file;
+  {
+    std::lock_guard<std::mutex> lock(cache.Mutex);
+    auto it = cache.Items.find(key);
+    if (it != cache.Items.end()) {
+      cache.Order.splice(cache.Order.begin(), cache.Order,
+                         it->second.Position);
+      EINA_LOG_DBG("Found the configuration in the cache");
+      return share_configuration(it->second.Tree, it->second.InputSize,
+                                 it->second.Chunks);
+    }
+    if (!cache.PlansDirectory.empty()) {
+      char hash[32];
+      snprintf(hash, sizeof(hash), "%016llx",
+               static_cast<unsigned long long>(configuration_digest(key)));
+      plan_file = cache.PlansDirectory + "/" + hash + ".plan";
+    }
+  }
+  auto config = setup_configuration(features, featuresCount, bufferSize,
+                                    samplingRate, plan_file);
+  if (config == nullptr) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(cache.Mutex);
+  if (cache.Capacity == 0 || cache.Items.find(key) != cache.Items.end()) {
+    return config;
+  }
+  cache.Order.push_front(key);
+  auto& item = cache.Items[key];
+  item.Tree = config->Tree;
+  item.InputSize = config->InputSize;
+  item.Chunks = config->Chunks;
+  item.Position = cache.Order.begin();
+  while (cache.Items.size() > cache.Capacity) {
+    cache.Items.erase(cache.Order.back());
+    cache.Order.pop_back();
+  }
+  return config;
+}
+
+FeaturesConfiguration *clone_features_configuration(
+    const FeaturesConfiguration *fc) {
+  CHECK_NULL_RET(fc, nullptr);
+  return share_configuration(fc->Tree, fc->InputSize, fc->Chunks);
+}
+
+size_t get_configurations_cache_capacity(void) {
+  std::lock_guard<std::mutex> lock(configurations_cache.Mutex);
+  return configurations_cache.Capacity;
+}
+
+void set_configurations_cache_capacity(size_t value) {
+  auto& cache = configurations_cache;
+  std::lock_guard<std::mutex> lock(cache.Mutex);
+  cache.Capacity = value;
+  while (cache.Items.size() > cache.Capacity) {
+    cache.Items.erase(cache.Order.back());
+    cache.Order.pop_back();
+  }
+}
+
+void clear_configurations_cache(void) {
+  std::lock_guard<std::mutex> lock(configurations_cache.Mutex);
+  configurations_cache.Items.clear();
+  configurations_cache.Order.clear();
+}
+
+void set_allocation_plans_directory(const char *path) {
+  std::lock_guard<std::mutex> lock(configurations_cache.Mutex);
+  configurations_cache.PlansDirectory = path != nullptr? path : "";
+}
+
+void query_feature_output_sizes(const FeaturesConfiguration *fc,
+                                char ***featureNames, size_t **sizes,
+                                int *featuresCount) {
+  CHECK_NULL(fc);
+  CHECK_NULL(featureNames);
+  CHECK_NULL(sizes);
+  CHECK_NULL(featuresCount);
+
+  auto names = fc->Tree->FeatureNames();
+  auto feature_sizes = fc->Tree->FeatureSizes();
+  *featuresCount = names.size();
+  *featureNames = new char*[names.size()];
+  *sizes = new size_t[names.size()];
+  for (size_t i = 0; i < names.size(); i++) {
+    copy_string(names[i], *featureNames + i);
+    (*sizes)[i] = feature_sizes[names[i]] * fc->Chunks;
+  }
+}
+
+void destroy_feature_output_sizes(char **featureNames, size_t *sizes,
+                                  int featuresCount) {
+  CHECK_NULL(featureNames);
+  CHECK_NULL(sizes);
+
+  for (int i = 0; i < featuresCount; i++) {
+    delete[] featureNames[i];
+  }
+  delete[] featureNames;
+  delete[] sizes;
+}
+
+/// @brief Copies the buffers into the continuous memory block, skipping
+/// the alignment gaps.
+static void copy_buffers(const Buffers& buffers, char *dest) {
+  if (buffers.Count() == 0) {
+    return;
+  }
+  size_t size_each = buffers.Format()->UnalignedSizeInBytes();
+  assert(size_each > 0);
+  if (size_each == buffers.Format()->SizeInBytes()) {
+    memcpy(dest, buffers.Data(), size_each * buffers.Count());
+    return;
+  }
+  for (size_t k = 0; k < buffers.Count(); k++) {
+    memcpy(dest + k * size_each, buffers[k], size_each);
+  }
+}
+
+/// @brief Executes the tree on each chunk of the buffer using
+/// the specified context or the tree's own one if it is nullptr.
+/// @param selected The features to extract. If it is null, all the features
+/// are extracted.
+static FeatureExtractionResult extract_chunks(
+    const FeaturesConfiguration *fc, ExecutionContext *context,
+    int16_t *buffer, void *const *outputs,
+    const std::vector<std::string> *selected = nullptr) {
   fftf_set_openmp_num_threads(get_omp_transforms_max_threads_num());
   EINA_LOG_DBG("OpenMP threads number is %d, SIMD is %s, FFTF backend is %d\n",
                get_omp_transforms_max_threads_num(),
                get_use_simd()? "enabled" : "disabled",
                fftf_current_backend());
-  std::unordered_map<std::string, std::shared_ptr<Buffers>> retmap;
+  auto names = selected == nullptr? fc->Tree->FeatureNames() : *selected;
+  auto sizes = fc->Tree->FeatureSizes();
   size_t step = fc->InputSize / fc->Chunks;
   size_t length = step * fc->Chunks;
-  for (size_t i = 0; i < length; i += step) {
+  for (size_t i = 0, chunk = 0; i < length; i += step, chunk++) {
     EINA_LOG_INFO("Evaluating [%d%%, %d%%]...",
                   static_cast<int>(i * 100 / length),
                   static_cast<int>((i + step) * 100 / length));
+    std::unordered_map<std::string, std::shared_ptr<Buffers>> retmap;
     try {
-      retmap = fc->Tree->Execute(buffer + i);
+      if (selected == nullptr) {
+        retmap = context == nullptr? fc->Tree->Execute(buffer + i)
+            : fc->Tree->Execute(context, buffer + i);
+      } else {
+        retmap = context == nullptr? fc->Tree->Execute(buffer + i, names)
+            : fc->Tree->Execute(context, buffer + i, names);
+      }
     }
     catch(const std::exception& ex) {
       EINA_LOG_ERR("Caught an exception with message \"%s\".\n", ex.what());
       return FEATURE_EXTRACTION_RESULT_ERROR;
     }
-    if (i == 0) {
-      *featureNames = new char*[retmap.size()];
-      *results = new void*[retmap.size()];
-      *resultLengths = new int[retmap.size()];
+    for (size_t j = 0; j < names.size(); j++) {
+      CHECK_NULL_RET(outputs[j], FEATURE_EXTRACTION_RESULT_ERROR);
+      copy_buffers(*retmap[names[j]],
+                   reinterpret_cast<char *>(outputs[j]) +
+                       chunk * sizes[names[j]]);
     }
+  }
+  return FEATURE_EXTRACTION_RESULT_OK;
+}
+
+FeatureExtractionResult extract_sound_features_to(
+    const FeaturesConfiguration *fc, int16_t *buffer, void *const *outputs) {
+  CHECK_NULL_RET(fc, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(buffer, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(outputs, FEATURE_EXTRACTION_RESULT_ERROR);
+  return extract_chunks(fc, fc->Context.get(), buffer, outputs);
+}
+
+FeatureExtractionResult extract_selected_sound_features_to(
+    const FeaturesConfiguration *fc, int16_t *buffer,
+    const char *const *featureNames, int featuresCount,
+    void *const *outputs) {
+  CHECK_NULL_RET(fc, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(buffer, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(featureNames, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(outputs, FEATURE_EXTRACTION_RESULT_ERROR);
+  if (featuresCount < 0) {
+    EINA_LOG_ERR("Error: featuresCount is negative (%i)\n", featuresCount);
+    return FEATURE_EXTRACTION_RESULT_ERROR;
+  }
+  std::vector<std::string> selected;
+  for (int i = 0; i < featuresCount; i++) {
+    CHECK_NULL_RET(featureNames[i], FEATURE_EXTRACTION_RESULT_ERROR);
+    selected.push_back(featureNames[i]);
+  }
+  return extract_chunks(fc, fc->Context.get(), buffer, outputs, &selected);
+}
+
+ExtractionContext *create_extraction_context(
+    const FeaturesConfiguration *fc) {
+  CHECK_NULL_RET(fc, nullptr);
+  auto ec = new ExtractionContext();
+  ec->Config = fc;
+  try {
+    ec->Context = fc->Tree->CreateExecutionContext();
+  }
+  catch(const std::exception& ex) {
+    EINA_LOG_ERR("Caught an exception with message \"%s\".\n", ex.what());
+    delete ec;
+    return nullptr;
+  }
+  return ec;
+}
+
+void destroy_extraction_context(ExtractionContext *ec) {
+  CHECK_NULL(ec);
+  delete ec;
+}
+
+FeatureExtractionResult extract_sound_features_in_context(
+    const FeaturesConfiguration *fc, ExtractionContext *ec,
+    int16_t *buffer, void *const *outputs) {
+  CHECK_NULL_RET(fc, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(ec, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(buffer, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(outputs, FEATURE_EXTRACTION_RESULT_ERROR);
+  if (ec->Config != fc) {
+    EINA_LOG_ERR("Extraction context %p belongs to another configuration.\n",
+                 ec);
+    return FEATURE_EXTRACTION_RESULT_ERROR;
+  }
+  return extract_chunks(fc, ec->Context.get(), buffer, outputs);
+}
 
-    int j = 0;
+FeatureExtractionResult extract_sound_features(
+    const FeaturesConfiguration *fc, int16_t *buffer,
+    char ***featureNames, void ***results, int **resultLengths) {
+  CHECK_NULL_RET(fc, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(buffer, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(featureNames, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(results, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(resultLengths, FEATURE_EXTRACTION_RESULT_ERROR);
+
+  size_t *sizes;
+  int count;
+  query_feature_output_sizes(fc, featureNames, &sizes, &count);
+  *results = new void*[count];
+  *resultLengths = new int[count];
+  for (int i = 0; i < count; i++) {
+    (*resultLengths)[i] = sizes[i];
+    (*results)[i] = new char[sizes[i]];
+  }
+  delete[] sizes;
+  auto ret = extract_sound_features_to(fc, buffer, *results);
+  if (ret != FEATURE_EXTRACTION_RESULT_OK) {
+    free_results(count, *featureNames, *results, *resultLengths);
+    *featureNames = nullptr;
+    *results = nullptr;
+    *resultLengths = nullptr;
+  }
+  return ret;
+}
+
+FeatureStream *open_feature_stream(
+    const char *const *features, int featuresCount,
+    size_t pieceSize, int samplingRate) {
+  CHECK_NULL_RET(features, nullptr);
+  EINA_LOG_DBG("featuresCount=%d, pieceSize=%zu, samplingRate=%i",
+      featuresCount, pieceSize, samplingRate);
+  auto tree = build_transform_tree(features, featuresCount, pieceSize,
+                                   samplingRate, true);
+  if (tree == nullptr) {
+    return nullptr;
+  }
+  auto stream = new FeatureStream();
+  stream->Tree = std::move(tree);
+  stream->Piece.resize(pieceSize);
+  stream->PieceFilled = 0;
+  stream->Flushed = false;
+  for (auto& name : stream->Tree->FeatureNames()) {
+    stream->Names.push_back(name);
+    stream->Pending[name];
+  }
+  return stream;
+}
+
+static bool execute_stream_piece(FeatureStream *stream, const int16_t *piece,
+                                 size_t validSamples, bool last = false) {
+  try {
+    auto retmap = stream->Tree->ExecuteStream(piece, validSamples, last);
     for (auto& res : retmap) {
-      if (i == 0) {
-        copy_string(res.first, *featureNames + j);
-      }
       size_t size_each = res.second->Format()->UnalignedSizeInBytes();
-      assert(size_each > 0);
-      size_t size = size_each * res.second->Count();
-      if (i == 0) {
-        (*resultLengths)[j] = 0;
-        (*results)[j] = new char[size * fc->Chunks];
-      }
+      auto& pending = stream->Pending[res.first];
       for (size_t k = 0; k < res.second->Count(); k++) {
-        memcpy(reinterpret_cast<char *>((*results)[j]) +
-                   (*resultLengths)[j] + k * size_each,
-               (*res.second)[k], size_each);
+        auto ptr = reinterpret_cast<const char*>((*res.second)[k]);
+        pending.insert(pending.end(), ptr, ptr + size_each);
+      }
+    }
+  }
+  catch(const std::exception& ex) {
+    EINA_LOG_ERR("Caught an exception with message \"%s\".\n", ex.what());
+    return false;
+  }
+  return true;
+}
+
+FeatureExtractionResult push_samples(FeatureStream *stream,
+                                     const int16_t *samples, size_t count) {
+  CHECK_NULL_RET(stream, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(samples, FEATURE_EXTRACTION_RESULT_ERROR);
+  if (stream->Flushed) {
+    EINA_LOG_ERR("Error: the stream has already been flushed\n");
+    return FEATURE_EXTRACTION_RESULT_ERROR;
+  }
+
+  fftf_set_openmp_num_threads(get_omp_transforms_max_threads_num());
+  size_t piece_size = stream->Piece.size();
+  while (count > 0) {
+    if (stream->PieceFilled == 0 && count >= piece_size) {
+      // Avoid copying the whole pieces
+      if (!execute_stream_piece(stream, samples, piece_size)) {
+        return FEATURE_EXTRACTION_RESULT_ERROR;
+      }
+      samples += piece_size;
+      count -= piece_size;
+      continue;
+    }
+    size_t copied = std::min(count, piece_size - stream->PieceFilled);
+    memcpy(stream->Piece.data() + stream->PieceFilled, samples,
+           copied * sizeof(int16_t));
+    stream->PieceFilled += copied;
+    samples += copied;
+    count -= copied;
+    if (stream->PieceFilled == piece_size) {
+      stream->PieceFilled = 0;
+      if (!execute_stream_piece(stream, stream->Piece.data(), piece_size)) {
+        return FEATURE_EXTRACTION_RESULT_ERROR;
       }
-      (*resultLengths)[j] += size;
-      j++;
     }
   }
   return FEATURE_EXTRACTION_RESULT_OK;
 }
 
+FeatureExtractionResult pull_features(
+    FeatureStream *stream, bool flush,
+    char ***featureNames, void ***results, int **resultLengths) {
+  CHECK_NULL_RET(stream, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(featureNames, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(results, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(resultLengths, FEATURE_EXTRACTION_RESULT_ERROR);
+
+  if (flush && !stream->Flushed) {
+    // Pad the last piece with zeros, the tree discards the windows
+    // which cover the padding
+    memset(stream->Piece.data() + stream->PieceFilled, 0,
+           (stream->Piece.size() - stream->PieceFilled) * sizeof(int16_t));
+    if (!execute_stream_piece(stream, stream->Piece.data(),
+                              stream->PieceFilled, true)) {
+      return FEATURE_EXTRACTION_RESULT_ERROR;
+    }
+    stream->PieceFilled = 0;
+    // Drain the windows which waited for their neighbours
+    memset(stream->Piece.data(), 0, stream->Piece.size() * sizeof(int16_t));
+    while (stream->Tree->StreamPending()) {
+      if (!execute_stream_piece(stream, stream->Piece.data(), 0, true)) {
+        return FEATURE_EXTRACTION_RESULT_ERROR;
+      }
+    }
+    stream->Flushed = true;
+  }
+
+  size_t count = stream->Names.size();
+  *featureNames = new char*[count];
+  *results = new void*[count];
+  *resultLengths = new int[count];
+  for (size_t i = 0; i < count; i++) {
+    auto& name = stream->Names[i];
+    auto& pending = stream->Pending[name];
+    copy_string(name, *featureNames + i);
+    (*resultLengths)[i] = pending.size();
+    (*results)[i] = new char[pending.size()];
+    memcpy((*results)[i], pending.data(), pending.size());
+    pending.clear();
+  }
+  return FEATURE_EXTRACTION_RESULT_OK;
+}
+
+void close_feature_stream(FeatureStream *stream) {
+  CHECK_NULL(stream);
+
+  delete stream;
+}
+
+FeaturesBatch *setup_features_batch(
+    const char *const *features, int featuresCount,
+    size_t bucketSize, int samplingRate, int threadsCount) {
+  CHECK_NULL_RET(features, nullptr);
+  EINA_LOG_DBG("featuresCount=%d, bucketSize=%zu, samplingRate=%i, "
+               "threadsCount=%i", featuresCount, bucketSize, samplingRate,
+               threadsCount);
+  if (bucketSize == 0) {
+    EINA_LOG_ERR("Error: bucketSize is zero\n");
+    return nullptr;
+  }
+  if (featuresCount < 0 || featuresCount > MAX_FEATURES_COUNT) {
+    EINA_LOG_ERR("Error: featuresCount is out of range (%i)\n",
+                 featuresCount);
+    return nullptr;
+  }
+  std::vector<std::string> lines;
+  for (int i = 0; i < featuresCount; i++) {
+    if (features[i] == nullptr) {
+      EINA_LOG_ERR("Error: features[%i] is null\n", i);
+      return nullptr;
+    }
+    lines.push_back(features[i]);
+  }
+  RawFeaturesMap featmap;
+  try {
+    featmap = sound_feature_extraction::features::Parse(lines);
+  }
+  catch(const ParseFeaturesException& pfe) {
+    EINA_LOG_ERR("Failed to parse features. %s\n", pfe.what());
+    return nullptr;
+  }
+  if (threadsCount <= 0) {
+    threadsCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  auto batch = new FeaturesBatch();
+  batch->Features = std::move(lines);
+  for (auto& featpair : featmap) {
+    batch->Names.push_back(featpair.first);
+  }
+  std::sort(batch->Names.begin(), batch->Names.end());
+  batch->BucketSize = bucketSize;
+  batch->SamplingRate = samplingRate;
+  batch->ThreadsCount = threadsCount;
+  batch->Contexts.resize(threadsCount);
+  return batch;
+}
+
+/// @brief Returns the bucket for the clips of the specified padded size,
+/// setting it up if it does not exist yet. The least recently used buckets
+/// above FeaturesBatch::MaxBuckets are evicted.
+static std::shared_ptr<BatchBucket> batch_bucket(FeaturesBatch *batch,
+                                                 size_t size) {
+  std::shared_ptr<BatchBucket> bucket;
+  {
+    std::lock_guard<std::mutex> lock(batch->BucketsMutex);
+    auto& item = batch->Buckets[size];
+    if (item == nullptr) {
+      item = std::make_shared<BatchBucket>();
+    }
+    item->LastUse = ++batch->Uses;
+    bucket = item;
+    while (batch->Buckets.size() > batch->MaxBuckets) {
+      auto lru = batch->Buckets.end();
+      for (auto it = batch->Buckets.begin(); it != batch->Buckets.end();
+           ++it) {
+        if (lru == batch->Buckets.end() ||
+            it->second->LastUse < lru->second->LastUse) {
+          lru = it;
+        }
+      }
+      EINA_LOG_INFO("Evicting the bucket of %zu samples\n", lru->first);
+      lru->second->Evicted = true;
+      batch->Buckets.erase(lru);
+    }
+  }
+  // The other workers do not wait for this setup unless they need the same
+  // bucket
+  std::call_once(bucket->Setup, [batch, size, &bucket]() {
+    EINA_LOG_INFO("Setting up the bucket of %zu samples\n", size);
+    std::vector<const char*> features;
+    for (auto& line : batch->Features) {
+      features.push_back(line.c_str());
+    }
+    bucket->Config.reset(setup_features_extraction_cached(
+        features.data(), features.size(), size, batch->SamplingRate));
+  });
+  if (bucket->Config == nullptr) {
+    std::lock_guard<std::mutex> lock(batch->BucketsMutex);
+    auto it = batch->Buckets.find(size);
+    if (it != batch->Buckets.end() && it->second == bucket) {
+      bucket->Evicted = true;
+      batch->Buckets.erase(it);
+    }
+    return nullptr;
+  }
+  return bucket;
+}
+
+/// @brief Calculates the sizes of the features of a clip without padding,
+/// without preparing the transform tree.
+/// @return The empty map if the features cannot be extracted from a clip of
+/// this size.
+static std::unordered_map<std::string, size_t> batch_clip_sizes(
+    const FeaturesBatch *batch, size_t clipSize) {
+  try {
+    auto featmap = sound_feature_extraction::features::Parse(batch->Features);
+    TransformTree tree(std::make_shared<ArrayFormat16>(
+        clipSize, batch->SamplingRate));
+    for (auto& featpair : featmap) {
+      tree.AddFeature(featpair.first, featpair.second);
+    }
+    return tree.FeatureSizes();
+  }
+  catch(const std::exception& ex) {
+    EINA_LOG_DBG("Failed to calculate the feature sizes of %zu samples. %s\n",
+                 clipSize, ex.what());
+    return {};
+  }
+}
+
+/// @brief Extracts the features from a single clip of the batch.
+/// @param contexts The execution contexts of the current worker.
+/// @param padded The reused buffer for the zero padded clip.
+static bool extract_batch_clip(
+    FeaturesBatch *batch, std::unordered_map<size_t, BatchContext> *contexts,
+    const int16_t *clip, size_t clipSize, std::vector<int16_t> *padded,
+    void ***results, int **resultLengths) {
+  CHECK_NULL_RET(clip, false);
+  size_t size = std::max(
+      (clipSize + batch->BucketSize - 1) / batch->BucketSize, size_t(1)) *
+      batch->BucketSize;
+  auto bucket = batch_bucket(batch, size);
+  if (bucket == nullptr) {
+    return false;
+  }
+  auto fc = bucket->Config.get();
+  // Release the contexts of the evicted buckets
+  for (auto it = contexts->begin(); it != contexts->end();) {
+    if (it->second.Bucket->Evicted && it->first != size) {
+      it = contexts->erase(it);
+    } else {
+      ++it;
+    }
+  }
+  auto& item = (*contexts)[size];
+  if (item.Bucket != bucket) {
+    item.Context.reset();
+    item.Bucket = bucket;
+  }
+  auto& context = item.Context;
+  if (context == nullptr) {
+    try {
+      context = fc->Tree->CreateExecutionContext();
+    }
+    catch(const std::exception& ex) {
+      EINA_LOG_ERR("Caught an exception with message \"%s\".\n", ex.what());
+      return false;
+    }
+  }
+  // Execute() does not overwrite the input
+  auto input = const_cast<int16_t *>(clip);
+  if (size != clipSize) {
+    padded->resize(size);
+    std::copy(clip, clip + clipSize, padded->begin());
+    std::fill(padded->begin() + clipSize, padded->end(), 0);
+    input = padded->data();
+  }
+  // The results are trimmed to the frames which come from the real samples
+  if (fc->Chunks == 1 && item.ClipSize != clipSize) {
+    item.ClipSize = clipSize;
+    item.ClipSizes = size != clipSize?
+        batch_clip_sizes(batch, clipSize)
+        : std::unordered_map<std::string, size_t>();
+  }
+  auto names = fc->Tree->FeatureNames();
+  auto sizes = fc->Tree->FeatureSizes();
+  *results = new void*[batch->Names.size()]();
+  *resultLengths = new int[batch->Names.size()]();
+  std::vector<void*> outputs(names.size());
+  for (size_t i = 0; i < names.size(); i++) {
+    size_t index = std::lower_bound(batch->Names.begin(), batch->Names.end(),
+                                    names[i]) - batch->Names.begin();
+    assert(index < batch->Names.size() && batch->Names[index] == names[i]);
+    size_t length = sizes[names[i]] * fc->Chunks;
+    (*results)[index] = new char[length];
+    if (fc->Chunks == 1) {
+      auto clip_size = item.ClipSizes.find(names[i]);
+      if (clip_size != item.ClipSizes.end()) {
+        length = std::min(length, clip_size->second);
+      }
+    }
+    (*resultLengths)[index] = length;
+    outputs[i] = (*results)[index];
+  }
+  return extract_chunks(fc, context.get(), input, outputs.data()) ==
+      FEATURE_EXTRACTION_RESULT_OK;
+}
+
+FeatureExtractionResult extract_sound_features_batch(
+    FeaturesBatch *batch, const int16_t *const *clips,
+    const size_t *clipSizes, int clipsCount,
+    char ***featureNames, void ****results, int ***resultLengths) {
+  CHECK_NULL_RET(batch, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(clips, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(clipSizes, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(featureNames, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(results, FEATURE_EXTRACTION_RESULT_ERROR);
+  CHECK_NULL_RET(resultLengths, FEATURE_EXTRACTION_RESULT_ERROR);
+  if (clipsCount < 0) {
+    EINA_LOG_ERR("Error: clipsCount is negative (%i)\n", clipsCount);
+    return FEATURE_EXTRACTION_RESULT_ERROR;
+  }
+
+  std::lock_guard<std::mutex> lock(batch->ExtractMutex);
+  int featuresCount = batch->Names.size();
+  *featureNames = new char*[featuresCount];
+  for (int i = 0; i < featuresCount; i++) {
+    copy_string(batch->Names[i], *featureNames + i);
+  }
+  *results = new void**[clipsCount]();
+  *resultLengths = new int*[clipsCount]();
+  // The workers take the clips one by one in the order of submission
+  std::atomic_int next_clip(0);
+  std::atomic_bool failed(false);
+  auto worker = [&](int index) {
+    std::vector<int16_t> padded;
+    int clip;
+    while (!failed && (clip = next_clip++) < clipsCount) {
+      if (!extract_batch_clip(batch, &batch->Contexts[index], clips[clip],
+                              clipSizes[clip], &padded, *results + clip,
+                              *resultLengths + clip)) {
+        EINA_LOG_ERR("Failed to extract the features from clip %i\n", clip);
+        failed = true;
+      }
+    }
+  };
+  int threadsCount = std::min(batch->ThreadsCount, std::max(clipsCount, 1));
+  std::vector<std::thread> threads;
+  for (int i = 1; i < threadsCount; i++) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (failed) {
+    free_batch_results(featuresCount, clipsCount, *featureNames, *results,
+                       *resultLengths);
+    *featureNames = nullptr;
+    *results = nullptr;
+    *resultLengths = nullptr;
+    return FEATURE_EXTRACTION_RESULT_ERROR;
+  }
+  return FEATURE_EXTRACTION_RESULT_OK;
+}
+
+void free_batch_results(int featuresCount, int clipsCount,
+                        char **featureNames, void ***results,
+                        int **resultLengths) {
+  if (featureNames != nullptr) {
+    for (int i = 0; i < featuresCount; i++) {
+      delete[] featureNames[i];
+    }
+    delete[] featureNames;
+  }
+  if (results != nullptr) {
+    for (int i = 0; i < clipsCount; i++) {
+      if (results[i] == nullptr) {
+        continue;
+      }
+      for (int j = 0; j < featuresCount; j++) {
+        delete[] reinterpret_cast<char*>(results[i][j]);
+      }
+      delete[] results[i];
+    }
+    delete[] results;
+  }
+  if (resultLengths != nullptr) {
+    for (int i = 0; i < clipsCount; i++) {
+      delete[] resultLengths[i];
+    }
+    delete[] resultLengths;
+  }
+}
+
+void destroy_features_batch(FeaturesBatch *batch) {
+  CHECK_NULL(batch);
+
+  delete batch;
+}
+
 void report_extraction_time(const FeaturesConfiguration *fc,
                             char ***transformNames,
                             float **values,
@@ -395,7 +1306,8 @@ void report_extraction_time(const FeaturesConfiguration *fc,
   CHECK_NULL(values);
   CHECK_NULL(length);
 
-  auto report = fc->Tree->ExecutionTimeReport();
+  auto report = fc->Context == nullptr? fc->Tree->ExecutionTimeReport()
+      : fc->Tree->ExecutionTimeReport(*fc->Context);
   *length = report.size();
   *transformNames = new char*[*length];
   *values = new float[*length];
@@ -428,6 +1340,48 @@ void report_extraction_graph(const FeaturesConfiguration *fc,
   fc->Tree->Dump(fileName);
 }
 
+void set_extraction_statistics(const FeaturesConfiguration *fc,
+                               int enabled) {
+  CHECK_NULL(fc);
+  fc->Tree->set_collect_statistics(enabled);
+}
+
+char *report_extraction_statistics(const FeaturesConfiguration *fc,
+                                   int chromeTrace) {
+  CHECK_NULL_RET(fc, nullptr);
+  std::string report;
+  if (fc->Context == nullptr) {
+    report = chromeTrace? fc->Tree->ChromeTrace()
+        : fc->Tree->StatisticsReport();
+  } else {
+    report = chromeTrace? fc->Tree->ChromeTrace(*fc->Context)
+        : fc->Tree->StatisticsReport(*fc->Context);
+  }
+  char *ret;
+  copy_string(report, &ret);
+  return ret;
+}
+
+void destroy_extraction_statistics_report(char *report) {
+  CHECK_NULL(report);
+  delete[] report;
+}
+
+void set_extraction_perf_counters(const FeaturesConfiguration *fc,
+                                  int enabled) {
+  CHECK_NULL(fc);
+  fc->Tree->set_perf_counters(enabled);
+}
+
+void reset_extraction_statistics(FeaturesConfiguration *fc) {
+  CHECK_NULL(fc);
+  if (fc->Context == nullptr) {
+    fc->Tree->ResetStatistics();
+  } else {
+    fc->Tree->ResetStatistics(fc->Context.get());
+  }
+}
+
 void destroy_features_configuration(FeaturesConfiguration* fc) {
   CHECK_NULL(fc);
 
@@ -501,18 +1455,15 @@ void set_use_simd(int value) {
   SimdAware::set_use_simd(value);
 }
 
-size_t cpu_cache_size = 8 * 1024 * 1024;
+/// @brief 0 means the size is derived from the detected CPU caches.
+size_t cpu_cache_size = 0;
 
 size_t get_cpu_cache_size() {
   return cpu_cache_size;
 }
 
 void set_cpu_cache_size(size_t value) {
-  if (value > 0) {
-    cpu_cache_size = value;
-  } else {
-    EINA_LOG_ERR("CPU cache size must be greater than zero.");
-  }
+  cpu_cache_size = value;
 }
 
 size_t get_chunk_size(void) {
@@ -527,4 +1478,40 @@ void set_chunk_size(size_t value) {
   }
 }
 
+int get_branch_threads_num(void) {
+  return branch_threads_num;
+}
+
+void set_branch_threads_num(int value) {
+  if (value > 0) {
+    branch_threads_num = value;
+  } else {
+    EINA_LOG_ERR("The number of branch threads must be greater than zero.");
+  }
+}
+
+GuardMode get_guard_mode(void) {
+  return guard_mode;
+}
+
+void set_guard_mode(GuardMode value) {
+  if (value >= GUARD_MODE_OFF && value <= GUARD_MODE_SAMPLED) {
+    guard_mode = value;
+  } else {
+    EINA_LOG_ERR("Invalid guard mode %d.", value);
+  }
+}
+
+int get_guard_sampling_period(void) {
+  return guard_sampling_period;
+}
+
+void set_guard_sampling_period(int value) {
+  if (value > 0) {
+    guard_sampling_period = value;
+  } else {
+    EINA_LOG_ERR("The guard sampling period must be greater than zero.");
+  }
+}
+
 }  // extern "C"
@@ -0,0 +1,185 @@
+/*! @file cpu_cache.cc
+ *  @brief Detection of the CPU data caches hierarchy.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/cpu_cache.h"
+#include <unistd.h>
+#include <cctype>
+#include <algorithm>
+#include <fstream>
+
+namespace sound_feature_extraction {
+
+constexpr const char* CpuCacheTopology::kSysfsCpuPath;
+
+CpuCacheTopology::CpuCacheTopology(const std::string& sysfsCpuPath) noexcept
+    : cpus_(1) {
+  std::ifstream online(sysfsCpuPath + "/online");
+  std::string list;
+  if (std::getline(online, list)) {
+    cpus_ = std::max(ParseCpuList(list), 1);
+  } else {
+    cpus_ = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+  }
+  if (!ReadSysfs(sysfsCpuPath + "/cpu0/cache")) {
+    ReadSysconf();
+  }
+  if (levels_.empty()) {
+    // Nothing is known, assume a typical desktop CPU
+    levels_ = { { 1, 32 * 1024, 1 }, { 2, 256 * 1024, 1 },
+                { 3, 8 * 1024 * 1024, cpus_ } };
+  }
+  std::sort(levels_.begin(), levels_.end(),
+            [](const CacheLevel& l1, const CacheLevel& l2) {
+    return l1.Level < l2.Level;
+  });
+}
+
+const CpuCacheTopology& CpuCacheTopology::Instance() noexcept {
+  static const CpuCacheTopology instance;
+  return instance;
+}
+
+const std::vector<CacheLevel>& CpuCacheTopology::levels() const noexcept {
+  return levels_;
+}
+
+int CpuCacheTopology::cpus() const noexcept {
+  return cpus_;
+}
+
+const CacheLevel* CpuCacheTopology::Find(int level) const noexcept {
+  for (auto& cl : levels_) {
+    if (cl.Level == level) {
+      return &cl;
+    }
+  }
+  return nullptr;
+}
+
+size_t CpuCacheTopology::ThreadBudget(int level, int threads) const noexcept {
+  auto cl = Find(level);
+  if (cl == nullptr) {
+    return 0;
+  }
+  threads = std::max(threads, 1);
+  // The expected number of threads running on the CPUs which share one cache
+  int sharers = (threads * cl->SharedBy + cpus_ - 1) / cpus_;
+  sharers = std::max(1, std::min(sharers, std::min(threads, cl->SharedBy)));
+  return cl->Size / sharers;
+}
+
+bool CpuCacheTopology::ReadSysfs(const std::string& path) noexcept {
+  for (int i = 0;; i++) {
+    auto dir = path + "/index" + std::to_string(i) + "/";
+    std::ifstream type_file(dir + "type");
+    std::string type;
+    if (!std::getline(type_file, type)) {
+      break;
+    }
+    if (type == "Instruction") {
+      continue;
+    }
+    std::ifstream level_file(dir + "level");
+    std::ifstream size_file(dir + "size");
+    std::ifstream shared_file(dir + "shared_cpu_list");
+    CacheLevel cl;
+    std::string size, shared;
+    level_file >> cl.Level;
+    std::getline(size_file, size);
+    cl.Size = ParseSize(size);
+    if (std::getline(shared_file, shared)) {
+      cl.SharedBy = std::max(ParseCpuList(shared), 1);
+    }
+    if (cl.Level > 0 && cl.Size > 0) {
+      levels_.push_back(cl);
+    }
+  }
+  return !levels_.empty();
+}
+
+void CpuCacheTopology::ReadSysconf() noexcept {
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  static const int names[] = { _SC_LEVEL1_DCACHE_SIZE, _SC_LEVEL2_CACHE_SIZE,
+                               _SC_LEVEL3_CACHE_SIZE };
+  for (int i = 0; i < 3; i++) {
+    auto size = sysconf(names[i]);
+    if (size > 0) {
+      // The sharing is unknown; the last level is usually shared by all
+      levels_.emplace_back(i + 1, size, i == 2? cpus_ : 1);
+    }
+  }
+#endif
+}
+
+size_t CpuCacheTopology::ParseSize(const std::string& str) noexcept {
+  size_t pos = 0;
+  size_t size = 0;
+  while (pos < str.size() && isdigit(str[pos])) {
+    size = size * 10 + (str[pos++] - '0');
+  }
+  if (pos < str.size()) {
+    switch (toupper(str[pos])) {
+      case 'K':
+        size *= 1024;
+        break;
+      case 'M':
+        size *= 1024 * 1024;
+        break;
+      case 'G':
+        size *= 1024 * 1024 * 1024;
+        break;
+    }
+  }
+  return size;
+}
+
+int CpuCacheTopology::ParseCpuList(const std::string& str) noexcept {
+  // E.g., "0-3,8-11"
+  int count = 0;
+  size_t pos = 0;
+  while (pos < str.size()) {
+    if (!isdigit(str[pos])) {
+      pos++;
+      continue;
+    }
+    size_t end;
+    int first = std::stoi(str.substr(pos), &end);
+    pos += end;
+    int last = first;
+    if (pos + 1 < str.size() && str[pos] == '-' && isdigit(str[pos + 1])) {
+      last = std::stoi(str.substr(++pos), &end);
+      pos += end;
+    }
+    count += last - first + 1;
+  }
+  return count;
+}
+
+}  // namespace sound_feature_extraction
@@ -0,0 +1,102 @@
+/*! @file cpu_cache.h
+ *  @brief Detection of the CPU data caches hierarchy.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_CPU_CACHE_H_
+#define SRC_CPU_CACHE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sound_feature_extraction {
+
+/// @brief The description of a single level of the CPU data caches.
+struct CacheLevel {
+  CacheLevel() : Level(0), Size(0), SharedBy(1) {
+  }
+
+  CacheLevel(int level, size_t size, int sharedBy)
+      : Level(level), Size(size), SharedBy(sharedBy) {
+  }
+
+  int Level;
+  /// @brief The size in bytes of a single cache of this level.
+  size_t Size;
+  /// @brief The number of logical CPUs which share a single cache of this
+  /// level.
+  int SharedBy;
+};
+
+/// @brief The data and unified caches of the CPU, as reported by Linux
+/// sysfs (/sys/devices/system/cpu/cpu0/cache).
+class CpuCacheTopology {
+ public:
+  /// @brief Reads the caches from the specified sysfs directory.
+  /// If it is not available, asks sysconf() and finally falls back to
+  /// the typical values.
+  /// @param sysfsCpuPath The directory with cpu0, cpu1, etc.
+  explicit CpuCacheTopology(
+      const std::string& sysfsCpuPath = kSysfsCpuPath) noexcept;
+
+  /// @brief The topology of the machine we are running on, which is
+  /// detected once.
+  static const CpuCacheTopology& Instance() noexcept;
+
+  /// @brief The cache levels sorted by Level.
+  const std::vector<CacheLevel>& levels() const noexcept;
+
+  /// @brief The number of online logical CPUs.
+  int cpus() const noexcept;
+
+  /// @brief Returns the specified level or nullptr if it does not exist.
+  const CacheLevel* Find(int level) const noexcept;
+
+  /// @brief Returns the amount of cache of the specified level which each
+  /// of the threads running simultaneously can use. The threads are assumed
+  /// to be evenly spread over all CPUs, so that a private L2 is not shared
+  /// while L3 is divided between the threads running on the same socket.
+  /// @return 0 if the level does not exist.
+  size_t ThreadBudget(int level, int threads) const noexcept;
+
+  static constexpr const char* kSysfsCpuPath = "/sys/devices/system/cpu";
+
+ private:
+  bool ReadSysfs(const std::string& path) noexcept;
+  void ReadSysconf() noexcept;
+  static size_t ParseSize(const std::string& str) noexcept;
+  static int ParseCpuList(const std::string& str) noexcept;
+
+  std::vector<CacheLevel> levels_;
+  int cpus_;
+};
+
+}  // namespace sound_feature_extraction
+
+#endif  // SRC_CPU_CACHE_H_
@@ -0,0 +1,170 @@
+/*! @file fftf_plan_cache.cc
+ *  @brief Cache of FFTF plans bound to particular buffers.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/fftf_plan_cache.h"
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace sound_feature_extraction {
+
+bool FFTFPlanCache::Key::operator==(const Key& other) const noexcept {
+  return Type == other.Type && Direction == other.Direction &&
+      Length == other.Length && Count == other.Count &&
+      Input == other.Input && InputStride == other.InputStride &&
+      Output == other.Output && OutputStride == other.OutputStride;
+}
+
+size_t FFTFPlanCache::KeyHash::operator()(const Key& key) const noexcept {
+  size_t hash = std::hash<const void*>()(key.Input);
+  hash = hash * 31 + std::hash<const void*>()(key.Output);
+  hash = hash * 31 + key.Count;
+  hash = hash * 31 + key.Length;
+  hash = hash * 31 + static_cast<size_t>(key.Type) * 2 +
+      (key.Direction == FFTF_DIRECTION_FORWARD? 0 : 1);
+  return hash;
+}
+
+FFTFPlanCache::FFTFPlanCache() noexcept
+    : Logger("FFTFPlanCache", EINA_COLOR_LIGHTCYAN) {
+}
+
+const FFTFInstance* FFTFPlanCache::Get(
+    FFTFType type, FFTFDirection direction, int length,
+    const Buffers& in, Buffers* out) {
+  Key key;
+  key.Type = type;
+  key.Direction = direction;
+  key.Length = length;
+  key.Count = in.Count();
+  key.Input = in.Data();
+  key.InputStride = in.Format()->SizeInBytes();
+  key.Output = static_cast<const Buffers*>(out)->Data();
+  key.OutputStride = out->Format()->SizeInBytes();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = plans_.find(key);
+  if (it != plans_.end()) {
+    return it->second.get();
+  }
+  DBG("Creating plan type=%d, direction=%d, length=%d, count=%zu "
+      "(%p -> %p)", static_cast<int>(type), static_cast<int>(direction),
+      length, key.Count, key.Input, key.Output);
+  std::vector<const float*> inputs(key.Count);
+  std::vector<float*> outputs(key.Count);
+  for (size_t i = 0; i < key.Count; i++) {
+    inputs[i] = reinterpret_cast<const float*>(in[i]);
+    outputs[i] = reinterpret_cast<float*>((*out)[i]);
+  }
+  auto plan = CreatePlan(key, &inputs[0], &outputs[0]);
+  auto ret = plan.get();
+  plans_.insert(std::make_pair(key, std::move(plan)));
+  return ret;
+}
+
+void FFTFPlanCache::CalculateOnce(FFTFType type, FFTFDirection direction,
+                                  int length, const float* in,
+                                  float* out) const {
+  Key key;
+  key.Type = type;
+  key.Direction = direction;
+  key.Length = length;
+  key.Count = 1;
+  key.Input = in;
+  key.InputStride = 0;
+  key.Output = out;
+  key.OutputStride = 0;
+  PlanPtr plan(nullptr, fftf_destroy);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    plan = CreatePlan(key, &in, &out);
+  }
+  fftf_calc(plan.get());
+}
+
+size_t FFTFPlanCache::Size() const noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return plans_.size();
+}
+
+void FFTFPlanCache::Clear() noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  plans_.clear();
+}
+
+void FFTFPlanCache::Evict(const void* memory, size_t size) noexcept {
+  auto begin = reinterpret_cast<uintptr_t>(memory);
+  auto inside = [begin, size](const void* ptr) {
+    return reinterpret_cast<uintptr_t>(ptr) - begin < size;
+  };
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = plans_.begin(); it != plans_.end();) {
+    if (inside(it->first.Input) || inside(it->first.Output)) {
+      it = plans_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+FFTFPlanCache::PlanPtr FFTFPlanCache::CreatePlan(
+    const Key& key, const float* const* inputs, float* const* outputs) {
+  fftf_set_backend(FFTF_BACKEND_NONE);
+  fftf_ensure_is_supported(key.Type, key.Length);
+  return PlanPtr(fftf_init_batch(
+                     key.Type,
+                     key.Direction,
+                     FFTF_DIMENSION_1D,
+                     &key.Length,
+                     FFTF_NO_OPTIONS,
+                     key.Count,
+                     inputs, outputs),
+                 fftf_destroy);
+}
+
+FFTFPlanCacheAware::FFTFPlanCacheAware() noexcept
+    : plan_cache_(std::make_shared<FFTFPlanCache>()) {
+}
+
+const std::shared_ptr<FFTFPlanCache>& FFTFPlanCacheAware::plan_cache()
+    const noexcept {
+  return plan_cache_;
+}
+
+void FFTFPlanCacheAware::set_plan_cache(
+    const std::shared_ptr<FFTFPlanCache>& value) noexcept {
+  assert(value != nullptr);
+  plan_cache_ = value;
+}
+
+void FFTFPlanCacheAware::PreparePlans(const Buffers&, Buffers*) const {
+}
+
+}  // namespace sound_feature_extraction
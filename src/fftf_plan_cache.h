@@ -0,0 +1,129 @@
+/*! @file fftf_plan_cache.h
+ *  @brief Cache of FFTF plans bound to particular buffers.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_FFTF_PLAN_CACHE_H_
+#define SRC_FFTF_PLAN_CACHE_H_
+
+#include <fftf/api.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "src/buffers.h"
+#include "src/logger.h"
+
+namespace sound_feature_extraction {
+
+/// @brief Keeps FFTF plans alive between the calls to Transform::Do().
+/// @details FFTF binds each plan to the exact input and output pointers,
+/// so a plan can be reused only on the very same buffers. The buffers of
+/// a prepared TransformTree never move, thus the plans are created on the
+/// first call and then executed without any setup cost.
+class FFTFPlanCache : public Logger {
+ public:
+  FFTFPlanCache() noexcept;
+
+  /// @brief Returns the batch plan which transforms each of in.Count()
+  /// buffers of in into the corresponding buffer of out, creating it
+  /// if necessary.
+  /// @param type The FFTF transform type.
+  /// @param direction The FFTF transform direction.
+  /// @param length The transform length.
+  /// @param in The input buffers.
+  /// @param out The output buffers.
+  const FFTFInstance* Get(FFTFType type, FFTFDirection direction, int length,
+                          const Buffers& in, Buffers* out);
+
+  /// @brief Executes the single transform of in into out once, without
+  /// keeping the plan.
+  void CalculateOnce(FFTFType type, FFTFDirection direction, int length,
+                     const float* in, float* out) const;
+
+  /// @brief The number of plans in the cache.
+  size_t Size() const noexcept;
+
+  /// @brief Destroys all the cached plans.
+  void Clear() noexcept;
+
+  /// @brief Destroys the plans which read or write the memory
+  /// [memory, memory + size), e.g., the arena of a destroyed
+  /// ExecutionContext.
+  void Evict(const void* memory, size_t size) noexcept;
+
+ private:
+  struct Key {
+    FFTFType Type;
+    FFTFDirection Direction;
+    int Length;
+    size_t Count;
+    const void* Input;
+    size_t InputStride;
+    const void* Output;
+    size_t OutputStride;
+
+    bool operator==(const Key& other) const noexcept;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const noexcept;
+  };
+
+  typedef std::unique_ptr<FFTFInstance, void (*)(FFTFInstance*)> PlanPtr;
+
+  static PlanPtr CreatePlan(const Key& key, const float* const* inputs,
+                            float* const* outputs);
+
+  std::unordered_map<Key, PlanPtr, KeyHash> plans_;
+  mutable std::mutex mutex_;
+};
+
+/// @brief All transforms which execute FFTF plans should inherit from this.
+/// @details Each transform owns a private FFTFPlanCache by default.
+/// TransformTree replaces it with the single cache shared by the whole tree,
+/// so that the plans live as long as the prepared tree and the plans on the
+/// same buffers (the allocator reuses the memory of the finished branches)
+/// are not duplicated.
+class FFTFPlanCacheAware {
+ public:
+  FFTFPlanCacheAware() noexcept;
+  virtual ~FFTFPlanCacheAware() = default;
+
+  const std::shared_ptr<FFTFPlanCache>& plan_cache() const noexcept;
+  void set_plan_cache(const std::shared_ptr<FFTFPlanCache>& value) noexcept;
+
+  /// @brief Creates in advance all the plans which Do() is going to execute
+  /// on the specified buffers.
+  virtual void PreparePlans(const Buffers& in, Buffers* out) const;
+
+ private:
+  std::shared_ptr<FFTFPlanCache> plan_cache_;
+};
+
+}  // namespace sound_feature_extraction
+#endif  // SRC_FFTF_PLAN_CACHE_H_
@@ -33,23 +33,12 @@
 #define SRC_FLOATPTR_H_
 
 #include <cstdlib>
-#include <mutex>
+#include <memory>
 
 namespace sound_feature_extraction {
 
 typedef std::unique_ptr<float[], decltype(&std::free)> FloatPtr;
 
-struct ThreadSafeFloatPtr {
-  ThreadSafeFloatPtr() : data(nullptr, std::free) {
-  }
-
-  ThreadSafeFloatPtr(const ThreadSafeFloatPtr&) : data(nullptr, std::free) {
-  }
-
-  FloatPtr data;
-  std::mutex mutex;
-};
-
 }  // namespace sound_feature_extraction
 
 #endif  // SRC_FLOATPTR_H_
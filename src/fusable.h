@@ -0,0 +1,52 @@
+/*! @file fusable.h
+ *  @brief Interface of the transforms which can be fused with their neighbours.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_FUSABLE_H_
+#define SRC_FUSABLE_H_
+
+namespace sound_feature_extraction {
+
+/// @brief All float array transforms which process each buffer independently
+/// of the others should inherit from this, so that TransformTree is able to
+/// execute the chains of such transforms buffer by buffer without
+/// the intermediate buffers (see transforms::Fused).
+class Fusable {
+ public:
+  virtual ~Fusable() = default;
+
+  /// @brief Does the same as Do() for a single buffer.
+  /// @param in InputFormat()->Size() floats.
+  /// @param out OutputFormat()->Size() floats, never overlaps with in.
+  virtual void DoBuffer(const float* in, float* out) const noexcept = 0;
+};
+
+}  // namespace sound_feature_extraction
+
+#endif  // SRC_FUSABLE_H_
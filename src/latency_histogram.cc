@@ -0,0 +1,120 @@
+/*! @file latency_histogram.cc
+ *  @brief Log-linear histogram of the execution times.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace sound_feature_extraction {
+
+constexpr int LatencyHistogram::kBucketsCount;
+constexpr uint64_t LatencyHistogram::kMaxValue;
+
+LatencyHistogram::LatencyHistogram() noexcept {
+  Reset();
+}
+
+void LatencyHistogram::Record(uint64_t value) noexcept {
+  value = std::min(value, kMaxValue);
+  counts_[BucketIndex(value)]++;
+  if (count_ == 0 || value < min_) {
+    min_ = value;
+  }
+  if (value > max_) {
+    max_ = value;
+  }
+  count_++;
+  total_ += value;
+}
+
+uint64_t LatencyHistogram::Percentile(double quantile) const noexcept {
+  if (count_ == 0) {
+    return 0;
+  }
+  quantile = std::max(0., std::min(quantile, 1.));
+  auto rank = std::max(static_cast<uint64_t>(ceil(quantile * count_)),
+                       UINT64_C(1));
+  uint64_t sum = 0;
+  for (int i = 0; i < kBucketsCount; i++) {
+    sum += counts_[i];
+    if (sum >= rank) {
+      return std::min(BucketUpperBound(i), max_);
+    }
+  }
+  return max_;
+}
+
+void LatencyHistogram::Reset() noexcept {
+  memset(counts_, 0, sizeof(counts_));
+  count_ = 0;
+  total_ = 0;
+  min_ = 0;
+  max_ = 0;
+}
+
+uint64_t LatencyHistogram::count() const noexcept {
+  return count_;
+}
+
+uint64_t LatencyHistogram::total() const noexcept {
+  return total_;
+}
+
+uint64_t LatencyHistogram::min() const noexcept {
+  return min_;
+}
+
+uint64_t LatencyHistogram::max() const noexcept {
+  return max_;
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value) noexcept {
+  if (value < kSubBucketsCount) {
+    return value;
+  }
+  // The position of the highest set bit
+  int exponent = 63 - __builtin_clzll(value);
+  int shift = exponent - kSubBucketBits;
+  return (shift + 1) * kSubBucketsCount +
+      ((value >> shift) & (kSubBucketsCount - 1));
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index) noexcept {
+  if (index < kSubBucketsCount) {
+    return index;
+  }
+  int shift = index / kSubBucketsCount - 1;
+  uint64_t lower = static_cast<uint64_t>(
+      kSubBucketsCount + index % kSubBucketsCount) << shift;
+  return lower + (UINT64_C(1) << shift) - 1;
+}
+
+}  // namespace sound_feature_extraction
@@ -0,0 +1,83 @@
+/*! @file latency_histogram.h
+ *  @brief Log-linear histogram of the execution times.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_LATENCY_HISTOGRAM_H_
+#define SRC_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+
+namespace sound_feature_extraction {
+
+/// @brief Counts the values in the buckets whose width grows with the value,
+/// similar to HdrHistogram. Each power of two range is split into
+/// kSubBucketsCount buckets, so the relative error of the percentiles is
+/// below 1 / kSubBucketsCount. Recording is a few arithmetic operations
+/// and does not allocate memory.
+class LatencyHistogram {
+ public:
+  LatencyHistogram() noexcept;
+
+  /// @brief Adds the value, which is usually the time in nanoseconds.
+  /// The values greater than kMaxValue are counted as kMaxValue.
+  void Record(uint64_t value) noexcept;
+  /// @brief Returns the greatest value of the bucket which contains
+  /// the specified quantile, but not greater than max().
+  /// @param quantile The number in [0, 1], e.g. 0.95 for p95.
+  uint64_t Percentile(double quantile) const noexcept;
+  void Reset() noexcept;
+
+  uint64_t count() const noexcept;
+  /// @brief The sum of all the recorded values.
+  uint64_t total() const noexcept;
+  uint64_t min() const noexcept;
+  uint64_t max() const noexcept;
+
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kSubBucketsCount = 1 << kSubBucketBits;
+  static constexpr int kValueBits = 36;
+  static constexpr uint64_t kMaxValue = (UINT64_C(1) << kValueBits) - 1;
+  static constexpr int kBucketsCount =
+      (kValueBits - kSubBucketBits + 1) * kSubBucketsCount;
+
+  static int BucketIndex(uint64_t value) noexcept;
+  /// @brief Returns the greatest value which falls into the bucket.
+  static uint64_t BucketUpperBound(int index) noexcept;
+
+ private:
+  uint64_t counts_[kBucketsCount];
+  uint64_t count_;
+  uint64_t total_;
+  uint64_t min_;
+  uint64_t max_;
+};
+
+}  // namespace sound_feature_extraction
+
+#endif  // SRC_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,114 @@
+/*! @file lookahead_stream.cc
+ *  @brief Streaming support of the transforms which look at the adjacent windows.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/lookahead_stream.h"
+#include <algorithm>
+#include <cstring>
+
+namespace sound_feature_extraction {
+
+LookaheadStream::LookaheadStream() noexcept
+    : count_(0), back_(0), front_(0), origin_(0), received_(0), emitted_(0),
+      input_({0, 0, false}), emitting_(0) {
+}
+
+void LookaheadStream::Initialize(
+    const std::shared_ptr<BufferFormatBase<float*>>& format,
+    size_t count, size_t back, size_t front) {
+  format_ = format;
+  count_ = count;
+  back_ = back;
+  front_ = front;
+  // At most back_ windows of history and front_ windows waiting for their
+  // neighbours precede the new piece
+  size_t capacity = back + front + count;
+  sequence_.reset(new BuffersBase<float*>(format, capacity));
+  results_.reset(new BuffersBase<float*>(format, capacity));
+  Reset();
+}
+
+void LookaheadStream::Reset() noexcept {
+  origin_ = 0;
+  received_ = 0;
+  emitted_ = 0;
+  input_ = {0, 0, false};
+  emitting_ = 0;
+}
+
+StreamPiece LookaheadStream::Prepare(const StreamPiece& input) noexcept {
+  input_ = input;
+  received_ += input.Valid - input.Skip;
+  size_t ready = received_;
+  if (!input.Last) {
+    ready = received_ > front_? received_ - front_ : 0;
+  }
+  emitting_ = std::min(count_, std::max(ready, emitted_) - emitted_);
+  StreamPiece output;
+  output.Skip = 0;
+  output.Valid = emitting_;
+  output.Last = input.Last && emitted_ + emitting_ == received_;
+  return output;
+}
+
+bool LookaheadStream::Pending() const noexcept {
+  return emitted_ < received_;
+}
+
+void LookaheadStream::Process(const BuffersBase<float*>& in,
+                              BuffersBase<float*>* out,
+                              const Calculator& calculator) noexcept {
+  size_t stride = format_->SizeInBytes();
+  size_t incoming = input_.Valid - input_.Skip;
+  size_t length = received_ - origin_;
+  if (incoming > 0) {
+    memcpy((*sequence_)[length - incoming], in[input_.Skip],
+           incoming * stride);
+  }
+  if (emitting_ > 0) {
+    BuffersBase<float*> sequence(format_, length, (*sequence_)[0]);
+    BuffersBase<float*> results(format_, length, (*results_)[0]);
+    size_t first = emitted_ - origin_;
+    calculator(sequence, origin_, first, first + emitting_, &results);
+    memcpy((*out)[0], results[first], emitting_ * stride);
+    emitted_ += emitting_;
+  }
+  if (emitting_ < out->Count()) {
+    memset((*out)[emitting_], 0, (out->Count() - emitting_) * stride);
+  }
+  // Forget the windows which are not needed anymore
+  size_t origin = emitted_ > back_? emitted_ - back_ : 0;
+  if (origin > origin_) {
+    memmove((*sequence_)[0], (*sequence_)[origin - origin_],
+            (received_ - origin) * stride);
+    origin_ = origin;
+  }
+}
+
+}  // namespace sound_feature_extraction
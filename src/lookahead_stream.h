@@ -0,0 +1,102 @@
+/*! @file lookahead_stream.h
+ *  @brief Streaming support of the transforms which look at the adjacent windows.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_LOOKAHEAD_STREAM_H_
+#define SRC_LOOKAHEAD_STREAM_H_
+
+#include <functional>
+#include <memory>
+#include "src/buffers_base.h"
+#include "src/streaming_aware.h"
+
+namespace sound_feature_extraction {
+
+/// @brief Keeps the windows of the stream for the transforms whose output
+/// depends on the neighbour windows, e.g., Delta.
+/// @details Each window is calculated once the following windows it depends
+/// on have arrived, so the output lags behind the input. The result is
+/// exactly the same as if the whole sequence of windows was processed
+/// at once, provided that the calculation aligns its blocks to the absolute
+/// window indices.
+class LookaheadStream {
+ public:
+  /// @brief Calculates the windows [first, last) of sequence and writes them
+  /// to the same positions of results. origin is the index of the first
+  /// window of sequence in the stream. If last is the end of sequence,
+  /// the stream has ended.
+  typedef std::function<void(const BuffersBase<float*>& sequence,
+                             size_t origin, size_t first, size_t last,
+                             BuffersBase<float*>* results)> Calculator;
+
+  LookaheadStream() noexcept;
+
+  /// @brief Allocates the storage and starts a new stream.
+  /// @param format The format of the windows.
+  /// @param count The number of windows in each piece.
+  /// @param back The number of the preceding windows each window depends on.
+  /// @param front The number of the following windows each window
+  /// depends on.
+  void Initialize(const std::shared_ptr<BufferFormatBase<float*>>& format,
+                  size_t count, size_t back, size_t front);
+
+  void Reset() noexcept;
+
+  /// @brief Accounts the meaningful windows of the next piece and returns
+  /// the windows which Process() will output.
+  StreamPiece Prepare(const StreamPiece& input) noexcept;
+
+  /// @brief Indicates whether some of the received windows have not been
+  /// output yet.
+  bool Pending() const noexcept;
+
+  /// @brief Appends the meaningful windows of in to the sequence and writes
+  /// the windows which can be calculated to the beginning of out.
+  void Process(const BuffersBase<float*>& in, BuffersBase<float*>* out,
+               const Calculator& calculator) noexcept;
+
+ private:
+  std::shared_ptr<BufferFormatBase<float*>> format_;
+  size_t count_;
+  size_t back_;
+  size_t front_;
+  /// @brief The windows [origin_, received_) of the stream.
+  std::unique_ptr<BuffersBase<float*>> sequence_;
+  std::unique_ptr<BuffersBase<float*>> results_;
+  size_t origin_;
+  size_t received_;
+  size_t emitted_;
+  /// @brief The part of the input of the next Process().
+  StreamPiece input_;
+  /// @brief The number of windows the next Process() outputs.
+  size_t emitting_;
+};
+
+}  // namespace sound_feature_extraction
+#endif  // SRC_LOOKAHEAD_STREAM_H_
@@ -149,7 +149,7 @@ class OmpTransformBaseBufferTypeProxy
       template TransformBase<FIN, FOUT>::OutBuffers;
 
   virtual void Do(const InBuffers& in, OutBuffers* out)
-      const noexcept override final {
+      const noexcept override {
 #ifdef HAVE_OPENMP
     #pragma omp parallel for num_threads(this->threads_number())
 #endif
@@ -175,7 +175,7 @@ class OmpTransformBaseBufferTypeProxy<FIN, FOUT, FINELEMENT, FOUTELEMENT*>
      template TransformBase<FIN, FOUT>::OutBuffers;
 
   virtual void Do(const InBuffers& in, OutBuffers* out)
-      const noexcept override final {
+      const noexcept override {
 #ifdef HAVE_OPENMP
     #pragma omp parallel for num_threads(this->threads_number())
 #endif
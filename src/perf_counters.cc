@@ -0,0 +1,207 @@
+/*! @file perf_counters.cc
+ *  @brief Per-thread hardware performance counters.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/perf_counters.h"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#include "src/safe_omp.h"
+
+namespace sound_feature_extraction {
+
+namespace {
+
+/// @brief The available counters of all the threads.
+struct PerfCountersRegistry {
+  std::mutex Mutex;
+  std::unordered_set<const PerfCounters*> Counters;
+};
+
+PerfCountersRegistry& Registry() {
+  // Never destroyed, since the thread local counters may outlive it
+  static auto registry = new PerfCountersRegistry();
+  return *registry;
+}
+
+/// @brief The number of the active executions which read the counters.
+std::atomic<int> active_executions(0);
+/// @brief The number of the executions which have started so far.
+std::atomic<uint64_t> started_executions(0);
+
+}  // namespace
+
+PerfSample& PerfSample::operator+=(const PerfSample& other) noexcept {
+  Cycles += other.Cycles;
+  Instructions += other.Instructions;
+  CacheMisses += other.CacheMisses;
+  BranchMisses += other.BranchMisses;
+  return *this;
+}
+
+PerfSample PerfSample::operator-(const PerfSample& other) const noexcept {
+  PerfSample ret;
+  ret.Cycles = Cycles - other.Cycles;
+  ret.Instructions = Instructions - other.Instructions;
+  ret.CacheMisses = CacheMisses - other.CacheMisses;
+  ret.BranchMisses = BranchMisses - other.BranchMisses;
+  return ret;
+}
+
+float PerfSample::Ipc() const noexcept {
+  return Cycles > 0? (Instructions + 0.f) / Cycles : 0.f;
+}
+
+PerfCounters::PerfCounters() noexcept {
+  for (int i = 0; i < kCountersCount; i++) {
+    fds_[i] = -1;
+  }
+#ifdef __linux__
+  const uint64_t configs[kCountersCount] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+  for (int i = 0; i < kCountersCount; i++) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The counters of this thread on any CPU
+    fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, fds_[0], 0);
+    if (fds_[i] < 0) {
+      Close();
+      return;
+    }
+  }
+  auto& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.Mutex);
+  registry.Counters.insert(this);
+#endif
+}
+
+PerfCounters::~PerfCounters() noexcept {
+  if (available()) {
+    auto& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+    registry.Counters.erase(this);
+  }
+  Close();
+}
+
+void PerfCounters::Close() noexcept {
+  for (int i = 0; i < kCountersCount; i++) {
+    if (fds_[i] >= 0) {
+      close(fds_[i]);
+    }
+    fds_[i] = -1;
+  }
+}
+
+PerfCounters& PerfCounters::ThisThread() noexcept {
+  static thread_local PerfCounters counters;
+  return counters;
+}
+
+bool PerfCounters::available() const noexcept {
+  return fds_[0] >= 0;
+}
+
+bool PerfCounters::Read(PerfSample* sample) const noexcept {
+  if (!available()) {
+    return false;
+  }
+  // PERF_FORMAT_GROUP: the number of counters followed by their values
+  uint64_t values[kCountersCount + 1];
+  if (read(fds_[0], values, sizeof(values)) !=
+      static_cast<ssize_t>(sizeof(values))) {
+    return false;
+  }
+  sample->Cycles = values[1];
+  sample->Instructions = values[2];
+  sample->CacheMisses = values[3];
+  sample->BranchMisses = values[4];
+  return true;
+}
+
+void PerfCounters::OpenWorkers(int threads) noexcept {
+  ThisThread();
+#ifdef HAVE_OPENMP
+  #pragma omp parallel num_threads(threads)
+  ThisThread();
+#else
+  static_cast<void>(threads);
+#endif
+}
+
+bool PerfCounters::ReadAll(PerfSample* sample) noexcept {
+  auto& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.Mutex);
+  *sample = PerfSample();
+  bool read = false;
+  for (auto counters : registry.Counters) {
+    PerfSample thread;
+    if (counters->Read(&thread)) {
+      *sample += thread;
+      read = true;
+    }
+  }
+  return read;
+}
+
+uint64_t PerfCounters::ExclusiveEpoch() noexcept {
+  if (active_executions != 1) {
+    return 0;
+  }
+  return started_executions;
+}
+
+PerfCounters::Execution::Execution(bool counting) noexcept
+    : counting_(counting) {
+  if (counting_) {
+    started_executions++;
+    active_executions++;
+  }
+}
+
+PerfCounters::Execution::~Execution() noexcept {
+  if (counting_) {
+    active_executions--;
+  }
+}
+
+}  // namespace sound_feature_extraction
@@ -0,0 +1,120 @@
+/*! @file perf_counters.h
+ *  @brief Per-thread hardware performance counters.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_PERF_COUNTERS_H_
+#define SRC_PERF_COUNTERS_H_
+
+#include <cstdint>
+
+namespace sound_feature_extraction {
+
+/// @brief The values of the hardware counters.
+struct PerfSample {
+  PerfSample()
+      : Cycles(0), Instructions(0), CacheMisses(0), BranchMisses(0) {
+  }
+
+  PerfSample& operator+=(const PerfSample& other) noexcept;
+  PerfSample operator-(const PerfSample& other) const noexcept;
+
+  /// @brief Instructions per cycle or 0 if no cycles were counted.
+  float Ipc() const noexcept;
+
+  uint64_t Cycles;
+  uint64_t Instructions;
+  /// @brief The last level cache misses.
+  uint64_t CacheMisses;
+  uint64_t BranchMisses;
+};
+
+/// @brief The group of the hardware counters of a single thread, opened
+/// with perf_event_open(). They are usually unavailable in containers and
+/// if /proc/sys/kernel/perf_event_paranoid forbids the user space
+/// measurements; then available() is false and nothing is counted.
+/// @details The counters of a thread do not include the work of the OpenMP
+/// workers it spawns, so the opened counters of all the threads are
+/// registered and can be summed up with ReadAll(). The sum includes every
+/// thread of the process, so it may be attributed to an execution only while
+/// no other one is active; see ExclusiveEpoch().
+class PerfCounters {
+ public:
+  /// @brief Marks an execution which reads the counters for its lifetime.
+  class Execution {
+   public:
+    explicit Execution(bool counting) noexcept;
+    Execution(const Execution&) = delete;
+    Execution& operator=(const Execution&) = delete;
+    ~Execution() noexcept;
+
+   private:
+    bool counting_;
+  };
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+  ~PerfCounters() noexcept;
+
+  /// @brief Returns the counters of the calling thread, which are opened on
+  /// the first call.
+  static PerfCounters& ThisThread() noexcept;
+
+  bool available() const noexcept;
+
+  /// @brief Reads the current values of the counters.
+  /// @return false if the counters are not available.
+  bool Read(PerfSample* sample) const noexcept;
+
+  /// @brief Opens the counters of the calling thread and of each of
+  /// the OpenMP workers of a team of the specified size.
+  static void OpenWorkers(int threads) noexcept;
+
+  /// @brief Reads the sum of the counters of all the threads which have
+  /// opened them, including the OpenMP workers opened with OpenWorkers().
+  /// @return false if the counters are not available.
+  static bool ReadAll(PerfSample* sample) noexcept;
+
+  /// @brief Returns the number of the executions started so far if only one
+  /// is active, otherwise 0. If the value is not 0 and remains the same
+  /// after ReadAll(), no other execution has run in between.
+  static uint64_t ExclusiveEpoch() noexcept;
+
+ private:
+  PerfCounters() noexcept;
+  void Close() noexcept;
+
+  static constexpr int kCountersCount = 4;
+
+  /// @brief The file descriptors, the first one is the group leader.
+  int fds_[kCountersCount];
+};
+
+}  // namespace sound_feature_extraction
+
+#endif  // SRC_PERF_COUNTERS_H_
@@ -0,0 +1,76 @@
+/*! @file streaming_aware.cc
+ *  @brief Interface of the transforms which support the streaming mode.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/streaming_aware.h"
+#include <algorithm>
+
+namespace sound_feature_extraction {
+
+StreamingAware::StreamingAware() noexcept : streaming_(false) {
+}
+
+bool StreamingAware::streaming() const noexcept {
+  return streaming_;
+}
+
+void StreamingAware::set_streaming(bool value) {
+  streaming_ = value;
+}
+
+bool StreamingAware::SplitsStream() const noexcept {
+  return false;
+}
+
+size_t StreamingAware::StreamDelay() const noexcept {
+  return 0;
+}
+
+size_t StreamingAware::StreamedSize(size_t validInput) const noexcept {
+  return validInput;
+}
+
+bool StreamingAware::StreamsWindows() const noexcept {
+  return false;
+}
+
+StreamPiece StreamingAware::PrepareStreamPiece(
+    const StreamPiece& input) const noexcept {
+  StreamPiece output;
+  output.Valid = StreamedSize(input.Valid);
+  output.Skip = std::min(input.Skip, output.Valid);
+  output.Last = input.Last;
+  return output;
+}
+
+bool StreamingAware::StreamPending() const noexcept {
+  return false;
+}
+
+}  // namespace sound_feature_extraction
@@ -0,0 +1,115 @@
+/*! @file streaming_aware.h
+ *  @brief Interface of the transforms which support the streaming mode.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_STREAMING_AWARE_H_
+#define SRC_STREAMING_AWARE_H_
+
+#include <cstddef>
+#include <string>
+#include "src/exceptions.h"
+
+namespace sound_feature_extraction {
+
+/// @brief This exception is thrown when the piece of the stream can not be
+/// split into the whole number of steps.
+class InvalidStreamedPieceSizeException : public ExceptionBase {
+ public:
+  InvalidStreamedPieceSizeException(size_t size, int step)
+  : ExceptionBase("Streamed piece size " + std::to_string(size) +
+                  " is not divisible by the step " +
+                  std::to_string(step) + ".") {
+  }
+};
+
+/// @brief The meaningful part of the output of a node in the streaming mode.
+struct StreamPiece {
+  /// @brief The number of the leading buffers which must be discarded.
+  size_t Skip;
+  /// @brief The number of the meaningful buffers (samples for the continuous
+  /// signal), including the skipped ones.
+  size_t Valid;
+  /// @brief Indicates whether the stream ends with this piece.
+  bool Last;
+};
+
+/// @brief All transforms which are able to process the signal piece by piece
+/// in TransformTree's streaming mode should inherit from this.
+/// @details In the streaming mode, Do() is passed the sequential pieces of
+/// the same signal and must carry between the calls whatever it needs
+/// (filter state, overlap) to produce exactly the same output as if the whole
+/// signal was passed at once.
+class StreamingAware {
+ public:
+  StreamingAware() noexcept;
+  virtual ~StreamingAware() = default;
+
+  bool streaming() const noexcept;
+  /// @brief Switches the streaming mode. It must be called before
+  /// SetInputFormat(), since the output format may depend on it.
+  virtual void set_streaming(bool value);
+
+  /// @brief Forgets everything carried from the previous pieces.
+  virtual void ResetStream() const = 0;
+
+  /// @brief Indicates whether the output is the sequence of windows rather
+  /// than the continuous signal.
+  virtual bool SplitsStream() const noexcept;
+
+  /// @brief The number of output buffers at the beginning of the stream
+  /// which do not correspond to any input and must be discarded.
+  virtual size_t StreamDelay() const noexcept;
+
+  /// @brief Returns the amount of the meaningful output provided that only
+  /// the first validInput samples of the piece are meaningful (the rest is
+  /// the padding at the end of the stream).
+  /// @details The amount is measured in samples for the continuous signal and
+  /// in buffers for the windows.
+  virtual size_t StreamedSize(size_t validInput) const noexcept;
+
+  /// @brief Indicates whether the transform processes the sequence of
+  /// windows rather than the continuous signal in the streaming mode.
+  virtual bool StreamsWindows() const noexcept;
+
+  /// @brief Returns the meaningful part of the output of the next Do(),
+  /// provided that the meaningful part of its input is "input". It is called
+  /// exactly once before each Do() in the streaming mode.
+  virtual StreamPiece PrepareStreamPiece(const StreamPiece& input) const
+      noexcept;
+
+  /// @brief Indicates whether the transform holds the input which has not
+  /// been output yet, so that the ended stream must be drained.
+  virtual bool StreamPending() const noexcept;
+
+ private:
+  bool streaming_;
+};
+
+}  // namespace sound_feature_extraction
+#endif  // SRC_STREAMING_AWARE_H_
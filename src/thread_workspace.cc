@@ -0,0 +1,99 @@
+/*! @file thread_workspace.cc
+ *  @brief Lock-free per-thread scratch storage for the transforms.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/thread_workspace.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace sound_feature_extraction {
+
+namespace {
+
+/// @brief Assigns the smallest free slot to each new thread. The mutex is
+/// taken only when a thread starts or finishes using the workspaces.
+class ThreadSlots {
+ public:
+  ThreadSlots() : next_(0) {
+  }
+
+  int Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+      return next_++;
+    }
+    std::pop_heap(free_.begin(), free_.end(), std::greater<int>());
+    int slot = free_.back();
+    free_.pop_back();
+    return slot;
+  }
+
+  void Release(int slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(slot);
+    std::push_heap(free_.begin(), free_.end(), std::greater<int>());
+  }
+
+  static ThreadSlots& Instance() {
+    // Intentionally leaked: the threads may finish after the static
+    // destructors are run
+    static ThreadSlots* instance = new ThreadSlots();
+    return *instance;
+  }
+
+ private:
+  std::mutex mutex_;
+  int next_;
+  std::vector<int> free_;
+};
+
+struct ThreadSlot {
+  ThreadSlot() : Index(ThreadSlots::Instance().Acquire()) {
+  }
+
+  ~ThreadSlot() {
+    ThreadSlots::Instance().Release(Index);
+  }
+
+  int Index;
+};
+
+}  // namespace
+
+constexpr int ThreadWorkspaceBase::kChunkSize;
+constexpr int ThreadWorkspaceBase::kMaxChunks;
+
+int ThreadWorkspaceBase::CurrentThreadSlot() noexcept {
+  static thread_local ThreadSlot slot;
+  return slot.Index;
+}
+
+}  // namespace sound_feature_extraction
@@ -0,0 +1,148 @@
+/*! @file thread_workspace.h
+ *  @brief Lock-free per-thread scratch storage for the transforms.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_THREAD_WORKSPACE_H_
+#define SRC_THREAD_WORKSPACE_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace sound_feature_extraction {
+
+class ThreadWorkspaceBase {
+ protected:
+  /// @brief Returns the index of the calling thread which is unique among
+  /// the running threads. The indices of the finished threads are reused,
+  /// so they stay small.
+  static int CurrentThreadSlot() noexcept;
+
+  static constexpr int kChunkSize = 64;
+  static constexpr int kMaxChunks = 64;
+};
+
+/// @brief Keeps a separate item of type T for each thread which calls Get(),
+/// e.g., a scratch buffer or a filter executor. Get() does not take any
+/// locks, so the transforms can use it in Do() under heavy contention.
+/// @details The items are created by the factory on the first Get() in
+/// the owning thread. They are stored in the chunks of kChunkSize slots;
+/// the chunks for the expected number of threads are allocated by Reset()
+/// and the rest are atomically added on demand. The threads beyond
+/// kChunkSize * kMaxChunks fall back to a map under a mutex.
+template <class T>
+class ThreadWorkspace : public ThreadWorkspaceBase {
+ public:
+  typedef std::function<T()> Factory;
+
+  ThreadWorkspace() noexcept {
+    for (auto& chunk : chunks_) {
+      chunk.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ThreadWorkspace(const ThreadWorkspace&) = delete;
+  ThreadWorkspace& operator=(const ThreadWorkspace&) = delete;
+
+  ~ThreadWorkspace() {
+    Clear();
+  }
+
+  /// @brief Discards the items of all the threads. It must not be called
+  /// simultaneously with Get().
+  /// @param factory The function which creates a new item.
+  /// @param threads The expected number of threads.
+  void Reset(const Factory& factory, int threads) {
+    Clear();
+    factory_ = factory;
+    for (int i = 0; i < (threads + kChunkSize - 1) / kChunkSize &&
+                    i < kMaxChunks; i++) {
+      chunks_[i].store(new Chunk(), std::memory_order_release);
+    }
+  }
+
+  /// @brief Returns the item of the calling thread.
+  /// @details The first call in a thread creates the item, so it throws what
+  /// the factory or the allocation throws, e.g., std::bad_alloc. It is not
+  /// caught, so that in the noexcept Do() of a transform it terminates
+  /// the program the same way as any other failed allocation there.
+  T& Get() {
+    int slot = CurrentThreadSlot();
+    if (slot >= kChunkSize * kMaxChunks) {
+      std::lock_guard<std::mutex> lock(overflow_mutex_);
+      auto& item = overflow_[slot];
+      if (item == nullptr) {
+        item.reset(new T(factory_()));
+      }
+      return *item;
+    }
+    auto& cell = chunks_[slot / kChunkSize];
+    Chunk* chunk = cell.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      Chunk* fresh = new Chunk();
+      if (cell.compare_exchange_strong(chunk, fresh,
+                                       std::memory_order_acq_rel)) {
+        chunk = fresh;
+      } else {
+        delete fresh;
+      }
+    }
+    auto& item = chunk->Items[slot % kChunkSize];
+    if (item == nullptr) {
+      item.reset(new T(factory_()));
+    }
+    return *item;
+  }
+
+  /// @brief Destroys all the items.
+  void Clear() noexcept {
+    for (auto& chunk : chunks_) {
+      delete chunk.exchange(nullptr, std::memory_order_acq_rel);
+    }
+    std::lock_guard<std::mutex> lock(overflow_mutex_);
+    overflow_.clear();
+  }
+
+ private:
+  struct Chunk {
+    /// @brief Each slot is written only by its thread.
+    std::unique_ptr<T> Items[kChunkSize];
+  };
+
+  Factory factory_;
+  std::atomic<Chunk*> chunks_[kMaxChunks];
+  /// @brief The items of the threads which do not fit into the chunks.
+  std::unordered_map<int, std::unique_ptr<T>> overflow_;
+  std::mutex overflow_mutex_;
+};
+
+}  // namespace sound_feature_extraction
+#endif  // SRC_THREAD_WORKSPACE_H_
@@ -66,9 +66,9 @@ bool Transform::operator==(const Transform& other) const noexcept {
 
 std::string Transform::SafeName() const noexcept {
   return replace_all_copy(replace_all_copy(replace_all_copy(replace_all_copy(
-      replace_all_copy(replace_all_copy(
+      replace_all_copy(replace_all_copy(replace_all_copy(
       Name(), " ", ""), "->", "To"), "!", ""), ">", "_"), "<", "_"),
-      "*", "Array");
+      "*", "Array"), "+", "_");
 }
 
 std::string Transform::HtmlEscapedName() const noexcept {
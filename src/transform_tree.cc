@@ -33,15 +33,24 @@
 #include <cmath>
 #include <cstdlib>
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
 #include <iomanip>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <unordered_set>
 #include <utility>
-#include "src/allocators/sliding_blocks_allocator.h"
+#include "src/allocators/heuristic_allocator.h"
+#include "src/cpu_cache.h"
 #include "src/formats/array_format.h"
 #include "src/format_converter.h"
 #include "src/transform_registry.h"
+#include "src/fusable.h"
 #include "src/memory_protector.h"
+#include "src/safe_omp.h"
+#include "src/transforms/fused.h"
 #include "src/transforms/identity.h"
 
 #if (__GNUC__ == 4 && __GNUC_MINOR__ < 8)
@@ -54,10 +63,31 @@
 
 extern "C" {
 extern size_t get_cpu_cache_size(void);
+extern int get_omp_transforms_max_threads_num(void);
 }
 
 namespace sound_feature_extraction {
 
+/// @brief Returns the small number which identifies the calling thread
+/// in the statistics.
+static int StatisticsThreadId() noexcept {
+  static std::atomic<int> next(0);
+  static thread_local int id = next++;
+  return id;
+}
+
+/// @brief Quotes and escapes the string for JSON.
+static std::string JsonString(const std::string& str) {
+  std::string ret = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      ret += '\\';
+    }
+    ret += c;
+  }
+  return ret + "\"";
+}
+
 class RootTransform : public Transform {
  public:
   explicit RootTransform(
@@ -124,6 +154,28 @@ class RootTransform : public Transform {
   std::shared_ptr<formats::ArrayFormat16> format_;
 };
 
+ExecutionContext::ExecutionContext(const TransformTree* tree) noexcept
+    : tree_(tree), allocated_size_(0), executions_(0), check_canaries_(false),
+      collect_statistics_(false), collect_counters_(false) {
+}
+
+std::vector<ExecutionContext::NodeStatistics>
+ExecutionContext::StatisticsSnapshot() const {
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  return statistics_;
+}
+
+ExecutionContext::~ExecutionContext() {
+  // The plans are bound to the buffers' addresses, which may be reused
+  if (plan_cache_ != nullptr) {
+    plan_cache_->Evict(allocated_memory_.get(), allocated_size_);
+  }
+}
+
+const TransformTree* ExecutionContext::tree() const noexcept {
+  return tree_;
+}
+
 TransformTree::Node::Node(Node* parent,
                           const std::shared_ptr<Transform>& boundTransform,
                           size_t buffersCount, TransformTree* host) noexcept
@@ -132,14 +184,16 @@ TransformTree::Node::Node(Node* parent,
       Host(host == nullptr? parent == nullptr? nullptr : parent->Host : host),
       Parent(parent),
       BoundTransform(boundTransform),
-      BoundBuffers(nullptr),
       BuffersCount(buffersCount),
-      Protection(nullptr),
+      ResidentBuffersCount(buffersCount),
+      Index(0),
+      Offset(0),
       Next(nullptr),
       OriginalNode(nullptr),
+      SliceIndex(0),
       CycleId(0),
       HasClones(false),
-      ElapsedTime(new std::chrono::high_resolution_clock::duration()) {
+      StreamContinuous(false) {
 }
 
 void TransformTree::Node::ActionOnEachTransformInSubtree(
@@ -214,85 +268,152 @@ TransformTree::Node::FindIdenticalChildTransform(
 
 void TransformTree::Node::BuildAllocationTree(
     memory_allocation::Node* node) const noexcept {
-  DBG("Requires %zu bytes",
-      BuffersCount * BoundTransform->OutputFormat()->SizeInBytes());
-  node->Children.reserve(ChildrenCount());
-  for (auto& subnodes : Children) {
-    for (auto& inode : subnodes.second) {
-      size_t size =  inode->BuffersCount *
-          inode->BoundTransform->OutputFormat()->SizeInBytes();
-      memory_allocation::Node child(size, node, inode.get());
-      node->Children.push_back(child);
-      inode->BuildAllocationTree(&node->Children.back());
+  DBG("Requires %zu bytes", AllocatedSize());
+  std::vector<Node*> children;
+  auto add_child = [&children](const Node& child) {
+    // The other members of a cycle belong to the leader's block
+    if (child.CycleId == 0 || child.IsCycleLeader()) {
+      children.push_back(const_cast<Node*>(&child));
     }
+  };
+  if (IsCycleLeader()) {
+    // The block is released after all the outer children have finished,
+    // so they are attached to it
+    for (auto member : Host->cycles_[CycleId - 1].Members) {
+      const Node* cmember = member;
+      cmember->ActionOnEachImmediateChild([&](const Node& child) {
+        if (child.CycleId != CycleId) {
+          add_child(child);
+        }
+      });
+    }
+  } else {
+    ActionOnEachImmediateChild(add_child);
+  }
+  node->Children.reserve(children.size());
+  for (auto child : children) {
+    size_t size = child->IsCycleLeader()?
+        Host->cycles_[child->CycleId - 1].Size : child->AllocatedSize();
+    node->Children.push_back(memory_allocation::Node(size, node, child));
+    child->BuildAllocationTree(&node->Children.back());
   }
 }
 
 void TransformTree::Node::ApplyAllocationTree(
-    const memory_allocation::Node& node,
-    void* allocatedMemory) noexcept {
-  auto mem_ptr = reinterpret_cast<char*>(allocatedMemory) + node.Address;
-  BoundBuffers = BoundTransform->CreateOutputBuffers(
-      BuffersCount, mem_ptr);
+    const memory_allocation::Node& node) noexcept {
+  Offset = node.Address;
   if (node.Next != nullptr) {
     Next = reinterpret_cast<TransformTree::Node*>(node.Next->Item);
   }
+  if (IsCycleLeader()) {
+    // Place the members one after another in the block and execute them
+    // in a row
+    auto& members = Host->cycles_[CycleId - 1].Members;
+    for (size_t i = 1; i < members.size(); i++) {
+      members[i]->Offset = members[i - 1]->Offset +
+          members[i - 1]->AllocatedSize();
+      members[i]->Next = members[i - 1]->Next;
+      members[i - 1]->Next = members[i];
+    }
+  }
 
   for (size_t i = 0; i < node.Children.size(); i++) {
     TransformTree::Node* child = reinterpret_cast<TransformTree::Node*>(
         node.Children[i].Item);
-    child->ApplyAllocationTree(node.Children[i], allocatedMemory);
+    child->ApplyAllocationTree(node.Children[i]);
   }
 }
 
-void TransformTree::Node::Execute() noexcept {
+void TransformTree::Node::Execute(ExecutionContext* context) const {
   if (Parent != nullptr) {
+    auto& bound_buffers = context->buffers_[Index];
+    auto parent_buffers = ParentBuffers(*context);
     DBG("Executing %s on %zu buffers -> %zu...",
         BoundTransform->Name().c_str(),
-        Parent->BoundBuffers->Count(), BoundBuffers->Count());
-    auto checkPointStart = std::chrono::high_resolution_clock::now();
-    std::shared_ptr<Buffers> parent_buffers;
-    if (Parent->Slices.size() == 0 || OriginalNode == nullptr) {
-      parent_buffers = Parent->BoundBuffers;
-    } else {
-      size_t index, length;
-      std::tie(index, length) = Parent->Slices[this];
-      assert(length > 0);
-      parent_buffers = std::make_shared<Buffers>(
-          Parent->BoundBuffers->Slice(index, length));
+        parent_buffers->Count(), bound_buffers->Count());
+    auto canary = context->check_canaries_? Canary(*context) : nullptr;
+    if (canary != nullptr) {
+      *canary = kCanaryValue;
+    }
+    // The transform may run on the OpenMP workers. The counters of all
+    // the threads of the process are summed up only if the other branches
+    // are not executed simultaneously and no other execution (e.g., of
+    // another context or a batch worker) runs during the node; otherwise only
+    // the executing thread is counted.
+    uint64_t epoch = 0;
+    PerfSample this_start, all_start;
+    bool counted = context->collect_counters_ &&
+        PerfCounters::ThisThread().Read(&this_start);
+    if (counted && Host->branch_threads_number_ == 1) {
+      epoch = PerfCounters::ExclusiveEpoch();
+      if (epoch != 0 && !PerfCounters::ReadAll(&all_start)) {
+        epoch = 0;
+      }
     }
-    BoundTransform->Do(*parent_buffers, BoundBuffers.get());
+    auto checkPointStart = std::chrono::high_resolution_clock::now();
+    BoundTransform->Do(*parent_buffers, bound_buffers.get());
     auto checkPointFinish = std::chrono::high_resolution_clock::now();
-    *ElapsedTime += checkPointFinish - checkPointStart;
-    Host->transforms_cache_[BoundTransform->Name()].ElapsedTime += *ElapsedTime;
+    PerfSample counters_start = this_start, counters_finish;
+    if (counted) {
+      if (epoch != 0 && PerfCounters::ReadAll(&counters_finish) &&
+          PerfCounters::ExclusiveEpoch() == epoch) {
+        counters_start = all_start;
+      } else {
+        counted = PerfCounters::ThisThread().Read(&counters_finish);
+      }
+    }
+    // A worker which exits in between takes its counts away
+    if (counted &&
+        counters_finish.Cycles >= counters_start.Cycles &&
+        counters_finish.Instructions >= counters_start.Instructions) {
+      std::lock_guard<std::mutex> lock(context->statistics_mutex_);
+      context->statistics_[Index].Counters += counters_finish - counters_start;
+    }
+    if (canary != nullptr && *canary != kCanaryValue) {
+      throw BufferOverrunException(BoundTransform->Name());
+    }
+    // Each node writes only to its own timer, so that the independent
+    // nodes can be executed simultaneously; see AccumulateTimes()
+    context->elapsed_times_[Index] = checkPointFinish - checkPointStart;
+    if (context->collect_statistics_) {
+      std::lock_guard<std::mutex> lock(context->statistics_mutex_);
+      auto& stats = context->statistics_[Index];
+      stats.LastStart = checkPointStart - context->execution_start_;
+      stats.LastDuration = checkPointFinish - checkPointStart;
+      stats.Latency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          stats.LastDuration).count());
+      stats.BytesIn = parent_buffers->SizeInBytes();
+      stats.BytesOut = bound_buffers->SizeInBytes();
+      stats.Thread = StatisticsThreadId();
+    }
 
-    if (Host->memory_protection() && ChildrenCount() == 0 &&
+    if (Host->guard_mode_ == GuardMode::kProtect && ChildrenCount() == 0 &&
         OriginalNode == nullptr) {
       // This is a leaf, disable any further writing to the corr. memory block
-      auto ptr = std::const_pointer_cast<const Buffers>(BoundBuffers)->Data();
+      auto ptr = std::const_pointer_cast<const Buffers>(bound_buffers)->Data();
       DBG("Enabling write protection on %p:%zu",
-          ptr, BoundBuffers->SizeInBytes());
-      Protection = std::make_shared<MemoryProtector>(
-          ptr, BoundBuffers->SizeInBytes());
+          ptr, bound_buffers->SizeInBytes());
+      context->protections_[Index] = std::make_shared<MemoryProtector>(
+          ptr, bound_buffers->SizeInBytes());
     }
 
     if (Host->validate_after_each_transform()) {
       try {
-        BoundBuffers->Validate();
+        bound_buffers->Validate();
       }
       catch(const InvalidBuffersException& e) {
 #ifdef DEBUG
-        if (BoundBuffers->Count() == Parent->BoundBuffers->Count()) {
+        if (bound_buffers->Count() == parent_buffers->Count()) {
           ERR("Validation failed on index %zu.\n----before----\n%s\n\n"
               "----after----\n%s\n",
               e.index(),
               parent_buffers->Dump(e.index()).c_str(),
-              BoundBuffers->Dump(e.index()).c_str());
+              bound_buffers->Dump(e.index()).c_str());
         } else {
           ERR("Validation failed.\n----Buffers before----\n%s\n\n"
               "----Buffers after----\n%s\n",
               parent_buffers->Dump().c_str(),
-              BoundBuffers->Dump().c_str());
+              bound_buffers->Dump().c_str());
         }
 #endif
         throw TransformResultedInInvalidBuffersException(BoundTransform->Name(),
@@ -300,17 +421,28 @@ void TransformTree::Node::Execute() noexcept {
       }
     }
 
-    if (Host->transforms_cache_[BoundTransform->Name()].Dump ||
+    if (Host->transforms_cache_.find(BoundTransform->Name())->second.Dump ||
         Host->dump_buffers_after_each_transform()) {
       INF("Buffers after %s", BoundTransform->Name().c_str());
       INF("==============%s",
           std::string(BoundTransform->Name().size(), '=').c_str());
-      INF("%s", BoundBuffers->Dump().c_str());
+      INF("%s", bound_buffers->Dump().c_str());
     }
   }
-  if (Next) {
-    Next->Execute();
+}
+
+std::shared_ptr<Buffers> TransformTree::Node::ParentBuffers(
+    const ExecutionContext& context) const noexcept {
+  assert(Parent != nullptr);
+  auto& parent_buffers = context.buffers_[Parent->Index];
+  if (Parent->Slices.size() == 0 || OriginalNode == nullptr) {
+    return parent_buffers;
   }
+  size_t index, length;
+  std::tie(index, length) = Parent->Slices.find(
+      const_cast<Node*>(this))->second;
+  assert(length > 0);
+  return std::make_shared<Buffers>(parent_buffers->Slice(index, length));
 }
 
 size_t TransformTree::Node::ChildrenCount() const noexcept {
@@ -332,6 +464,54 @@ std::shared_ptr<TransformTree::Node> TransformTree::Node::SelfPtr()
   return nullptr;
 }
 
+size_t TransformTree::Node::AllocatedSize() const noexcept {
+  return ResidentBuffersCount * BoundTransform->OutputFormat()->SizeInBytes() +
+      Host->canary_size_;
+}
+
+uint64_t* TransformTree::Node::Canary(
+    const ExecutionContext& context) const noexcept {
+  auto original = OriginalNode != nullptr? OriginalNode : this;
+  if (Host->canary_size_ == 0 ||
+      SliceIndex + BuffersCount != original->ResidentBuffersCount) {
+    // Only the last slice of a cycle ends at the canary
+    return nullptr;
+  }
+  auto size = original->ResidentBuffersCount *
+      BoundTransform->OutputFormat()->SizeInBytes();
+  return reinterpret_cast<uint64_t*>(
+      reinterpret_cast<char*>(context.allocated_memory_.get()) +
+      original->Offset + size);
+}
+
+bool TransformTree::Node::IsCycleLeader() const noexcept {
+  return CycleId > 0 && OriginalNode == nullptr &&
+      Host->cycles_[CycleId - 1].Members.front() == this;
+}
+
+size_t TransformTree::Node::SliceWorkingSet(size_t held) const noexcept {
+  auto input = BoundTransform->InputFormat()->SizeInBytes();
+  auto ret = held + input + BoundTransform->OutputFormat()->SizeInBytes();
+  // The input is read by the other members, so it must stay in the cache
+  // while this subtree is executed
+  int readers = 0;
+  const Node* parent = Parent;
+  parent->ActionOnEachImmediateChild([this, &readers](const Node& child) {
+    if (child.CycleId == CycleId) {
+      readers++;
+    }
+  });
+  if (readers > 1) {
+    held += input;
+  }
+  ActionOnEachImmediateChild([&](const Node& child) {
+    if (child.CycleId == CycleId) {
+      ret = std::max(ret, child.SliceWorkingSet(held));
+    }
+  });
+  return ret;
+}
+
 TransformTree::TransformTree(formats::ArrayFormat16&& rootFormat) noexcept
     : Logger("TransformTree", EINA_COLOR_ORANGE),
       root_(std::make_shared<Node>(
@@ -339,10 +519,23 @@ TransformTree::TransformTree(formats::ArrayFormat16&& rootFormat) noexcept
             std::make_shared<formats::ArrayFormat16>(rootFormat)), 1, this)),
       root_format_(std::make_shared<formats::ArrayFormat16>(rootFormat)),
       tree_is_prepared_(false),
+      needed_memory_(0),
+      nodes_count_(0),
+      allocator_(std::make_shared<memory_allocation::HeuristicAllocator>()),
+      branch_threads_number_(1),
+      collect_statistics_(false),
+      perf_counters_(false),
+      fftf_plans_(std::make_shared<FFTFPlanCache>()),
       cache_optimization_(true),
-      memory_protection_(true),
+      fusion_(true),
+      cache_level_(kDefaultCacheLevel),
+      guard_mode_(GuardMode::kCanary),
+      guard_sampling_period_(kDefaultGuardSamplingPeriod),
+      canary_size_(0),
+      streaming_(false),
       validate_after_each_transform_(false),
       dump_buffers_after_each_transform_(false) {
+  root_->StreamContinuous = true;
 }
 
 TransformTree::TransformTree(
@@ -352,10 +545,23 @@ TransformTree::TransformTree(
         nullptr, std::make_shared<RootTransform>(rootFormat), 1, this)),
       root_format_(rootFormat),
       tree_is_prepared_(false),
+      needed_memory_(0),
+      nodes_count_(0),
+      allocator_(std::make_shared<memory_allocation::HeuristicAllocator>()),
+      branch_threads_number_(1),
+      collect_statistics_(false),
+      perf_counters_(false),
+      fftf_plans_(std::make_shared<FFTFPlanCache>()),
       cache_optimization_(true),
-      memory_protection_(true),
+      fusion_(true),
+      cache_level_(kDefaultCacheLevel),
+      guard_mode_(GuardMode::kCanary),
+      guard_sampling_period_(kDefaultGuardSamplingPeriod),
+      canary_size_(0),
+      streaming_(false),
       validate_after_each_transform_(false),
       dump_buffers_after_each_transform_(false) {
+  root_->StreamContinuous = true;
 }
 
 std::shared_ptr<formats::ArrayFormat16> TransformTree::RootFormat()
@@ -363,6 +569,29 @@ std::shared_ptr<formats::ArrayFormat16> TransformTree::RootFormat()
   return root_format_;
 }
 
+std::vector<std::string> TransformTree::FeatureNames() const noexcept {
+  std::vector<std::string> names;
+  names.reserve(features_.size());
+  for (auto& feature : features_) {
+    names.push_back(feature.first);
+  }
+  return names;
+}
+
+std::unordered_map<std::string, size_t> TransformTree::FeatureSizes()
+    const noexcept {
+  std::unordered_map<std::string, size_t> sizes;
+  for (auto& feature : features_) {
+    sizes[feature.first] = feature.second->BuffersCount *
+        feature.second->BoundTransform->OutputFormat()->UnalignedSizeInBytes();
+  }
+  return sizes;
+}
+
+size_t TransformTree::NeededMemory() const noexcept {
+  return needed_memory_;
+}
+
 void TransformTree::AddTransform(const std::string& name,
                                  const std::string& parameters,
                                  const std::string& relatedFeature,
@@ -414,6 +643,10 @@ void TransformTree::AddTransform(const std::string& name,
     auto tparams = Transform::Parse(parameters);
     t->SetParameters(tparams);
   }
+  bool stream_continuous = false;
+  if (streaming_) {
+    stream_continuous = SetupStreaming(**currentNode, t.get());
+  }
   // Try to reuse an existing node
   auto reused_node = (*currentNode)->FindIdenticalChildTransform(*t);
   if (reused_node != nullptr) {
@@ -440,16 +673,18 @@ void TransformTree::AddTransform(const std::string& name,
     // Append the newly created transform
     auto new_node = std::make_shared<Node>(currentNode->get(), t, buffers_count,
                                            this);
+    new_node->StreamContinuous = stream_continuous;
     (*currentNode)->Children[name].push_back(new_node);
     *currentNode = new_node;
   }
   (*currentNode)->RelatedFeatures.push_back(relatedFeature);
 
   // Search for the environment variable to activate dumps for this transform
+  auto& cache_item = transforms_cache_[name];
   auto dump_val = std::getenv((std::string(kDumpEnvPrefix) + name).c_str());
   if (dump_val != nullptr && !strncmp(dump_val, "true", 4)) {
     DBG("Activated dump of %s", name.c_str());
-    transforms_cache_[name].Dump = true;
+    cache_item.Dump = true;
   }
 }
 
@@ -484,114 +719,570 @@ void TransformTree::AddFeature(
   features_.insert(std::make_pair(name, current_node));
 }
 
-int TransformTree::BuildSlicedCycles() noexcept {
-  int ret = 0;  // the resulting number of built cycles
-  auto node = root_.get();
-  decltype(node) prev_node = nullptr;
-  while (node != nullptr) {
-    // Search for the next cycle entry candidate
-    do {
-      prev_node = node;
-      node = node->Next;
+bool TransformTree::SetupStreaming(const Node& parent, Transform* transform) {
+  if (transform->Name() == transforms::Identity::kName) {
+    return parent.StreamContinuous;
+  }
+  auto streaming = dynamic_cast<StreamingAware*>(transform);
+  if (parent.StreamContinuous) {
+    // The transform receives the sequential pieces of the signal
+    if (streaming != nullptr && !streaming->StreamsWindows()) {
+      streaming->set_streaming(true);
+      return !streaming->SplitsStream();
     }
-    while (node != nullptr && (!node->BoundTransform->BufferInvariant() ||
-        node->ChildrenCount() == 0));
-    if (node == nullptr) {
-      break;
+    if (dynamic_cast<FormatConverter*>(transform) != nullptr) {
+      return true;
+    }
+    throw TransformIsNotStreamableException(transform->Name());
+  }
+  // The transform receives the windows, it must either process each
+  // independently or carry the neighbours between the pieces
+  if (streaming != nullptr && streaming->StreamsWindows()) {
+    streaming->set_streaming(true);
+    return false;
+  }
+  if (!transform->BufferInvariant()) {
+    throw TransformIsNotStreamableException(transform->Name());
+  }
+  return false;
+}
+
+void TransformTree::CheckFeatureStreams() const {
+  for (auto& feature : features_) {
+    if (feature.second->StreamContinuous) {
+      throw FeatureIsNotSplitException(feature.first);
+    }
+  }
+}
+
+std::vector<TransformTree::Node*> TransformTree::NodesInOrder() const {
+  std::vector<Node*> nodes;
+  root_->ActionOnSubtree([&nodes](Node& node) {
+    nodes.push_back(&node);
+  });
+  return nodes;
+}
+
+TransformTree::AllocationPlan TransformTree::RecordAllocationPlan() const {
+  auto nodes = NodesInOrder();
+  std::unordered_map<const Node*, int> indices;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    indices[nodes[i]] = i;
+  }
+  AllocationPlan plan;
+  plan.NeededMemory = needed_memory_;
+  for (auto node : nodes) {
+    AllocationPlan::Entry entry;
+    entry.Name = node->BoundTransform->Name();
+    entry.Parent = node->Parent != nullptr? indices[node->Parent] : -1;
+    entry.Size = node->AllocatedSize();
+    entry.Offset = node->Offset;
+    entry.Next = node->Next != nullptr? indices[node->Next] : -1;
+    entry.Cycle = node->CycleId;
+    plan.Entries.push_back(entry);
+  }
+  return plan;
+}
+
+bool TransformTree::ApplyAllocationPlan(const AllocationPlan& plan) {
+  if (plan.Entries.empty()) {
+    return false;
+  }
+  auto nodes = NodesInOrder();
+  if (nodes.size() != plan.Entries.size()) {
+    WRN("The allocation plan has %zu nodes while the tree has %zu",
+        plan.Entries.size(), nodes.size());
+    return false;
+  }
+  std::unordered_map<const Node*, int> indices;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    indices[nodes[i]] = i;
+  }
+  for (size_t i = 0; i < nodes.size(); i++) {
+    auto& entry = plan.Entries[i];
+    auto node = nodes[i];
+    int parent = node->Parent != nullptr? indices[node->Parent] : -1;
+    // The cycles must match since their members are placed together
+    if (entry.Name != node->BoundTransform->Name() || entry.Parent != parent ||
+        entry.Size != node->AllocatedSize() || entry.Cycle != node->CycleId ||
+        entry.Next < -1 ||
+        entry.Next >= static_cast<int>(nodes.size()) ||
+        entry.Offset + entry.Size > plan.NeededMemory) {
+      WRN("The allocation plan does not match node %zu (%s)", i,
+          node->BoundTransform->Name().c_str());
+      return false;
     }
-    // Grow the cycle
-    std::vector<Node*> current_cycle;
-    do {
-      current_cycle.push_back(node);
-      node = node->Next;
+  }
+  if (!ValidateAllocationPlan(plan, nodes)) {
+    WRN("The allocation plan places the live buffers at the same memory");
+    return false;
+  }
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodes[i]->Offset = plan.Entries[i].Offset;
+    nodes[i]->Next = plan.Entries[i].Next >= 0?
+        nodes[plan.Entries[i].Next] : nullptr;
+  }
+  needed_memory_ = plan.NeededMemory;
+  return true;
+}
+
+bool TransformTree::ValidateAllocationPlan(
+    const AllocationPlan& plan, const std::vector<Node*>& nodes) const {
+  std::unordered_map<const Node*, int> indices;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    indices[nodes[i]] = i;
+  }
+  // The cycle members are placed one after another in the leader's block
+  for (auto& cycle : cycles_) {
+    for (size_t i = 1; i < cycle.Members.size(); i++) {
+      auto prev = indices.find(cycle.Members[i - 1]);
+      auto member = indices.find(cycle.Members[i]);
+      if (prev == indices.end() || member == indices.end() ||
+          plan.Entries[member->second].Offset !=
+              plan.Entries[prev->second].Offset +
+              plan.Entries[prev->second].Size) {
+        return false;
+      }
     }
-    while (node != nullptr && node->BoundTransform->BufferInvariant() &&
-           node->ChildrenCount() > 0);
-    if (node != nullptr && node->BoundTransform->BufferInvariant() &&
-        node->ChildrenCount() == 0) {
-      current_cycle.push_back(node);
-      node = node->Next;
+  }
+  // Build the same tree which the allocator solves and fill it with the plan
+  memory_allocation::Node allocation_tree_root(0, nullptr, root_.get());
+  root_->BuildAllocationTree(&allocation_tree_root);
+  std::unordered_map<const void*, memory_allocation::Node*> blocks;
+  std::vector<memory_allocation::Node*> pending { &allocation_tree_root };
+  while (!pending.empty()) {
+    auto block = pending.back();
+    pending.pop_back();
+    blocks[block->Item] = block;
+    block->Address = plan.Entries[
+        indices[reinterpret_cast<const Node*>(block->Item)]].Offset;
+    for (auto& child : block->Children) {
+      pending.push_back(&child);
     }
-    if (current_cycle.size() == 1) {
+  }
+  // Link the blocks in the execution order of the plan, skipping the cycle
+  // members which do not own a block
+  memory_allocation::Node* previous = nullptr;
+  int index = 0;
+  for (size_t step = 0; index >= 0 && step < nodes.size(); step++) {
+    auto block = blocks.find(nodes[index]);
+    if (block != blocks.end()) {
+      if (previous != nullptr) {
+        previous->Next = block->second;
+      }
+      previous = block->second;
+    }
+    index = plan.Entries[index].Next;
+  }
+  // The order must end after all the nodes and the buffers of the nodes
+  // which are alive at the same time must not overlap
+  return index < 0 && allocator_->Validate(allocation_tree_root);
+}
+
+void TransformTree::SaveAllocationPlan(const std::string& fileName) const {
+  if (!tree_is_prepared_) {
+    throw TreeIsNotPreparedException();
+  }
+  std::ofstream fw;
+  fw.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+  fw.open(fileName);
+  fw << kAllocationPlanSignature << std::endl;
+  fw << allocation_plan_.NeededMemory << " "
+     << allocation_plan_.Entries.size() << std::endl;
+  for (auto& entry : allocation_plan_.Entries) {
+    // The name goes last because it may contain spaces
+    fw << entry.Parent << " " << entry.Size << " " << entry.Offset << " "
+       << entry.Next << " " << entry.Cycle << " " << entry.Name << std::endl;
+  }
+  DBG("Wrote the allocation plan to %s", fileName.c_str());
+}
+
+bool TransformTree::LoadAllocationPlan(const std::string& fileName) {
+  if (tree_is_prepared_) {
+    throw TreeAlreadyPreparedException();
+  }
+  std::ifstream fr(fileName);
+  std::string signature;
+  if (!std::getline(fr, signature) || signature != kAllocationPlanSignature) {
+    DBG("%s is not an allocation plan", fileName.c_str());
+    return false;
+  }
+  AllocationPlan plan;
+  size_t count = 0;
+  fr >> plan.NeededMemory >> count;
+  plan.Entries.resize(count);
+  for (auto& entry : plan.Entries) {
+    fr >> entry.Parent >> entry.Size >> entry.Offset >> entry.Next
+       >> entry.Cycle;
+    fr.get();
+    std::getline(fr, entry.Name);
+  }
+  if (!fr) {
+    WRN("Failed to read the allocation plan from %s", fileName.c_str());
+    return false;
+  }
+  allocation_plan_ = plan;
+  return true;
+}
+
+std::tuple<int, size_t> TransformTree::SliceBuffersCount(
+    size_t bufferSize) const noexcept {
+  auto manual_size = get_cpu_cache_size();
+  if (manual_size > 0) {
+    return std::make_tuple(0, manual_size / bufferSize);
+  }
+  // The buffers of a slice are divided between the OpenMP threads, so
+  // the slice should fit into the caches of all of them
+  int threads = get_omp_transforms_max_threads_num();
+  auto& topology = CpuCacheTopology::Instance();
+  std::tuple<int, size_t> ret(0, 0);
+  for (auto& level : topology.levels()) {
+    if (level.Level < cache_level_) {
       continue;
     }
-    // We have found a cache optimization friendly subpath.
-    // Determine the size bottleneck and mark all the nodes in that subpath.
-    size_t max_size = 0;
-    size_t bufs_count = current_cycle[0]->BoundBuffers->Count();
-    for (auto cn : current_cycle) {
-      auto size = cn->BoundTransform->InputFormat()->SizeInBytes();
-      if (size > max_size) {
-        max_size = size;
+    size_t count = topology.ThreadBudget(level.Level, threads) * threads /
+        bufferSize;
+    if (count > 0) {
+      ret = std::make_tuple(level.Level, count);
+    }
+    if (count >= static_cast<size_t>(threads)) {
+      // Each thread gets at least one buffer
+      break;
+    }
+  }
+  return ret;
+}
+
+int TransformTree::PlanSlicedCycles() {
+  cycles_.clear();
+  std::unordered_set<const Node*> features;
+  for (auto& feature : features_) {
+    features.insert(feature.second.get());
+  }
+  auto sliceable = [&features](const Node& node) {
+    // The features are returned whole, so their nodes are either leaves
+    // or remain outside of the cycles
+    return node.CycleId == 0 && node.BoundTransform->BufferInvariant() &&
+        node.BuffersCount == node.Parent->BuffersCount &&
+        (node.ChildrenCount() == 0 || features.count(&node) == 0);
+  };
+  std::vector<Node*> heads { root_.get() };
+  while (!heads.empty()) {
+    auto head = heads.back();
+    heads.pop_back();
+    // Gather the buffer invariant subtrees below the head, including
+    // the branches, so that all the readers of a slice process it
+    // while it is in the cache
+    int id = cycles_.size() + 1;
+    std::vector<Node*> members;
+    std::function<void(Node&)> grow = [&](Node& node) {
+      node.CycleId = id;
+      members.push_back(&node);
+      node.ActionOnEachImmediateChild([&](Node& child) {
+        if (sliceable(child)) {
+          grow(child);
+        }
+      });
+    };
+    head->ActionOnEachImmediateChild([&](Node& child) {
+      if (sliceable(child)) {
+        grow(child);
       }
-      assert(bufs_count == cn->BoundBuffers->Count());
+    });
+    // The cycle is allocated as a single block. The members which are read
+    // from outside of it are kept until those readers finish, while
+    // the leaves are kept forever, so both cannot share the block and
+    // the leaves are executed separately.
+    bool has_outer_children = false;
+    for (auto member : members) {
+      member->ActionOnEachImmediateChild([&](Node& child) {
+        if (child.CycleId != id) {
+          has_outer_children = true;
+        }
+      });
     }
-    assert(max_size > 0);
-    size_t slice_buffers_count = get_cpu_cache_size() / max_size;
-    if (slice_buffers_count == 0 || bufs_count <= slice_buffers_count) {
+    if (has_outer_children) {
+      members.erase(std::remove_if(members.begin(), members.end(),
+                                   [](Node* member) {
+        if (member->ChildrenCount() == 0) {
+          member->CycleId = 0;
+          return true;
+        }
+        return false;
+      }), members.end());
+    }
+    // Each slice must fit into the cache while it passes the deepest path
+    size_t working_set = 0;
+    for (auto member : members) {
+      if (member->Parent == head) {
+        working_set = std::max(working_set, member->SliceWorkingSet(0));
+      }
+    }
+    int cache_level = 0;
+    size_t slice_buffers_count = 0;
+    if (members.size() > 1 && working_set > 0) {
+      std::tie(cache_level, slice_buffers_count) =
+          SliceBuffersCount(working_set);
+    }
+    if (slice_buffers_count == 0 ||
+        head->BuffersCount <= slice_buffers_count) {
+      for (auto member : members) {
+        member->CycleId = 0;
+      }
+      head->ActionOnEachImmediateChild([&heads](Node& child) {
+        heads.push_back(&child);
+      });
       continue;
     }
 
-    ret++;
-    // Mark the nodes as cloned
-    for (auto cn : current_cycle) {
-      cn->HasClones = true;
-      cn->CycleId = ret;
-    }
-    // Clone those nodes, connecting each slice's end to the next slice's
-    // beginning.
-    Node* head = current_cycle[0]->Parent;
-    assert(head != nullptr);
-    Node* tail = head;
-    for (size_t i = 0; i < bufs_count; i += slice_buffers_count) {
-      auto my_bufs_count = std::min(slice_buffers_count, bufs_count - i);
-      for (size_t j = 0; j < current_cycle.size(); j++) {
-        auto cn = current_cycle[j];
-        auto cloned = std::make_shared<Node>(j == 0? head : tail,
-                                             cn->BoundTransform,
+    SlicedCycle cycle;
+    cycle.Name = "Cycle " + std::to_string(id) + " (" +
+        (cache_level > 0? "L" + std::to_string(cache_level) : "manual") +
+        ", " + std::to_string(slice_buffers_count) + " buffers)";
+    DBG("%s: %zu nodes after %s", cycle.Name.c_str(), members.size(),
+        head->BoundTransform->Name().c_str());
+    cycle.Head = head;
+    cycle.Members = members;
+    cycle.SliceBuffersCount = slice_buffers_count;
+    cycle.Size = 0;
+    for (auto member : members) {
+      // The output which is read only inside the cycle holds a single slice
+      bool inner = member->ChildrenCount() > 0;
+      member->ActionOnEachImmediateChild([&](Node& child) {
+        if (child.CycleId != id) {
+          inner = false;
+          heads.push_back(&child);
+        }
+      });
+      if (inner) {
+        member->ResidentBuffersCount = slice_buffers_count;
+      }
+      cycle.Size += member->AllocatedSize();
+    }
+    head->ActionOnEachImmediateChild([&](Node& child) {
+      if (child.CycleId != id) {
+        heads.push_back(&child);
+      }
+    });
+    cycles_.push_back(cycle);
+  }
+  return cycles_.size();
+}
+
+void TransformTree::BuildSlicedCycles() {
+  for (size_t id = 1; id <= cycles_.size(); id++) {
+    auto& cycle = cycles_[id - 1];
+    auto head = cycle.Head;
+    for (auto member : cycle.Members) {
+      member->HasClones = true;
+    }
+    // The allocation has put the members in a row, replace them with
+    // the clones
+    Node* tail = root_.get();
+    while (tail->Next != cycle.Members.front()) {
+      tail = tail->Next;
+      assert(tail != nullptr);
+    }
+    auto next = cycle.Members.back()->Next;
+    auto bufs_count = head->BuffersCount;
+    for (size_t i = 0; i < bufs_count; i += cycle.SliceBuffersCount) {
+      auto my_bufs_count = std::min(cycle.SliceBuffersCount, bufs_count - i);
+      std::unordered_map<const Node*, Node*> clones;
+      for (auto member : cycle.Members) {
+        auto parent = member->Parent == head? head : clones[member->Parent];
+        auto cloned = std::make_shared<Node>(parent, member->BoundTransform,
                                              my_bufs_count, this);
-        if (j == 0) {
+        if (parent == head) {
           head->Slices[cloned.get()] = std::make_tuple(i, my_bufs_count);
         }
-        cloned->RelatedFeatures = cn->RelatedFeatures;
-        cloned->BoundBuffers = std::make_shared<Buffers>(
-            cn->BoundBuffers->Slice(i, my_bufs_count));
-        cloned->BuffersCount = my_bufs_count;
-        cloned->OriginalNode = cn;
-        cloned->CycleId = ret;
-        cloned->ElapsedTime = cn->ElapsedTime;
-        tail->Children[cloned->BoundTransform->Name()].push_back(cloned);
-        if (head == tail) {
-          // The very first iteration
-          prev_node->Next = cloned.get();
-        } else {
-          tail->Next = cloned.get();
-        }
+        cloned->RelatedFeatures = member->RelatedFeatures;
+        cloned->OriginalNode = member;
+        // The members which hold a single slice reuse it
+        cloned->SliceIndex =
+            member->ResidentBuffersCount < member->BuffersCount? 0 : i;
+        cloned->CycleId = id;
+        parent->Children[cloned->BoundTransform->Name()].push_back(cloned);
+        clones[member] = cloned.get();
+        tail->Next = cloned.get();
         tail = cloned.get();
       }
     }
-    tail->Next = current_cycle.back()->Next;
+    tail->Next = next;
+  }
+}
+
+int TransformTree::FuseTransforms() {
+  auto fusable = [this](const Node& node) {
+    auto& t = node.BoundTransform;
+    if (dynamic_cast<const Fusable*>(t.get()) == nullptr ||
+        transforms_cache_[t->Name()].Dump) {
+      return false;
+    }
+    // The streaming transforms must be reachable by ResetStream()
+    auto streaming = dynamic_cast<const StreamingAware*>(t.get());
+    return streaming == nullptr || !streaming->streaming();
+  };
+  int ret = 0;
+  std::vector<std::shared_ptr<Node>> pending { root_ };
+  while (!pending.empty()) {
+    auto node = pending.back();
+    pending.pop_back();
+    std::vector<std::shared_ptr<Node>> children;
+    for (auto& child : node->Children) {
+      children.insert(children.end(), child.second.begin(),
+                      child.second.end());
+    }
+    for (auto& child : children) {
+      std::vector<std::shared_ptr<Node>> chain { child };
+      // A node with several children has to keep it's output
+      while (fusable(*chain.back()) && chain.back()->ChildrenCount() == 1) {
+        auto& next = chain.back()->Children.begin()->second.front();
+        if (!fusable(*next)) {
+          break;
+        }
+        chain.push_back(next);
+      }
+      if (chain.size() > 1) {
+        pending.push_back(FuseChain(node.get(), chain));
+        ret++;
+      } else {
+        pending.push_back(child);
+      }
+    }
   }
   return ret;
 }
 
-void TransformTree::DismantleMemoryProtection() noexcept {
-  root_->ActionOnSubtree([this](Node& node) {
-    if (node.Protection) {
-      DBG("Disabling write protection on %p:%zu", node.Protection->page(),
-          node.Protection->size());
+std::shared_ptr<TransformTree::Node> TransformTree::FuseChain(
+    Node* parent, const std::vector<std::shared_ptr<Node>>& chain) {
+  std::vector<std::shared_ptr<Transform>> transforms;
+  for (auto& node : chain) {
+    transforms.push_back(node->BoundTransform);
+  }
+  auto fused = std::make_shared<transforms::Fused>(transforms);
+  fused->Initialize();
+  DBG("Fused %s", fused->Name().c_str());
+  auto& head = chain.front();
+  auto& tail = chain.back();
+  auto node = std::make_shared<Node>(parent, fused, tail->BuffersCount, this);
+  node->Children = tail->Children;
+  node->ActionOnEachImmediateChild([&node](Node& child) {
+    child.Parent = node.get();
+  });
+  node->RelatedFeatures = tail->RelatedFeatures;
+  node->StreamContinuous = tail->StreamContinuous;
+  for (auto& feature : features_) {
+    if (feature.second == tail) {
+      feature.second = node;
+    }
+  }
+  transforms_cache_[fused->Name()];
+  // Replace the head with the new node
+  auto& siblings = parent->Children[head->BoundTransform->Name()];
+  siblings.erase(std::find(siblings.begin(), siblings.end(), head));
+  if (siblings.empty()) {
+    parent->Children.erase(head->BoundTransform->Name());
+  }
+  parent->Children[fused->Name()].push_back(node);
+  return node;
+}
+
+std::unique_ptr<ExecutionContext> TransformTree::NewExecutionContext(
+    const std::shared_ptr<void>& memory) const {
+  std::unique_ptr<ExecutionContext> context(new ExecutionContext(this));
+  context->allocated_memory_ = memory;
+  context->allocated_size_ = needed_memory_;
+  context->plan_cache_ = fftf_plans_;
+  context->buffers_.resize(nodes_count_);
+  context->protections_.resize(nodes_count_);
+  context->elapsed_times_.resize(nodes_count_);
+  auto mem_ptr = reinterpret_cast<char*>(memory.get());
+  // The root's buffers are bound to the input in Execute()
+  root_->ActionOnSubtree([&](const Node& node) {
+    if (node.Parent != nullptr && node.OriginalNode == nullptr) {
+      context->buffers_[node.Index] = node.BoundTransform->CreateOutputBuffers(
+          node.ResidentBuffersCount, mem_ptr + node.Offset);
+    }
+  });
+  root_->ActionOnSubtree([&](const Node& node) {
+    if (node.OriginalNode != nullptr) {
+      context->buffers_[node.Index] = std::make_shared<Buffers>(
+          context->buffers_[node.OriginalNode->Index]->Slice(
+              node.SliceIndex, node.BuffersCount));
     }
-    node.Protection.reset();
   });
+  // Fill the timers in advance, so that Execute() never changes the map
+  for (auto& item : transforms_cache_) {
+    context->transform_times_[item.first] = ExecutionContext::Duration::zero();
+  }
+  for (auto& cycle : cycles_) {
+    context->transform_times_[cycle.Name] = ExecutionContext::Duration::zero();
+  }
+  context->transform_times_["All"] = ExecutionContext::Duration::zero();
+  context->transform_times_["Other"] = ExecutionContext::Duration::zero();
+  PrepareFFTFPlans(*context);
+  return context;
 }
 
-void TransformTree::ResetTimers() noexcept {
-  root_->ActionOnSubtree([](Node& node) {
-    *node.ElapsedTime = std::chrono::high_resolution_clock::duration::zero();
+std::unique_ptr<ExecutionContext> TransformTree::CreateExecutionContext()
+    const {
+  if (!tree_is_prepared_) {
+    throw TreeIsNotPreparedException();
+  }
+  if (streaming_) {
+    // The streaming transforms keep the state of the single stream
+    throw InvalidStreamingModeException(false);
+  }
+  auto memory = std::shared_ptr<void>(malloc_aligned(needed_memory_),
+                                      std::free);
+  if (memory.get() == nullptr) {
+    throw FailedToAllocateBuffersException(std::string("Failed to allocate ") +
+                                           std::to_string(needed_memory_) +
+                                           " bytes.");
+  }
+  DBG("Allocated %zu bytes at %p for the new context", needed_memory_,
+      memory.get());
+  return NewExecutionContext(memory);
+}
+
+const FFTFPlanCache& TransformTree::plan_cache() const noexcept {
+  return *fftf_plans_;
+}
+
+void TransformTree::PrepareFFTFPlans(const ExecutionContext& context) const {
+  root_->ActionOnSubtree([&context](const Node& node) {
+    if (node.Parent == nullptr || node.Parent->Parent == nullptr ||
+        (node.HasClones && node.OriginalNode == nullptr)) {
+      // The root's buffers are not known until Execute(); the original nodes
+      // of the sliced cycles are never executed
+      return;
+    }
+    auto planned = std::dynamic_pointer_cast<FFTFPlanCacheAware>(
+        node.BoundTransform);
+    if (planned != nullptr) {
+      planned->PreparePlans(*node.ParentBuffers(context),
+                            context.buffers_[node.Index].get());
+    }
   });
-  for (auto& ci : transforms_cache_) {
-    ci.second.ElapsedTime =
-        std::chrono::high_resolution_clock::duration::zero();
+}
+
+void TransformTree::DismantleMemoryProtection(
+    ExecutionContext* context) const noexcept {
+  for (auto& protection : context->protections_) {
+    if (protection) {
+      DBG("Disabling write protection on %p:%zu", protection->page(),
+          protection->size());
+    }
+    protection.reset();
+  }
+}
+
+void TransformTree::ResetTimers(ExecutionContext* context) const noexcept {
+  for (auto& time : context->elapsed_times_) {
+    time = ExecutionContext::Duration::zero();
+  }
+  for (auto& time : context->transform_times_) {
+    time.second = ExecutionContext::Duration::zero();
   }
 }
 
@@ -599,39 +1290,73 @@ void TransformTree::PrepareForExecution() {
   if (tree_is_prepared_) {
     throw TreeAlreadyPreparedException();
   }
+  if (streaming_) {
+    CheckFeatureStreams();
+  }
   DBG("Initializing the transforms...");
+  // Share the FFTF plans between all the transforms
+  root_->ActionOnSubtree([this](Node& node) {
+    auto planned = std::dynamic_pointer_cast<FFTFPlanCacheAware>(
+        node.BoundTransform);
+    if (planned != nullptr) {
+      planned->set_plan_cache(fftf_plans_);
+    }
+  });
   // Run Initialize() on all transforms
   root_->ActionOnEachTransformInSubtree([](const Transform& t) {
     t.Initialize();
   });
+  if (fusion_ && !dump_buffers_after_each_transform_) {
+    auto groups_count = FuseTransforms();
+    DBG("Fused %d groups of transforms", groups_count);
+  }
+  canary_size_ = guard_mode_ == GuardMode::kCanary ||
+      guard_mode_ == GuardMode::kSampled?
+      BufferFormat::Aligned(sizeof(kCanaryValue)) : 0;
+  // Try to do CPU cache optimization by splitting the buffers into slices.
+  // The cycles are chosen in advance since they are allocated differently.
+  if (cache_optimization_) {
+    auto cycles_count = PlanSlicedCycles();
+    DBG("Planned %d cycles", cycles_count);
+  }
   DBG("Finished. Baking the allocation plan...");
-  // Solve the allocation problem
-  memory_allocation::Node allocation_tree_root(0, nullptr, root_.get());
-  root_->BuildAllocationTree(&allocation_tree_root);
-  memory_allocation::SlidingBlocksAllocator allocator;
-  size_t neededMemory = allocator.Solve(&allocation_tree_root);
+  if (ApplyAllocationPlan(allocation_plan_)) {
+    DBG("Applied the loaded allocation plan");
+  } else {
+    // Solve the allocation problem
+    memory_allocation::Node allocation_tree_root(0, nullptr, root_.get());
+    root_->BuildAllocationTree(&allocation_tree_root);
+    needed_memory_ = allocator_->Solve(&allocation_tree_root);
 #if DEBUG
-  allocation_tree_root.Dump("/tmp/last_allocation.dot");
-  assert(allocator.Validate(allocation_tree_root));
+    allocation_tree_root.Dump("/tmp/last_allocation.dot");
+    assert(allocator_->Validate(allocation_tree_root));
 #endif
+    // Apply the memory mapping, recording the offsets of the buffers
+    root_->ApplyAllocationTree(allocation_tree_root);
+    allocation_plan_ = RecordAllocationPlan();
+  }
   // Allocate the buffers
-  allocated_memory_ = std::shared_ptr<void>(malloc_aligned(neededMemory),
-                                            std::free);
-  if (allocated_memory_.get() == nullptr) {
+  auto memory = std::shared_ptr<void>(malloc_aligned(needed_memory_),
+                                      std::free);
+  if (memory.get() == nullptr) {
     throw FailedToAllocateBuffersException(std::string("Failed to allocate ") +
-                                           std::to_string(neededMemory) +
+                                           std::to_string(needed_memory_) +
                                            " bytes.");
   }
-  INF("Allocated %zu bytes at %p", neededMemory, allocated_memory_.get());
-  // Finally, apply the memory mapping, creating the actual buffers
-  // We will overwrite root's BoundBuffers on execution stage
-  root_->ApplyAllocationTree(allocation_tree_root, allocated_memory_.get());
-  // Try to do CPU cache optimization by splitting the buffers into slices
-  if (cache_optimization_) {
-    auto cycles_count = BuildSlicedCycles();
-    DBG("Built %d cycles", cycles_count);
-  }
+  INF("Allocated %zu bytes at %p", needed_memory_, memory.get());
+  BuildSlicedCycles();
+  nodes_count_ = 0;
+  root_->ActionOnSubtree([this](Node& node) {
+    node.Index = nodes_count_++;
+  });
+  // Finally, create the actual buffers
+  context_ = NewExecutionContext(memory);
+  BuildSchedule(*context_);
+  DBG("Created %zu FFTF plans", fftf_plans_->Size());
   tree_is_prepared_ = true;
+  if (streaming_) {
+    ResetStream();
+  }
   INF("Prepared to extract %zu features", features_.size());
 #if DEBUG
   Dump("/tmp/last_nodes.dot");
@@ -643,20 +1368,191 @@ TransformTree::Execute(const int16_t* in) {
   if (!tree_is_prepared_) {
     throw TreeIsNotPreparedException();
   }
+  return Execute(context_.get(), in);
+}
+
+std::unordered_map<std::string, std::shared_ptr<Buffers>>
+TransformTree::Execute(ExecutionContext* context, const int16_t* in) const {
+  if (streaming_) {
+    throw InvalidStreamingModeException(false);
+  }
+  RunTransforms(context, in);
+
+  // Populate the results
+  std::unordered_map<std::string, std::shared_ptr<Buffers>> results;
+  for (auto& feature : features_) {
+    results[feature.first] = context->buffers_[feature.second->Index];
+  }
+  return results;
+}
+
+std::unordered_map<std::string, std::shared_ptr<Buffers>>
+TransformTree::Execute(const int16_t* in,
+                       const std::vector<std::string>& features) {
+  if (!tree_is_prepared_) {
+    throw TreeIsNotPreparedException();
+  }
+  return Execute(context_.get(), in, features);
+}
+
+std::unordered_map<std::string, std::shared_ptr<Buffers>>
+TransformTree::Execute(ExecutionContext* context, const int16_t* in,
+                       const std::vector<std::string>& features) const {
+  if (streaming_) {
+    throw InvalidStreamingModeException(false);
+  }
+  if (!tree_is_prepared_) {
+    throw TreeIsNotPreparedException();
+  }
+  // Unite the nodes of the requested features
+  std::vector<bool> needed(schedule_.Nodes.size());
+  for (auto& feature : features) {
+    auto fnit = schedule_.FeatureNodes.find(feature);
+    if (fnit == schedule_.FeatureNodes.end()) {
+      throw FeatureNotFoundException(feature);
+    }
+    for (size_t i = 0; i < needed.size(); i++) {
+      if (fnit->second[i]) {
+        needed[i] = true;
+      }
+    }
+  }
+  RunTransforms(context, in, &needed);
+
+  std::unordered_map<std::string, std::shared_ptr<Buffers>> results;
+  for (auto& feature : features) {
+    auto& node = features_.find(feature)->second;
+    results[feature] = context->buffers_[node->Index];
+  }
+  return results;
+}
+
+std::unordered_map<std::string, std::shared_ptr<Buffers>>
+TransformTree::ExecuteStream(const int16_t* in, size_t validSamples) {
+  return ExecuteStream(in, validSamples, validSamples < root_format_->Size());
+}
+
+std::unordered_map<std::string, std::shared_ptr<Buffers>>
+TransformTree::ExecuteStream(const int16_t* in, size_t validSamples,
+                             bool last) {
+  if (!streaming_) {
+    throw InvalidStreamingModeException(true);
+  }
+  assert(validSamples <= root_format_->Size());
+  if (!tree_is_prepared_) {
+    throw TreeIsNotPreparedException();
+  }
+  // Find out which part of each node's output is meaningful, parents first
+  std::unordered_map<const Node*, StreamPiece> pieces;
+  root_->ActionOnSubtree([this, &pieces, validSamples, last](
+      const Node& node) {
+    if (node.Parent == nullptr) {
+      pieces[&node] = { 0, validSamples, last };
+      return;
+    }
+    auto piece = pieces[node.Parent];
+    auto streaming = dynamic_cast<const StreamingAware*>(
+        node.BoundTransform.get());
+    if (streaming != nullptr && streaming->streaming()) {
+      piece = streaming->PrepareStreamPiece(piece);
+    }
+    auto delay = stream_delays_.find(&node);
+    if (delay != stream_delays_.end()) {
+      size_t skip = std::min(delay->second, piece.Valid - piece.Skip);
+      delay->second -= skip;
+      piece.Skip += skip;
+    }
+    pieces[&node] = piece;
+  });
+  RunTransforms(context_.get(), in);
+
+  // Populate the results, leaving only the windows which belong to the stream
+  std::unordered_map<std::string, std::shared_ptr<Buffers>> results;
+  for (auto& feature : features_) {
+    auto& piece = pieces[feature.second.get()];
+    results[feature.first] = std::make_shared<Buffers>(
+        context_->buffers_[feature.second->Index]->Slice(
+            piece.Skip, piece.Valid - piece.Skip));
+  }
+  return results;
+}
+
+bool TransformTree::StreamPending() const {
+  if (!streaming_) {
+    throw InvalidStreamingModeException(true);
+  }
+  bool pending = false;
+  root_->ActionOnEachTransformInSubtree([&pending](const Transform& t) {
+    auto streaming = dynamic_cast<const StreamingAware*>(&t);
+    if (streaming != nullptr && streaming->streaming() &&
+        streaming->StreamPending()) {
+      pending = true;
+    }
+  });
+  return pending;
+}
+
+void TransformTree::ResetStream() {
+  if (!streaming_) {
+    throw InvalidStreamingModeException(true);
+  }
+  if (!tree_is_prepared_) {
+    throw TreeIsNotPreparedException();
+  }
+  stream_delays_.clear();
+  root_->ActionOnSubtree([this](const Node& node) {
+    auto streaming = dynamic_cast<const StreamingAware*>(
+        node.BoundTransform.get());
+    if (streaming != nullptr && streaming->streaming()) {
+      streaming->ResetStream();
+      if (streaming->StreamDelay() > 0) {
+        stream_delays_[&node] = streaming->StreamDelay();
+      }
+    }
+  });
+}
+
+void TransformTree::RunTransforms(ExecutionContext* context,
+                                  const int16_t* in,
+                                  const std::vector<bool>* needed) const {
+  if (!tree_is_prepared_) {
+    throw TreeIsNotPreparedException();
+  }
   if (features_.size() == 0) {
     throw TreeIsEmptyException();
   }
-  if (memory_protection()) {
-    DismantleMemoryProtection();
+  if (context->tree() != this) {
+    throw ForeignExecutionContextException();
   }
-  ResetTimers();
+  // The protections may remain from the previous mode
+  DismantleMemoryProtection(context);
+  context->check_canaries_ = guard_mode_ == GuardMode::kCanary ||
+      (guard_mode_ == GuardMode::kSampled &&
+       context->executions_ % guard_sampling_period_ == 0);
+  context->executions_++;
+  context->collect_statistics_ = collect_statistics_;
+  context->collect_counters_ = perf_counters_;
+  PerfCounters::Execution counting_execution(context->collect_counters_);
+  if (context->collect_statistics_ || context->collect_counters_) {
+    std::lock_guard<std::mutex> lock(context->statistics_mutex_);
+    if (context->statistics_.empty()) {
+      context->statistics_.resize(nodes_count_);
+    }
+  }
+  std::vector<ExecutionContext::Duration::rep> priorities;
+  if (branch_threads_number_ > 1) {
+    // Must be called before the timers are reset
+    priorities = CriticalPaths(*context);
+  }
+  ResetTimers(context);
   // Initialize input. We have to const_cast here, but "in" is not going
   // to be overwritten anyway.
-  root_->BoundBuffers = root_->BoundTransform->CreateOutputBuffers(
+  auto& root_buffers = context->buffers_[root_->Index];
+  root_buffers = root_->BoundTransform->CreateOutputBuffers(
       1, const_cast<int16_t*>(in));
   if (validate_after_each_transform()) {
     try {
-      root_->BoundBuffers->Validate();
+      root_buffers->Validate();
     }
     catch(const InvalidBuffersException& e) {
       throw InvalidInputBuffersException(e.what());
@@ -666,40 +1562,246 @@ TransformTree::Execute(const int16_t* in) {
   DBG("Executing the tree...");
   // Run the transforms, measuring the elapsed time
   auto check_point_start = std::chrono::high_resolution_clock::now();
-  root_->Execute();
+  context->execution_start_ = check_point_start;
+  if (priorities.empty()) {
+    for (size_t i = 0; i < schedule_.Nodes.size(); i++) {
+      if (needed == nullptr || (*needed)[i]) {
+        schedule_.Nodes[i]->Execute(context);
+      }
+    }
+  } else {
+    ExecuteBranches(context, priorities, needed);
+  }
   auto check_point_finish = std::chrono::high_resolution_clock::now();
+  AccumulateTimes(context);
   auto all_duration = check_point_finish - check_point_start;
   INF("Finished. Execution took %f s", ConvertDuration(all_duration));
   auto other_duration = all_duration;
   for (auto& cit : transforms_cache_) {
-    other_duration -= cit.second.ElapsedTime;
+    other_duration -= context->transform_times_[cit.first];
   }
   if (other_duration.count() < 0) {
-    other_duration = std::chrono::high_resolution_clock::duration::zero();
+    other_duration = ExecutionContext::Duration::zero();
   }
-  transforms_cache_["All"].ElapsedTime = all_duration;
-  transforms_cache_["Other"].ElapsedTime = other_duration;
+  context->transform_times_["All"] = all_duration;
+  context->transform_times_["Other"] = other_duration;
+}
 
-  // Populate the results
-  std::unordered_map<std::string, std::shared_ptr<Buffers>> results;
+void TransformTree::BuildSchedule(const ExecutionContext& context) {
+  schedule_ = Schedule();
+  auto& nodes = schedule_.Nodes;
+  for (auto node = root_->Next; node != nullptr; node = node->Next) {
+    nodes.push_back(node);
+  }
+  // Find out which parts of the allocated memory each node reads and writes.
+  // The root's buffers are outside and are never written.
+  typedef std::pair<uintptr_t, uintptr_t> Range;
+  auto base = reinterpret_cast<uintptr_t>(context.allocated_memory_.get());
+  auto range = [base, this](const Buffers& buffers) {
+    auto ptr = reinterpret_cast<uintptr_t>(buffers.Data());
+    if (ptr < base || ptr >= base + needed_memory_) {
+      return Range(0, 0);
+    }
+    return Range(ptr - base, ptr - base + buffers.SizeInBytes());
+  };
+  auto overlap = [](const Range& r1, const Range& r2) {
+    return r1.first < r2.second && r2.first < r1.second;
+  };
+  std::vector<Range> reads, writes;
+  for (auto node : nodes) {
+    reads.push_back(range(*node->ParentBuffers(context)));
+    writes.push_back(range(*context.buffers_[node->Index]));
+    if (node->Canary(context) != nullptr) {
+      // The canary directly follows the buffers
+      writes.back().second += canary_size_;
+    }
+  }
+  // The allocator reuses the memory assuming the sequential order, so
+  // every access to the shared memory must happen in that order
+  int size = nodes.size();
+  schedule_.Successors.resize(size);
+  schedule_.PredecessorsCount.resize(size);
+  for (int i = 0; i < size; i++) {
+    auto streaming = dynamic_cast<const StreamingAware*>(
+        nodes[i]->BoundTransform.get());
+    bool stateful = streaming != nullptr && streaming->streaming();
+    for (int j = i + 1; j < size; j++) {
+      if (overlap(writes[i], writes[j]) || overlap(writes[i], reads[j]) ||
+          overlap(reads[i], writes[j]) ||
+          // The slices of a streamed signal must be processed in order
+          (stateful && nodes[i]->BoundTransform == nodes[j]->BoundTransform)) {
+        schedule_.Successors[i].push_back(j);
+        schedule_.PredecessorsCount[j]++;
+      }
+    }
+  }
+  // Skipping the nodes which are not related to a feature never breaks
+  // the dependencies, since the related nodes include all the ancestors
   for (auto& feature : features_) {
-    results[feature.first] = feature.second->BoundBuffers;
+    auto& related = schedule_.FeatureNodes[feature.first];
+    related.resize(size);
+    for (int i = 0; i < size; i++) {
+      auto& features = nodes[i]->RelatedFeatures;
+      related[i] = std::find(features.begin(), features.end(),
+                             feature.first) != features.end();
+    }
+  }
+}
+
+std::vector<ExecutionContext::Duration::rep> TransformTree::CriticalPaths(
+    const ExecutionContext& context) const noexcept {
+  // The successors always follow their predecessors in schedule_.Nodes
+  std::vector<ExecutionContext::Duration::rep> paths(schedule_.Nodes.size());
+  for (int i = paths.size() - 1; i >= 0; i--) {
+    ExecutionContext::Duration::rep max = 0;
+    for (int successor : schedule_.Successors[i]) {
+      max = std::max(max, paths[successor]);
+    }
+    // + 1 makes the longer chains win if the times are not measured yet
+    paths[i] = context.elapsed_times_[schedule_.Nodes[i]->Index].count() + 1 +
+        max;
+  }
+  return paths;
+}
+
+struct TransformTree::BranchesExecution {
+  BranchesExecution(
+      ExecutionContext* context,
+      const std::vector<ExecutionContext::Duration::rep>& priorities,
+      const std::vector<int>& predecessorsCount,
+      const std::vector<bool>* needed)
+      : Context(context), Priorities(priorities), Needed(needed),
+        Pending(new std::atomic<int>[predecessorsCount.size()]),
+        Failed(false) {
+    for (size_t i = 0; i < predecessorsCount.size(); i++) {
+      Pending[i] = predecessorsCount[i];
+    }
+  }
+
+  ExecutionContext* Context;
+  const std::vector<ExecutionContext::Duration::rep>& Priorities;
+  /// @brief The nodes to execute or null for all of them.
+  const std::vector<bool>* Needed;
+  /// @brief The number of the unfinished predecessors of each node.
+  std::unique_ptr<std::atomic<int>[]> Pending;
+  std::atomic<bool> Failed;
+  std::mutex ErrorMutex;
+  /// @brief The first exception thrown by a node.
+  std::exception_ptr Error;
+};
+
+void TransformTree::ExecuteBranches(
+    ExecutionContext* context,
+    const std::vector<ExecutionContext::Duration::rep>& priorities,
+    const std::vector<bool>* needed) const {
+  BranchesExecution execution(context, priorities,
+                              schedule_.PredecessorsCount, needed);
+  std::vector<int> starts;
+  for (int i = 0; i < static_cast<int>(schedule_.Nodes.size()); i++) {
+    if (schedule_.PredecessorsCount[i] == 0) {
+      starts.push_back(i);
+    }
+  }
+  std::sort(starts.begin(), starts.end(), [&priorities](int i1, int i2) {
+    return priorities[i1] > priorities[i2];
+  });
+#ifdef HAVE_OPENMP
+  // The idle threads of the team steal the spawned branches
+  #pragma omp parallel num_threads(branch_threads_number_)
+  #pragma omp single
+  {
+    for (int start : starts) {
+      #pragma omp task firstprivate(start)
+      ExecuteBranch(&execution, start);
+    }
+  }
+#else
+  for (int start : starts) {
+    ExecuteBranch(&execution, start);
+  }
+#endif
+  if (execution.Failed) {
+    std::rethrow_exception(execution.Error);
+  }
+}
+
+void TransformTree::ExecuteBranch(BranchesExecution* execution,
+                                  int index) const {
+  while (index >= 0) {
+    // The skipped nodes still release their successors
+    if (!execution->Failed && (execution->Needed == nullptr ||
+                               (*execution->Needed)[index])) {
+      try {
+        schedule_.Nodes[index]->Execute(execution->Context);
+      }
+      catch(...) {
+        std::lock_guard<std::mutex> lock(execution->ErrorMutex);
+        if (!execution->Failed) {
+          execution->Error = std::current_exception();
+          execution->Failed = true;
+        }
+      }
+    }
+    // Continue with the most critical ready successor and spawn the others.
+    // The successors are released even after a failure to drain the tasks.
+    int next = -1;
+    for (int successor : schedule_.Successors[index]) {
+      if (--execution->Pending[successor] > 0) {
+        continue;
+      }
+      if (next < 0) {
+        next = successor;
+        continue;
+      }
+      if (execution->Priorities[successor] > execution->Priorities[next]) {
+        std::swap(next, successor);
+      }
+#ifdef HAVE_OPENMP
+      #pragma omp task firstprivate(successor)
+      ExecuteBranch(execution, successor);
+#else
+      ExecuteBranch(execution, successor);
+#endif
+    }
+    index = next;
+  }
+}
+
+void TransformTree::AccumulateTimes(ExecutionContext* context) const noexcept {
+  for (auto node : schedule_.Nodes) {
+    auto elapsed = context->elapsed_times_[node->Index];
+    // The clones accumulate the time of their original node and cycle
+    if (node->OriginalNode != nullptr) {
+      context->elapsed_times_[node->OriginalNode->Index] += elapsed;
+      context->transform_times_.find(
+          cycles_[node->CycleId - 1].Name)->second += elapsed;
+    }
+    context->transform_times_.find(node->BoundTransform->Name())->second +=
+        elapsed;
   }
-  return results;
 }
 
 std::unordered_map<std::string, float>
 TransformTree::ExecutionTimeReport() const noexcept {
+  if (!context_) {
+    return {};
+  }
+  return ExecutionTimeReport(*context_);
+}
+
+std::unordered_map<std::string, float>
+TransformTree::ExecutionTimeReport(
+    const ExecutionContext& context) const noexcept {
   std::unordered_map<std::string, float> ret;
-  auto allIt = transforms_cache_.find("All");
-  if (allIt == transforms_cache_.end()) {
+  auto allIt = context.transform_times_.find("All");
+  if (allIt == context.transform_times_.end() || allIt->second.count() == 0) {
     return ret;
   }
-  auto all_time = allIt->second.ElapsedTime;
-  for (auto& cit : transforms_cache_) {
+  auto all_time = allIt->second;
+  for (auto& cit : context.transform_times_) {
     if (cit.first != "All") {
       ret.insert(std::make_pair(
-          cit.first, (cit.second.ElapsedTime.count() + 0.f) / all_time.count()));
+          cit.first, (cit.second.count() + 0.f) / all_time.count()));
     } else {
       ret.insert(std::make_pair(
           cit.first, ConvertDuration(all_time)));
@@ -708,6 +1810,133 @@ TransformTree::ExecutionTimeReport() const noexcept {
   return ret;
 }
 
+std::string TransformTree::StatisticsReport() const {
+  if (!context_) {
+    return "{\"nodes\": []}";
+  }
+  return StatisticsReport(*context_);
+}
+
+std::string TransformTree::StatisticsReport(
+    const ExecutionContext& context) const {
+  auto statistics = context.StatisticsSnapshot();
+  std::ostringstream report;
+  report << "{\"nodes\": [";
+  bool first = true;
+  root_->ActionOnSubtree([&](const Node& node) {
+    if (statistics.empty() || statistics[node.Index].Latency.count() == 0) {
+      return;
+    }
+    auto& stats = statistics[node.Index];
+    auto& latency = stats.Latency;
+    report << (first? "\n" : ",\n") << "  {\"index\": " << node.Index
+           << ", \"name\": " << JsonString(node.BoundTransform->Name())
+           << ", \"parent\": " << node.Parent->Index;
+    if (node.OriginalNode != nullptr) {
+      report << ", \"original\": " << node.OriginalNode->Index
+             << ", \"cycle\": " << JsonString(cycles_[node.CycleId - 1].Name)
+             << ", \"slice\": " << node.SliceIndex;
+    }
+    report << ", \"count\": " << latency.count()
+           << ", \"total_ns\": " << latency.total()
+           << ", \"min_ns\": " << latency.min()
+           << ", \"max_ns\": " << latency.max()
+           << ", \"p50_ns\": " << latency.Percentile(0.5)
+           << ", \"p95_ns\": " << latency.Percentile(0.95)
+           << ", \"p99_ns\": " << latency.Percentile(0.99)
+           << ", \"bytes_in\": " << stats.BytesIn
+           << ", \"bytes_out\": " << stats.BytesOut
+           << ", \"thread\": " << stats.Thread;
+    auto& counters = stats.Counters;
+    if (counters.Cycles > 0) {
+      report << ", \"cycles\": " << counters.Cycles
+             << ", \"instructions\": " << counters.Instructions
+             << ", \"llc_misses\": " << counters.CacheMisses
+             << ", \"branch_misses\": " << counters.BranchMisses
+             << ", \"ipc\": " << counters.Ipc();
+    }
+    report << "}";
+    first = false;
+  });
+  report << (first? "]}" : "\n]}");
+  return report.str();
+}
+
+std::string TransformTree::ChromeTrace() const {
+  if (!context_) {
+    return "{\"traceEvents\": []}";
+  }
+  return ChromeTrace(*context_);
+}
+
+std::string TransformTree::ChromeTrace(const ExecutionContext& context) const {
+  std::ostringstream trace;
+  trace << "{\"traceEvents\": [";
+  trace << std::fixed << std::setprecision(3);
+  auto statistics = context.StatisticsSnapshot();
+  bool first = true;
+  // The timestamps are in microseconds
+  auto us = [](const ExecutionContext::Duration& d) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() /
+        1000.;
+  };
+  root_->ActionOnSubtree([&](const Node& node) {
+    if (statistics.empty() || statistics[node.Index].Latency.count() == 0) {
+      return;
+    }
+    auto& stats = statistics[node.Index];
+    trace << (first? "\n" : ",\n") << "  {\"name\": "
+          << JsonString(node.BoundTransform->Name())
+          << ", \"cat\": \"transform\", \"ph\": \"X\", \"pid\": 0"
+          << ", \"tid\": " << stats.Thread
+          << ", \"ts\": " << us(stats.LastStart)
+          << ", \"dur\": " << us(stats.LastDuration)
+          << ", \"args\": {\"index\": " << node.Index
+          << ", \"bytes_in\": " << stats.BytesIn
+          << ", \"bytes_out\": " << stats.BytesOut << "}}";
+    first = false;
+  });
+  trace << (first? "]}" : "\n]}");
+  return trace.str();
+}
+
+std::unordered_map<std::string, PerfSample> TransformTree::PerfReport()
+    const {
+  if (!context_) {
+    return {};
+  }
+  return PerfReport(*context_);
+}
+
+std::unordered_map<std::string, PerfSample> TransformTree::PerfReport(
+    const ExecutionContext& context) const {
+  std::unordered_map<std::string, PerfSample> ret;
+  auto statistics = context.StatisticsSnapshot();
+  if (statistics.empty()) {
+    return ret;
+  }
+  root_->ActionOnSubtree([&](const Node& node) {
+    auto& counters = statistics[node.Index].Counters;
+    if (counters.Cycles > 0) {
+      ret[node.BoundTransform->Name()] += counters;
+    }
+  });
+  return ret;
+}
+
+void TransformTree::ResetStatistics() noexcept {
+  if (context_) {
+    ResetStatistics(context_.get());
+  }
+}
+
+void TransformTree::ResetStatistics(ExecutionContext* context) const noexcept {
+  std::lock_guard<std::mutex> lock(context->statistics_mutex_);
+  for (auto& stats : context->statistics_) {
+    stats = ExecutionContext::NodeStatistics();
+  }
+}
+
 void TransformTree::Dump(const std::string& dotFileName) const {
   // I am very sorry for such a complicated code. Please forgive me.
   // It just has to be here.
@@ -717,6 +1946,9 @@ void TransformTree::Dump(const std::string& dotFileName) const {
 
   auto time_report = ExecutionTimeReport();
   bool include_time = time_report.size() > 0;
+  auto elapsed_time = [this](const Node& node) {
+    return context_->elapsed_times_[node.Index];
+  };
   float maxTimeRatio = 0.0f;
   if (include_time) {
     for (auto& tr : time_report) {
@@ -728,6 +1960,7 @@ void TransformTree::Dump(const std::string& dotFileName) const {
   float redShift = redThreshold * maxTimeRatio;
   const int initialLight = 0x30;
   auto allTime = time_report["All"];
+  auto perf_report = PerfReport();
   std::ofstream fw;
   fw.exceptions(std::ifstream::failbit | std::ifstream::badbit);
   fw.open(dotFileName);
@@ -753,7 +1986,7 @@ void TransformTree::Dump(const std::string& dotFileName) const {
         << "<br /><font point-size=\"10\">";
     if (include_time) {
       auto cur_percent = static_cast<int>(
-          (roundf(ConvertDuration(*node.ElapsedTime) * 100.f / allTime)));
+          (roundf(ConvertDuration(elapsed_time(node)) * 100.f / allTime)));
       assert(cur_percent >=0 && cur_percent <= 100);
       auto all_percent = static_cast<int>(
           roundf(time_report[t->Name()] * 100.f));
@@ -761,12 +1994,19 @@ void TransformTree::Dump(const std::string& dotFileName) const {
       fw << "<b>" << std::to_string(cur_percent) << "% ("
           << std::to_string(all_percent) << "%)</b>";
     }
-    if (t->GetParameters().size() > 0) {
-      fw << "<br /> <br />";
-      for (auto& p : t->GetParameters()) {
+    auto counters = perf_report.find(t->Name());
+    if (counters != perf_report.end()) {
+      auto& sample = counters->second;
+      fw << "<br />IPC " << std::to_string(sample.Ipc()) << ", LLC misses "
+         << std::to_string(sample.CacheMisses * 1000.f /
+                           std::max(sample.Instructions, UINT64_C(1)))
+         << "/Kinstr";
+    }
+    auto dump_parameters = [&fw](const Transform& transform) {
+      for (auto& p : transform.GetParameters()) {
         auto isDefault = false;
         isDefault = p.second ==
-            t->SupportedParameters().find(p.first)->second.DefaultValue;
+            transform.SupportedParameters().find(p.first)->second.DefaultValue;
         if (isDefault) {
           fw << "<font color=\"gray\">";
         }
@@ -776,10 +2016,30 @@ void TransformTree::Dump(const std::string& dotFileName) const {
         }
         fw << "<br />";
       }
+    };
+    auto fused = std::dynamic_pointer_cast<transforms::Fused>(t);
+    if (fused != nullptr) {
+      // List the parameters of each fused transform
+      for (auto& ft : fused->transforms()) {
+        fw << "<br /> <br /><i>" << ft->HtmlEscapedName() << "</i><br />";
+        dump_parameters(*ft);
+      }
+    } else if (t->GetParameters().size() > 0) {
+      fw << "<br /> <br />";
+      dump_parameters(*t);
     } else {
       fw << " ";
     }
-    fw << "</font>>]" << std::endl;
+    fw << "</font>>";
+    if (fused != nullptr) {
+      fw << ", peripheries=2";
+    }
+    if (counters != perf_report.end() &&
+        counters->second.Ipc() < kMemoryBoundIpc) {
+      // Most likely waits for the memory
+      fw << ", color=\"blue\", penwidth=2";
+    }
+    fw << "]" << std::endl;
 
     // If this node is a leaf, append related feature node
     if (node.Children.size() == 0) {
@@ -788,9 +2048,9 @@ void TransformTree::Dump(const std::string& dotFileName) const {
           "fillcolor=\"#85b3de\", label=<" << feature;
       if (include_time) {
         fw << "<br /><font point-size=\"10\">";
-        auto featureTime = *node.ElapsedTime;
+        auto featureTime = elapsed_time(node);
         node.ActionOnEachParent([&](const Node& parent) {
-          featureTime += *parent.ElapsedTime / parent.RelatedFeatures.size();
+          featureTime += elapsed_time(parent) / parent.RelatedFeatures.size();
         });
         auto cur_percent = static_cast<int>(
             (roundf((ConvertDuration(featureTime) * 100.f) / allTime)));
@@ -887,12 +2147,102 @@ void TransformTree::set_cache_optimization(bool value) noexcept {
   cache_optimization_ = value;
 }
 
+int TransformTree::cache_level() const noexcept {
+  return cache_level_;
+}
+
+void TransformTree::set_cache_level(int value) noexcept {
+  cache_level_ = value;
+}
+
+bool TransformTree::fusion() const noexcept {
+  return fusion_;
+}
+
+void TransformTree::set_fusion(bool value) noexcept {
+  fusion_ = value;
+}
+
 bool TransformTree::memory_protection() const noexcept {
-  return memory_protection_;
+  return guard_mode_ == GuardMode::kProtect;
 }
 
 void TransformTree::set_memory_protection(bool value) noexcept {
-  memory_protection_ = value;
+  guard_mode_ = value? GuardMode::kProtect : GuardMode::kOff;
+}
+
+GuardMode TransformTree::guard_mode() const noexcept {
+  return guard_mode_;
+}
+
+void TransformTree::set_guard_mode(GuardMode value) {
+  if (tree_is_prepared_ && canary_size_ == 0 &&
+      (value == GuardMode::kCanary || value == GuardMode::kSampled)) {
+    throw TreeAlreadyPreparedException();
+  }
+  guard_mode_ = value;
+}
+
+int TransformTree::guard_sampling_period() const noexcept {
+  return guard_sampling_period_;
+}
+
+void TransformTree::set_guard_sampling_period(int value) noexcept {
+  guard_sampling_period_ = std::max(value, 1);
+}
+
+bool TransformTree::streaming() const noexcept {
+  return streaming_;
+}
+
+void TransformTree::set_streaming(bool value) {
+  if (features_.size() > 0) {
+    throw StreamingModeIsFixedException();
+  }
+  streaming_ = value;
+}
+
+std::shared_ptr<memory_allocation::BuffersAllocator>
+TransformTree::allocator() const noexcept {
+  return allocator_;
+}
+
+void TransformTree::set_allocator(
+    const std::shared_ptr<memory_allocation::BuffersAllocator>& value)
+    noexcept {
+  allocator_ = value;
+}
+
+bool TransformTree::perf_counters() const noexcept {
+  return perf_counters_;
+}
+
+void TransformTree::set_perf_counters(bool value) noexcept {
+  if (value) {
+    PerfCounters::OpenWorkers(get_omp_transforms_max_threads_num());
+  }
+  if (value && !PerfCounters::ThisThread().available()) {
+    WRN("The hardware counters are not available (see "
+        "/proc/sys/kernel/perf_event_paranoid), only the timers will be "
+        "collected");
+  }
+  perf_counters_ = value;
+}
+
+bool TransformTree::collect_statistics() const noexcept {
+  return collect_statistics_;
+}
+
+void TransformTree::set_collect_statistics(bool value) noexcept {
+  collect_statistics_ = value;
+}
+
+int TransformTree::branch_threads_number() const noexcept {
+  return branch_threads_number_;
+}
+
+void TransformTree::set_branch_threads_number(int value) noexcept {
+  branch_threads_number_ = std::max(value, 1);
 }
 
 float TransformTree::ConvertDuration(
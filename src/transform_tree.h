@@ -31,11 +31,20 @@
 #ifndef SRC_TRANSFORM_TREE_H_
 #define SRC_TRANSFORM_TREE_H_
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <tuple>
 #include <vector>
 #include "src/formats/array_format.h"
 #include "src/exceptions.h"
+#include "src/fftf_plan_cache.h"
+#include "src/latency_histogram.h"
 #include "src/logger.h"
+#include "src/perf_counters.h"
+#include "src/streaming_aware.h"
 #include "src/transform.h"
 #include "src/allocators/buffers_allocator.h"
 
@@ -123,6 +132,14 @@ class TransformResultedInInvalidBuffersException : public ExceptionBase {
   }
 };
 
+class BufferOverrunException : public ExceptionBase {
+ public:
+  explicit BufferOverrunException(const std::string& transform)
+  : ExceptionBase("Transform " + transform +
+                  " wrote past the end of its buffers.") {
+  }
+};
+
 class InvalidInputBuffersException : public ExceptionBase {
  public:
   explicit InvalidInputBuffersException(const std::string& message)
@@ -130,6 +147,39 @@ class InvalidInputBuffersException : public ExceptionBase {
   }
 };
 
+class TransformIsNotStreamableException : public ExceptionBase {
+ public:
+  explicit TransformIsNotStreamableException(const std::string& name)
+  : ExceptionBase("Transform \"" + name + "\" can not be executed in the "
+                  "streaming mode at this position.") {
+  }
+};
+
+class FeatureIsNotSplitException : public ExceptionBase {
+ public:
+  explicit FeatureIsNotSplitException(const std::string& name)
+  : ExceptionBase("Feature \"" + name + "\" does not split the stream into "
+                  "windows and thus can not be extracted in the streaming "
+                  "mode.") {
+  }
+};
+
+class StreamingModeIsFixedException : public ExceptionBase {
+ public:
+  StreamingModeIsFixedException()
+  : ExceptionBase("Streaming mode can not be changed after the first feature "
+                  "is added.") {
+  }
+};
+
+class InvalidStreamingModeException : public ExceptionBase {
+ public:
+  explicit InvalidStreamingModeException(bool expected)
+  : ExceptionBase(std::string("Transform tree must ") +
+                  (expected? "" : "not ") + "be in the streaming mode.") {
+  }
+};
+
 class FailedToAllocateBuffersException : public std::bad_alloc {
  public:
   explicit FailedToAllocateBuffersException(const char* message) noexcept
@@ -146,7 +196,115 @@ class FailedToAllocateBuffersException : public std::bad_alloc {
   std::string message_;
 };
 
+class ForeignExecutionContextException : public ExceptionBase {
+ public:
+  ForeignExecutionContextException()
+  : ExceptionBase("Execution context was created by another transform "
+                  "tree.") {
+  }
+};
+
+class FeatureNotFoundException : public ExceptionBase {
+ public:
+  explicit FeatureNotFoundException(const std::string& name)
+  : ExceptionBase("Feature \"" + name + "\" was not added to the tree.") {
+  }
+};
+
 class MemoryProtector;
+class TransformTree;
+
+/// @brief The way the buffers are guarded against the transforms which
+/// write out of bounds.
+enum class GuardMode {
+  /// @brief No checks.
+  kOff,
+  /// @brief The leaves are made read only with mprotect() after they have
+  /// been written. This costs several system calls in each Execute().
+  kProtect,
+  /// @brief Each buffer is followed by a canary word which is checked after
+  /// the transform has written the buffer.
+  kCanary,
+  /// @brief The same as kCanary, but only every
+  /// TransformTree::guard_sampling_period()-th execution is checked.
+  kSampled
+};
+
+/// @brief The mutable state of TransformTree::Execute(): the buffers, the
+/// timers and the memory protection. The prepared tree itself stays
+/// unchanged during the execution, so several threads may execute it
+/// simultaneously, each with it's own context.
+class ExecutionContext {
+ public:
+  ExecutionContext(const ExecutionContext&) = delete;
+  ExecutionContext& operator=(const ExecutionContext&) = delete;
+  /// @brief Destroys the FFTF plans bound to the arena.
+  ~ExecutionContext();
+
+  const TransformTree* tree() const noexcept;
+
+ private:
+  friend class TransformTree;
+  typedef std::chrono::high_resolution_clock::duration Duration;
+
+  explicit ExecutionContext(const TransformTree* tree) noexcept;
+
+  /// @brief The statistics of a node over the executions, which are
+  /// collected if TransformTree::collect_statistics() is set.
+  struct NodeStatistics {
+    NodeStatistics() : BytesIn(0), BytesOut(0), Thread(0) {
+    }
+
+    /// @brief The execution times in nanoseconds.
+    LatencyHistogram Latency;
+    size_t BytesIn;
+    size_t BytesOut;
+    /// @brief The thread which executed the node the last time.
+    int Thread;
+    /// @brief The start of the last execution relative to execution_start_.
+    Duration LastStart;
+    Duration LastDuration;
+    /// @brief The hardware counters accumulated while BoundTransform->Do()
+    /// ran, if TransformTree::perf_counters() is set.
+    PerfSample Counters;
+  };
+
+  /// @brief Returns the copy of statistics_ which is consistent even if
+  /// the nodes are being executed.
+  std::vector<NodeStatistics> StatisticsSnapshot() const;
+
+  const TransformTree* tree_;
+  /// @brief The continuous memory block containing all the buffers. It MUST
+  /// go before protections_ because of the memory protection scheme
+  /// (mprotect).
+  std::shared_ptr<void> allocated_memory_;
+  size_t allocated_size_;
+  /// @brief The cache which holds the FFTF plans on the arena.
+  std::shared_ptr<FFTFPlanCache> plan_cache_;
+  /// @brief The buffers of each node, indexed by Node::Index.
+  std::vector<std::shared_ptr<Buffers>> buffers_;
+  std::vector<std::shared_ptr<MemoryProtector>> protections_;
+  /// @brief The number of the executions, used by GuardMode::kSampled.
+  size_t executions_;
+  /// @brief Indicates whether the canaries are checked in the current
+  /// execution.
+  bool check_canaries_;
+  std::vector<Duration> elapsed_times_;
+  std::unordered_map<std::string, Duration> transform_times_;
+  /// @brief Indexed by Node::Index. It is allocated when the statistics
+  /// are collected for the first time.
+  std::vector<NodeStatistics> statistics_;
+  /// @brief Guards statistics_, which the reports read while the nodes of
+  /// the other threads update it.
+  mutable std::mutex statistics_mutex_;
+  /// @brief Indicates whether the statistics are collected in the current
+  /// execution.
+  bool collect_statistics_;
+  /// @brief Indicates whether the hardware counters are read in the current
+  /// execution.
+  bool collect_counters_;
+  std::chrono::high_resolution_clock::time_point execution_start_;
+};
 
 class TransformTree : public Logger {
  public:
@@ -157,17 +315,104 @@ class TransformTree : public Logger {
 
   std::shared_ptr<formats::ArrayFormat16> RootFormat() const noexcept;
 
+  std::vector<std::string> FeatureNames() const noexcept;
+
+  /// @brief Returns the size in bytes of each feature's results of
+  /// Execute(), excluding the alignment gaps between the buffers.
+  std::unordered_map<std::string, size_t> FeatureSizes() const noexcept;
+
+  /// @brief Returns the size in bytes of the buffers arena of each
+  /// execution context. It is known after PrepareForExecution().
+  size_t NeededMemory() const noexcept;
+
   void AddFeature(
       const std::string& name,
       const std::vector<std::pair<std::string, std::string>>& transforms);
 
   void PrepareForExecution();
 
+  /// @brief Writes the solved memory allocation plan, so that an identical
+  /// tree can skip solving it with LoadAllocationPlan().
+  void SaveAllocationPlan(const std::string& fileName) const;
+
+  /// @brief Reads the memory allocation plan written by
+  /// SaveAllocationPlan(). PrepareForExecution() applies it instead of
+  /// running the allocator. It must be called after all the features
+  /// are added.
+  /// @return False if the file can not be read or describes another tree.
+  bool LoadAllocationPlan(const std::string& fileName);
+
   std::unordered_map<std::string, std::shared_ptr<Buffers>> Execute(
       const int16_t* in);
 
+  /// @brief Creates the independent state to execute the prepared tree
+  /// with, allocating a new buffers arena. The transforms, their parameters
+  /// and the FFTF plans are shared with the tree.
+  std::unique_ptr<ExecutionContext> CreateExecutionContext() const;
+
+  /// @brief The FFTF plans of the tree and of its execution contexts.
+  const FFTFPlanCache& plan_cache() const noexcept;
+
+  /// @brief Executes the tree using the specified context. It is safe to
+  /// call this method simultaneously from several threads, provided that
+  /// they use different contexts.
+  /// @return The feature buffers, which reside in the context's arena.
+  std::unordered_map<std::string, std::shared_ptr<Buffers>> Execute(
+      ExecutionContext* context, const int16_t* in) const;
+
+  /// @brief Executes only the nodes which the specified features depend on,
+  /// skipping the rest of the tree. The same prepared tree and arena serve
+  /// any subset of the features.
+  /// @return The buffers of the requested features.
+  std::unordered_map<std::string, std::shared_ptr<Buffers>> Execute(
+      const int16_t* in, const std::vector<std::string>& features);
+  std::unordered_map<std::string, std::shared_ptr<Buffers>> Execute(
+      ExecutionContext* context, const int16_t* in,
+      const std::vector<std::string>& features) const;
+
+  /// @brief Executes the tree on the next piece of the stream.
+  /// @param in RootFormat()->Size() sequential samples of the stream.
+  /// @param validSamples The number of meaningful samples in "in". It is less
+  /// than RootFormat()->Size() only for the zero padded last piece.
+  /// @return The windows of each feature which were completed by this piece.
+  std::unordered_map<std::string, std::shared_ptr<Buffers>> ExecuteStream(
+      const int16_t* in, size_t validSamples);
+  /// @param last Indicates whether the stream ends with this piece. After
+  /// the last piece, the pieces with zero validSamples drain the windows
+  /// delayed by the transforms which look ahead, until StreamPending()
+  /// becomes false.
+  std::unordered_map<std::string, std::shared_ptr<Buffers>> ExecuteStream(
+      const int16_t* in, size_t validSamples, bool last);
+
+  /// @brief Indicates whether some transforms hold the windows of the ended
+  /// stream which have not been output yet.
+  bool StreamPending() const;
+
+  /// @brief Starts a new stream, discarding the state carried by
+  /// the transforms.
+  void ResetStream();
+
   std::unordered_map<std::string, float> ExecutionTimeReport() const noexcept;
+  std::unordered_map<std::string, float> ExecutionTimeReport(
+      const ExecutionContext& context) const noexcept;
   void Dump(const std::string& dotFileName) const;
+  /// @brief Returns the statistics of each executed node as JSON: the number
+  /// of executions, the total, minimal, maximal times and the percentiles
+  /// in nanoseconds, the sizes of the input and output buffers and
+  /// the thread which executed the node the last time.
+  std::string StatisticsReport() const;
+  std::string StatisticsReport(const ExecutionContext& context) const;
+  /// @brief Returns the nodes of the last execution in the Chrome trace
+  /// event format, which is understood by chrome://tracing.
+  std::string ChromeTrace() const;
+  std::string ChromeTrace(const ExecutionContext& context) const;
+  /// @brief Returns the hardware counters summed by the transform name.
+  /// It is empty if they have not been collected.
+  std::unordered_map<std::string, PerfSample> PerfReport() const;
+  std::unordered_map<std::string, PerfSample> PerfReport(
+      const ExecutionContext& context) const;
+  void ResetStatistics() noexcept;
+  void ResetStatistics(ExecutionContext* context) const noexcept;
 
   bool validate_after_each_transform() const noexcept;
   void set_validate_after_each_transform(bool value) noexcept;
@@ -175,8 +420,80 @@ class TransformTree : public Logger {
   void set_dump_buffers_after_each_transform(bool value) noexcept;
   bool cache_optimization() const noexcept;
   void set_cache_optimization(bool value) noexcept;
+  /// @brief Indicates whether the chains of Fusable transforms are replaced
+  /// with a single node which executes them buffer by buffer, without
+  /// the intermediate buffers.
+  bool fusion() const noexcept;
+  void set_fusion(bool value) noexcept;
+  /// @brief The CPU cache level which the sliced cycles are tiled to.
+  /// If a slice does not fit into it, the next level is used. The time
+  /// spent in each cycle is reported under the name which includes
+  /// the chosen level. The manual set_cpu_cache_size() overrides this.
+  int cache_level() const noexcept;
+  void set_cache_level(int value) noexcept;
+  /// @brief Indicates whether guard_mode() is GuardMode::kProtect.
   bool memory_protection() const noexcept;
+  /// @brief Sets guard_mode() to GuardMode::kProtect or GuardMode::kOff.
   void set_memory_protection(bool value) noexcept;
+  /// @brief The way the buffers are checked for overruns. The default is
+  /// GuardMode::kCanary.
+  GuardMode guard_mode() const noexcept;
+  /// @brief Sets guard_mode(). The canaries are allocated together with
+  /// the buffers, so after PrepareForExecution() the canary modes may be
+  /// chosen only if the tree was prepared in one of them.
+  void set_guard_mode(GuardMode value);
+  /// @brief The number of executions per check in GuardMode::kSampled.
+  int guard_sampling_period() const noexcept;
+  /// @brief Sets guard_sampling_period(). The values less than 1 are treated
+  /// as 1.
+  void set_guard_sampling_period(int value) noexcept;
+  /// @brief Indicates whether the input is the sequence of pieces of the same
+  /// signal rather than independent signals.
+  bool streaming() const noexcept;
+  /// @brief Switches the streaming mode. It must be called before any
+  /// feature is added.
+  void set_streaming(bool value);
+  /// @brief The solver of the buffers placement problem which is used by
+  /// PrepareForExecution(). HeuristicAllocator is the default, since
+  /// the exhaustive SlidingBlocksAllocator used before takes factorial
+  /// time on the trees of many features; the latter may still be set for
+  /// the small trees.
+  std::shared_ptr<memory_allocation::BuffersAllocator> allocator() const
+      noexcept;
+  void set_allocator(
+      const std::shared_ptr<memory_allocation::BuffersAllocator>& value)
+      noexcept;
+  /// @brief Indicates whether the per-node statistics are collected, see
+  /// StatisticsReport(). It may be switched while the tree is executed
+  /// in the other threads, which take it into account on the next
+  /// execution. The default is false.
+  bool collect_statistics() const noexcept;
+  void set_collect_statistics(bool value) noexcept;
+  /// @brief Indicates whether the hardware counters (cycles, instructions,
+  /// LLC and branch misses) of each transform are collected. They are
+  /// included into StatisticsReport() and Dump(). If perf_event_open() is
+  /// not permitted, only the timers are collected. The default is false.
+  /// @details The counters include the OpenMP workers of the transforms,
+  /// provided that branch_threads_number() is 1 and no other execution with
+  /// the counters (of any tree or context) runs at the same time. Otherwise
+  /// only the thread which executes the node is counted, since the process
+  /// wide sum would include the work of the simultaneous executions.
+  bool perf_counters() const noexcept;
+  void set_perf_counters(bool value) noexcept;
+  /// @brief The number of threads which execute the independent branches
+  /// of the tree simultaneously. 1 (the default) means that the nodes are
+  /// executed one by one in the order chosen by the allocator.
+  /// @details The branches are OpenMP tasks and the nested parallelism is
+  /// not enabled, so if this number is greater than 1, the parallel loops of
+  /// the transforms and the FFTF plans run on a single thread. This pays off
+  /// for the wide trees of many cheap branches, while a narrow tree of heavy
+  /// transforms is faster with 1 and get_omp_transforms_max_threads_num()
+  /// threads inside each transform. The benchmark measures both with
+  /// --threads and --omp-threads.
+  int branch_threads_number() const noexcept;
+  /// @brief Sets branch_threads_number(). The values less than 1 are
+  /// treated as 1.
+  void set_branch_threads_number(int value) noexcept;
 
  private:
   class Node : public Logger {
@@ -199,45 +516,138 @@ class TransformTree : public Logger {
     std::shared_ptr<Node> FindIdenticalChildTransform(const Transform& base)
         const noexcept;
 
+    /// @brief Adds the children to the allocation tree. Each sliced cycle
+    /// is allocated as a single block which is owned by the cycle's first
+    /// member and is the parent of the cycle's outer children.
     void BuildAllocationTree(memory_allocation::Node* node) const noexcept;
 
-    void ApplyAllocationTree(const memory_allocation::Node& node,
-                             void* allocatedMemory) noexcept;
+    void ApplyAllocationTree(const memory_allocation::Node& node) noexcept;
 
-    void Execute() noexcept;
+    /// @brief Runs BoundTransform on the parent's buffers.
+    void Execute(ExecutionContext* context) const;
+
+    /// @brief Returns the buffers which are passed to BoundTransform->Do(),
+    /// taking into account the sliced cycles.
+    std::shared_ptr<Buffers> ParentBuffers(
+        const ExecutionContext& context) const noexcept;
 
     size_t ChildrenCount() const noexcept;
     std::shared_ptr<Node> SelfPtr() const noexcept;
+    /// @brief The size of the output buffers in the arena.
+    size_t AllocatedSize() const noexcept;
+    /// @brief Indicates whether this is the first member of a sliced cycle,
+    /// which owns the cycle's block in the allocation tree.
+    bool IsCycleLeader() const noexcept;
+    /// @brief Returns the canary word which follows the output buffers or
+    /// nullptr if the node has no canary.
+    uint64_t* Canary(const ExecutionContext& context) const noexcept;
+    /// @brief Returns the greatest size of the cache resident data per buffer
+    /// while the subtree of this cycle member executes a slice.
+    /// @param held The size of the outputs of the ancestors which are still
+    /// used by the other branches.
+    size_t SliceWorkingSet(size_t held) const noexcept;
 
     TransformTree* Host;
     Node* Parent;
     const std::shared_ptr<Transform> BoundTransform;
-    std::shared_ptr<Buffers> BoundBuffers;
     size_t BuffersCount;
-    std::shared_ptr<MemoryProtector> Protection;
+    /// @brief The number of the allocated output buffers. It is less than
+    /// BuffersCount if the node belongs to a sliced cycle and only its
+    /// children read the output, so that a single slice is kept.
+    size_t ResidentBuffersCount;
+    /// @brief The index of the node's state in ExecutionContext.
+    size_t Index;
+    /// @brief The offset of the output buffers in the arena.
+    size_t Offset;
     std::unordered_map<std::string, std::vector<std::shared_ptr<Node>>>
     Children;
     /// @brief The next executed node in the pipeline.
     Node* Next;
     std::unordered_map<Node*, std::tuple<size_t, size_t>> Slices;
     Node* OriginalNode;
+    /// @brief The index of the first buffer of OriginalNode which belongs to
+    /// this clone.
+    size_t SliceIndex;
     int CycleId;
     bool HasClones;
+    /// @brief Indicates whether the output is the continuous signal rather
+    /// than the windows in the streaming mode.
+    bool StreamContinuous;
 
-    std::shared_ptr<std::chrono::high_resolution_clock::duration> ElapsedTime;
     std::vector<std::string> RelatedFeatures;
   };
 
   struct TransformCacheItem {
-    TransformCacheItem() : ElapsedTime(0), Dump(false) {
+    TransformCacheItem() : Dump(false) {
     }
 
-    std::shared_ptr<Transform> BoundTransform;
-    std::chrono::high_resolution_clock::duration ElapsedTime;
     bool Dump;
   };
 
+  /// @brief The solved memory allocation of the nodes in the order of
+  /// ActionOnSubtree().
+  struct AllocationPlan {
+    AllocationPlan() : NeededMemory(0) {
+    }
+
+    struct Entry {
+      std::string Name;
+      /// @brief The index of the parent node or -1 for the root.
+      int Parent;
+      size_t Size;
+      size_t Offset;
+      /// @brief The index of Node::Next or -1.
+      int Next;
+      /// @brief Node::CycleId.
+      int Cycle;
+    };
+
+    size_t NeededMemory;
+    std::vector<Entry> Entries;
+  };
+
+  /// @brief The order in which the nodes may be executed. The allocator
+  /// chooses the sequential order (Node::Next) and reuses the memory
+  /// accordingly, so a node may be executed out of that order only after
+  /// all the earlier nodes which access the same memory have finished.
+  struct Schedule {
+    /// @brief The executed nodes in the sequential order.
+    std::vector<const Node*> Nodes;
+    /// @brief The positions in Nodes of the nodes which wait for each node.
+    std::vector<std::vector<int>> Successors;
+    /// @brief The number of the nodes which each node waits for.
+    std::vector<int> PredecessorsCount;
+    /// @brief The positions in Nodes which each feature depends on.
+    std::unordered_map<std::string, std::vector<bool>> FeatureNodes;
+  };
+
+  struct BranchesExecution;
+
+  /// @brief The subtrees of the buffer invariant nodes which are executed
+  /// slice by slice, so that each slice of the head's output flows through
+  /// all the members before the next one starts.
+  struct SlicedCycle {
+    /// @brief The name in the time report.
+    std::string Name;
+    /// @brief The parent of the cycle's topmost members. It is not a member.
+    Node* Head;
+    /// @brief The original nodes in the order of ActionOnSubtree().
+    std::vector<Node*> Members;
+    size_t SliceBuffersCount;
+    /// @brief The size of the block which holds the buffers of all
+    /// the members.
+    size_t Size;
+  };
+
   static constexpr const char* kDumpEnvPrefix = "SFE_DUMP_";
+  static constexpr int kDefaultCacheLevel = 2;
+  static constexpr int kDefaultGuardSamplingPeriod = 64;
+  /// @brief The transforms with fewer instructions per cycle are marked
+  /// as memory bound in Dump().
+  static constexpr float kMemoryBoundIpc = 1.f;
+  static constexpr uint64_t kCanaryValue = 0xDEADBEEFFEEDFACEULL;
+  static constexpr const char* kAllocationPlanSignature =
+      "SoundFeatureExtraction allocation plan v2";
 
   void AddTransform(const std::string& name,
                     const std::string& parameters,
@@ -246,25 +656,87 @@ class TransformTree : public Logger {
   void AddIdentityTransform(const std::string& feature,
                             std::shared_ptr<Node>* currentNode);
 
-  int BuildSlicedCycles() noexcept;
-
-  void DismantleMemoryProtection() noexcept;
-  void ResetTimers() noexcept;
+  bool SetupStreaming(const Node& parent, Transform* transform);
+  void CheckFeatureStreams() const;
+  /// @param needed The positions in schedule_.Nodes to execute. If it is
+  /// null, all the nodes are executed.
+  void RunTransforms(ExecutionContext* context, const int16_t* in,
+                     const std::vector<bool>* needed = nullptr) const;
+  void BuildSchedule(const ExecutionContext& context);
+  /// @brief Calculates the estimated time to finish all the nodes which
+  /// depend on each node of schedule_, based on the previous execution.
+  std::vector<ExecutionContext::Duration::rep> CriticalPaths(
+      const ExecutionContext& context) const noexcept;
+  void ExecuteBranches(
+      ExecutionContext* context,
+      const std::vector<ExecutionContext::Duration::rep>& priorities,
+      const std::vector<bool>* needed) const;
+  void ExecuteBranch(BranchesExecution* execution, int index) const;
+  void AccumulateTimes(ExecutionContext* context) const noexcept;
+  std::vector<Node*> NodesInOrder() const;
+  AllocationPlan RecordAllocationPlan() const;
+  bool ApplyAllocationPlan(const AllocationPlan& plan);
+  /// @brief Checks that the loaded plan does not place the buffers which
+  /// are alive at the same time at the overlapping memory.
+  bool ValidateAllocationPlan(const AllocationPlan& plan,
+                              const std::vector<Node*>& nodes) const;
+  /// @brief Chooses the sliced cycles before the buffers are allocated.
+  /// @return The number of cycles.
+  int PlanSlicedCycles();
+  /// @brief Replaces the planned cycles with the clones of their members
+  /// which process the slices of buffers.
+  void BuildSlicedCycles();
+  /// @brief Chooses the number of buffers of the specified size in a slice.
+  /// @return The chosen cache level (0 if it is set manually) and the number
+  /// of buffers.
+  std::tuple<int, size_t> SliceBuffersCount(size_t bufferSize) const noexcept;
+  int FuseTransforms();
+  std::shared_ptr<Node> FuseChain(
+      Node* parent, const std::vector<std::shared_ptr<Node>>& chain);
+  std::unique_ptr<ExecutionContext> NewExecutionContext(
+      const std::shared_ptr<void>& memory) const;
+  void PrepareFFTFPlans(const ExecutionContext& context) const;
+
+  void DismantleMemoryProtection(ExecutionContext* context) const noexcept;
+  void ResetTimers(ExecutionContext* context) const noexcept;
 
   static float ConvertDuration(
       const std::chrono::high_resolution_clock::duration& d) noexcept;
 
-  /// @brief The continuous memory block containing all the buffers. It MUST
-  /// go before root_ because of the memory protection scheme (mprotect).
-  std::shared_ptr<void> allocated_memory_;
   /// @brief The transform tree to extract the features.
   std::shared_ptr<Node> root_;
   std::shared_ptr<formats::ArrayFormat16> root_format_;
   bool tree_is_prepared_;
+  /// @brief The size of the arena which contains all the buffers.
+  size_t needed_memory_;
+  /// @brief The number of nodes, including the clones.
+  size_t nodes_count_;
+  AllocationPlan allocation_plan_;
+  std::shared_ptr<memory_allocation::BuffersAllocator> allocator_;
+  Schedule schedule_;
+  int branch_threads_number_;
+  std::atomic<bool> collect_statistics_;
+  std::atomic<bool> perf_counters_;
+  /// @brief The context used by Execute(in) and ExecuteStream().
+  std::unique_ptr<ExecutionContext> context_;
   std::unordered_map<std::string, std::shared_ptr<Node>> features_;
   std::unordered_map<std::string, TransformCacheItem> transforms_cache_;
+  /// @brief The FFTF plans shared by all the transforms in the tree.
+  std::shared_ptr<FFTFPlanCache> fftf_plans_;
   bool cache_optimization_;
-  bool memory_protection_;
+  bool fusion_;
+  int cache_level_;
+  /// @brief The sliced cycles, indexed by Node::CycleId - 1.
+  std::vector<SlicedCycle> cycles_;
+  GuardMode guard_mode_;
+  int guard_sampling_period_;
+  /// @brief The space reserved after each node's buffers for the canary.
+  /// It is fixed by PrepareForExecution().
+  size_t canary_size_;
+  bool streaming_;
+  /// @brief The number of the leading windows of each node's output yet to
+  /// be discarded in the streaming mode.
+  std::unordered_map<const Node*, size_t> stream_delays_;
   bool validate_after_each_transform_;
   bool dump_buffers_after_each_transform_;
 };
@@ -32,7 +32,6 @@
 #include <simd/arithmetic-inl.h>
 #include <simd/correlate.h>
 #include <fftf/api.h>
-#include <mutex>
 
 namespace sound_feature_extraction {
 namespace transforms {
@@ -42,22 +41,25 @@ Autocorrelation::Autocorrelation() : normalize_(kDefaultNormalize) {
 
 ALWAYS_VALID_TP(Autocorrelation, normalize)
 
-void Autocorrelation::Initialize() const {
-  // Workaround for SIGSEGV in libav FFT with sizes greater than 2^16
-  if (input_format_->Size() > 32768) {
+void Autocorrelation::AvoidLibavBackend(size_t size) noexcept {
+  // The cross-correlation takes the FFT of twice the size
+  if (size > 32768) {
     fftf_set_backend_priority(FFTF_BACKEND_LIBAV, -1000);
     fftf_set_backend(FFTF_BACKEND_NONE);
   }
-  correlation_handles_.resize(threads_number());
-  for (int i = 0; i < threads_number(); i++) {
-    correlation_handles_[i].handle = std::shared_ptr<CrossCorrelationHandle>(
-        new CrossCorrelationHandle(cross_correlate_initialize(
-            input_format_->Size(), input_format_->Size())),
+}
+
+void Autocorrelation::Initialize() const {
+  size_t size = input_format_->Size();
+  AvoidLibavBackend(size);
+  correlation_handles_.Reset([size]() {
+    return std::shared_ptr<CrossCorrelationHandle>(
+        new CrossCorrelationHandle(cross_correlate_initialize(size, size)),
         [](CrossCorrelationHandle *ptr) {
           cross_correlate_finalize(*ptr);
           delete ptr;
         });
-  }
+  }, threads_number());
 }
 
 size_t Autocorrelation::OnFormatChanged(size_t buffersCount) {
@@ -66,20 +68,10 @@ size_t Autocorrelation::OnFormatChanged(size_t buffersCount) {
 }
 
 void Autocorrelation::Do(const float* in, float* out) const noexcept {
-  bool executed = false;
-  while (!executed) {
-    for (auto& hp : correlation_handles_) {
-      if (hp.mutex.try_lock()) {
-        cross_correlate(*hp.handle, in, in, out);
-        hp.mutex.unlock();
-        if (normalize_) {
-          float norm = 1 / out[input_format_->Size() - 1];
-          real_multiply_scalar(out, output_format_->Size(), norm, out);
-        }
-        executed = true;
-        break;
-      }
-    }
+  cross_correlate(*correlation_handles_.Get(), in, in, out);
+  if (normalize_) {
+    float norm = 1 / out[input_format_->Size() - 1];
+    real_multiply_scalar(out, output_format_->Size(), norm, out);
   }
 }
 
@@ -31,8 +31,6 @@
 #ifndef SRC_TRANSFORMS_AUTOCORRELATION_H_
 #define SRC_TRANSFORMS_AUTOCORRELATION_H_
 
-#include <vector>
-#include <mutex>
 #include "src/transforms/common.h"
 
 typedef struct ConvolutionHandle CrossCorrelationHandle;
@@ -55,6 +53,13 @@ class Autocorrelation
 
   void Initialize() const override;
 
+  /// @brief Switches FFTF away from libav before the cross-correlation of
+  /// the specified size is initialized, because libav FFT crashes with
+  /// SIGSEGV on the sizes greater than 2^16.
+  /// @note The backend priority is global, so it changes the backend of all
+  /// the FFTF plans created afterwards, including the other transforms'.
+  static void AvoidLibavBackend(size_t size) noexcept;
+
  protected:
   virtual size_t OnFormatChanged(size_t buffersCount) override;
 
@@ -63,18 +68,8 @@ class Autocorrelation
   static constexpr bool kDefaultNormalize = false;
 
  private:
-  struct SyncHandle {
-    SyncHandle() : handle(nullptr, std::free) {
-    }
-
-    SyncHandle(const SyncHandle&) : handle(nullptr, std::free) {
-    }
-
-    std::shared_ptr<CrossCorrelationHandle> handle;
-    std::mutex mutex;
-  };
-
-  mutable std::vector<SyncHandle> correlation_handles_;
+  mutable ThreadWorkspace<std::shared_ptr<CrossCorrelationHandle>>
+      correlation_handles_;
 };
 
 }  // namespace transforms
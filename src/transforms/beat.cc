@@ -31,9 +31,10 @@
 #include "src/transforms/beat.h"
 #include <algorithm>
 #include <cmath>
+#include <fftf/api.h>
 #include <simd/detect_peaks.h>
 #include "src/make_unique.h"
-#include "src/primitives/energy.h"
+#include "src/transforms/autocorrelation.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
@@ -98,16 +99,22 @@ size_t Beat::OnInputFormatChanged(size_t buffersCount) {
 }
 
 void Beat::Initialize() const {
-  float max_period = floorf(60 * input_format_->SamplingRate() / min_bpm_);
-  size_t max_pulses_length = PulsesLength(pulses_, max_period);
-
-  int count = threads_number();
-  buffers_.resize(count);
-  for (int i = 0; i < count; i++) {
-    buffers_[i].data = std::uniquify(mallocf(
-        (this->input_format_->Size() + max_pulses_length - 1) * sizeof(float)),
-        std::free);
-  }
+  size_t size = input_format_->Size();
+  Autocorrelation::AvoidLibavBackend(size);
+  buffers_.Reset([size]() {
+    return std::uniquify(mallocf(size * 2 - 1), std::free);
+  }, threads_number());
+  autocorrelations_.Reset([size]() {
+    return std::uniquify(mallocf(size), std::free);
+  }, threads_number());
+  correlation_handles_.Reset([size]() {
+    return std::shared_ptr<CrossCorrelationHandle>(
+        new CrossCorrelationHandle(cross_correlate_initialize(size, size)),
+        [](CrossCorrelationHandle *ptr) {
+          cross_correlate_finalize(*ptr);
+          delete ptr;
+        });
+  }, threads_number());
 }
 
 void Beat::CombConvolve(const float* in, size_t size, int pulses,
@@ -138,6 +145,37 @@ void Beat::CombConvolve(const float* in, size_t size, int pulses,
   }
 }
 
+float Beat::CombEnergy(const float* autocorrelation, size_t size,
+                      int pulses, int period) noexcept {
+  // The convolution is the sum of the shifted copies of the input, so its
+  // energy is the sum of their pairwise dot products
+  float energy = pulses * autocorrelation[0];
+  for (int m = 1; m < pulses; m++) {
+    size_t lag = static_cast<size_t>(m) * period;
+    if (lag >= size) {
+      break;
+    }
+    energy += 2 * (pulses - m) * autocorrelation[lag];
+  }
+  return energy;
+}
+
+void Beat::CalculateAutocorrelation(const BuffersBase<float*>& in,
+                                    size_t inIndex,
+                                    float* out) const noexcept {
+  int size = input_format_->Size();
+  auto buffer = buffers_.Get().get();
+  auto handle = *correlation_handles_.Get();
+  std::fill(out, out + size, 0.f);
+  for (size_t i = inIndex; i < inIndex + bands_ && i < in.Count(); i++) {
+    cross_correlate(handle, in[i], in[i], buffer);
+    // The zero lag is in the middle
+    for (int j = 0; j < size; j++) {
+      out[j] += buffer[size - 1 + j];
+    }
+  }
+}
+
 void Beat::Do(const BuffersBase<float*>& in,
               BuffersBase<formats::FixedArray<2>*>* out)
     const noexcept {
@@ -146,9 +184,12 @@ void Beat::Do(const BuffersBase<float*>& in,
 #endif
   for (size_t ini = 0; ini < in.Count(); ini += bands_) {
     std::vector<float> energies;
+    auto autocorrelation = autocorrelations_.Get().get();
+    CalculateAutocorrelation(in, ini, autocorrelation);
 
     // First pass - rough peaks estimation
-    CalculateBeatEnergies(in, ini, min_bpm_, max_bpm_, resolution1_, &energies);
+    CalculateBeatEnergies(autocorrelation, min_bpm_, max_bpm_, resolution1_,
+                          &energies);
 
     // Output the energies for the reference
     if (debug_) {
@@ -187,7 +228,7 @@ void Beat::Do(const BuffersBase<float*>& in,
 
     // Second pass - increase peaks precision
     for (int pind = 0; pind < rcount; pind++) {
-      CalculateBeatEnergies(in, ini,
+      CalculateBeatEnergies(autocorrelation,
                             min_bpm_ + (results[pind].position-1)*resolution1_,
                             min_bpm_ + (results[pind].position+1)*resolution1_,
                             resolution2_, &energies,
@@ -202,7 +243,7 @@ void Beat::Do(const BuffersBase<float*>& in,
   }
 }
 
-void Beat::CalculateBeatEnergies(const BuffersBase<float*>& in, size_t inIndex,
+void Beat::CalculateBeatEnergies(const float* autocorrelation,
                                  float min_bpm, float max_bpm, float step,
                                  std::vector<float>* energies,
                                  float* max_energy_bpm_found,
@@ -213,34 +254,15 @@ void Beat::CalculateBeatEnergies(const BuffersBase<float*>& in, size_t inIndex,
   float max_energy = 0;
   float max_energy_bpm = min_bpm;
 
-  bool executed = false;
-  while (!executed) {
-    for (auto& tsbuf : buffers_) {
-      if (tsbuf.mutex.try_lock()) {
-        auto buffer = tsbuf.data.get();
-        for (int i = 0; i < search_size; i++) {
-          float bpm = min_bpm + step * i;
-          // 60 is the number of seconds in one minute
-          int period = floorf(60 * input_format_->SamplingRate() / bpm);
-          float current_energy = 0;
-          size_t conv_length = size + PulsesLength(pulses_, period) - 1;
-          for (size_t i = inIndex;
-              i < inIndex + bands_ && i < in.Count();
-              i++) {
-            CombConvolve(in[i], size, pulses_, period, buffer);
-            current_energy += calculate_energy(Beat::use_simd(), false, buffer,
-                                               conv_length);
-          }
-          (*energies)[i] = current_energy;
-          if (current_energy > max_energy) {
-            max_energy = current_energy;
-            max_energy_bpm = bpm;
-          }
-        }
-        tsbuf.mutex.unlock();
-        executed = true;
-        break;
-      }
+  for (int i = 0; i < search_size; i++) {
+    float bpm = min_bpm + step * i;
+    // 60 is the number of seconds in one minute
+    int period = floorf(60 * input_format_->SamplingRate() / bpm);
+    float current_energy = CombEnergy(autocorrelation, size, pulses_, period);
+    (*energies)[i] = current_energy;
+    if (current_energy > max_energy) {
+      max_energy = current_energy;
+      max_energy_bpm = bpm;
     }
   }
 
@@ -31,9 +31,9 @@
 #ifndef SRC_TRANSFORMS_BEAT_H_
 #define SRC_TRANSFORMS_BEAT_H_
 
-#include <mutex>
 #include <tuple>
 #include <vector>
+#include <simd/correlate.h>
 #include "src/formats/fixed_array.h"
 #include "src/formats/single_format.h"
 #include "src/transforms/common.h"
@@ -78,9 +78,21 @@ class Beat
   static void CombConvolve(const float* in, size_t size, int pulses,
                            int period, float* out) noexcept;
 
+  /// @brief Calculates the energy of CombConvolve() result using
+  /// the autocorrelation of the input:
+  /// E = pulses * R(0) + 2 * sum_{m=1}^{pulses-1} (pulses - m) R(m period).
+  /// @param autocorrelation R(lag) for lag in [0, size).
+  static float CombEnergy(const float* autocorrelation, size_t size,
+                          int pulses, int period) noexcept;
+
+  /// @brief Sums the autocorrelations of the bands of the envelope.
+  /// @param out R(lag) for lag in [0, input size).
+  void CalculateAutocorrelation(const BuffersBase<float*>& in,
+                                size_t inIndex, float* out) const noexcept;
+
  private:
   static size_t PulsesLength(int pulses_count, int period) noexcept;
-  void CalculateBeatEnergies(const BuffersBase<float*>& in, size_t inIndex,
+  void CalculateBeatEnergies(const float* autocorrelation,
                              float min_bpm, float max_bpm, float step,
                              std::vector<float>* energies,
                              float* max_energy_bpm_found = nullptr,
@@ -95,7 +107,12 @@ class Beat
   static constexpr int kDefaultPeaks = 3;
   static constexpr bool kDefaultDebug = false;
 
-  mutable std::vector<ThreadSafeFloatPtr> buffers_;
+  /// @brief The full cross-correlation of a band with itself.
+  mutable ThreadWorkspace<FloatPtr> buffers_;
+  /// @brief The summed autocorrelation of the bands.
+  mutable ThreadWorkspace<FloatPtr> autocorrelations_;
+  mutable ThreadWorkspace<std::shared_ptr<CrossCorrelationHandle>>
+      correlation_handles_;
 };
 
 }  // namespace transforms
@@ -34,6 +34,7 @@
 #include "src/formats/array_format.h"
 #include "src/omp_transform_base.h"
 #include "src/floatptr.h"
+#include "src/thread_workspace.h"
 
 namespace sound_feature_extraction {
 
@@ -32,12 +32,14 @@
 #define SRC_TRANSFORMS_DCT_H_
 
 #include "src/formats/array_format.h"
+#include "src/fftf_plan_cache.h"
 #include "src/transform_base.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
 
-class DCT : public UniformFormatTransform<formats::ArrayFormatF> {
+class DCT : public UniformFormatTransform<formats::ArrayFormatF>,
+            public FFTFPlanCacheAware {
  public:
   TRANSFORM_INTRO("DCT", "Performs Discrete Cosine Transform "
                          "on the signal.",
@@ -47,20 +49,33 @@ class DCT : public UniformFormatTransform<formats::ArrayFormatF> {
     return true;
   }
 
+  virtual void PreparePlans(const Buffers& in,
+                            Buffers* out) const override;
+
  protected:
   virtual void Do(const BuffersBase<float*>& in,
                   BuffersBase<float*>* out) const noexcept override;
+
+ private:
+  const FFTFInstance* Plan(const Buffers& in, Buffers* out) const;
 };
 
-class DCTInverse : public InverseUniformFormatTransform<DCT> {
+class DCTInverse : public InverseUniformFormatTransform<DCT>,
+                   public FFTFPlanCacheAware {
  public:
   virtual bool BufferInvariant() const noexcept override final {
     return true;
   }
 
+  virtual void PreparePlans(const Buffers& in,
+                            Buffers* out) const override;
+
  protected:
   virtual void Do(const BuffersBase<float*>& in,
                   BuffersBase<float*>* out) const noexcept override;
+
+ private:
+  const FFTFInstance* Plan(const Buffers& in, Buffers* out) const;
 };
 
 }  // namespace transforms
@@ -29,7 +29,9 @@
  */
 
 #include "src/transforms/delta.h"
+#include <algorithm>
 #include <simd/arithmetic-inl.h>
+#include "src/make_unique.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
@@ -47,10 +49,12 @@ DeltaType Parse(const std::string& value, identity<DeltaType>) {
 }
 
 constexpr DeltaType Delta::kDefaultDeltaType;
+constexpr int Delta::kBlockSize;
 
 Delta::Delta()
     : type_(kDefaultDeltaType),
-      rlength_(kDefaultRegressionLength) {
+      rlength_(kDefaultRegressionLength),
+      buffers_count_(0) {
 }
 
 ALWAYS_VALID_TP(Delta, type)
@@ -58,38 +62,175 @@ bool Delta::validate_rlength(const int& value) noexcept {
   return value >= 3 && (value % 2) == 1;
 }
 
+size_t Delta::OnFormatChanged(size_t buffersCount) {
+  buffers_count_ = buffersCount;
+  return buffersCount;
+}
+
+void Delta::Initialize() const {
+  size_t stride = ScratchStride(input_format_->Size());
+  buffers_.Reset([stride]() {
+    return std::uniquify(mallocf(stride * 2), std::free);
+  }, threads_number());
+  if (streaming()) {
+    size_t back = 1, front = 1;
+    if (type_ == DeltaType::kRegression) {
+      // The block of a buffer may start kBlockSize - 1 buffers earlier;
+      // buffer 0 copies buffer 1 which needs buffer 2
+      int rstep = rlength_ / 2;
+      back = rstep + kBlockSize - 1;
+      front = std::max(rstep, 2);
+    }
+    stream_.Initialize(input_format_, buffers_count_, back, front);
+  }
+}
+
+void Delta::ResetStream() const {
+  stream_.Reset();
+}
+
+bool Delta::StreamsWindows() const noexcept {
+  return true;
+}
+
+StreamPiece Delta::PrepareStreamPiece(const StreamPiece& input) const
+    noexcept {
+  return stream_.Prepare(input);
+}
+
+bool Delta::StreamPending() const noexcept {
+  return stream_.Pending();
+}
+
 void Delta::Do(const BuffersBase<float*>& in,
                BuffersBase<float*>* out) const noexcept {
+  if (streaming()) {
+    stream_.Process(in, out, [this](
+        const BuffersBase<float*>& sequence, size_t origin, size_t first,
+        size_t last, BuffersBase<float*>* results) {
+      Calculate(sequence, origin, first, last, results);
+    });
+    return;
+  }
+  Calculate(in, 0, 0, in.Count(), out);
+}
+
+void Delta::Calculate(const BuffersBase<float*>& in, size_t origin,
+                      int first, int last,
+                      BuffersBase<float*>* out) const noexcept {
   switch (type_) {
     case DeltaType::kSimple:
-      for (size_t i = 1; i < in.Count(); i++) {
-        DoSimple(use_simd(), in[i - 1], in[i],
-                 input_format_->Size(), (*out)[i]);
-      }
-      for (size_t i = 0; i < input_format_->Size(); i++) {
-        (*out)[0][i] = (*out)[1][i];
-      }
-    break;
-    case DeltaType::kRegression: {
-      int rstep = rlength_ / 2;
-      float norm = 2 * rstep * (rstep + 1) * (2 * rstep + 1) / 6;
-      for (size_t i = rstep; i < in.Count() - rstep; i++) {
-        DoRegression(use_simd(), in, rstep, i, norm, input_format_->Size(),
-                     out);
+      DoSimple(in, first, last, out);
+      break;
+    case DeltaType::kRegression:
+      DoRegression(in, origin, first, last, out);
+      break;
+  }
+}
+
+void Delta::DoSimple(const BuffersBase<float*>& in, int first, int last,
+                     BuffersBase<float*>* out) const noexcept {
+  int count = in.Count();
+  int size = input_format_->Size();
+  if (count < 2) {
+    for (int i = first; i < last; i++) {
+      std::fill((*out)[i], (*out)[i] + size, 0.f);
+    }
+    return;
+  }
+  // Buffer 0 copies buffer 1
+  int begin = std::max(first, 1);
+  int end = std::max(last, 2);
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for num_threads(threads_number())
+#endif
+  for (int i = begin; i < end; i++) {
+    DoSimple(use_simd(), in[i - 1], in[i], size, (*out)[i]);
+  }
+  if (first == 0) {
+    std::copy((*out)[1], (*out)[1] + size, (*out)[0]);
+  }
+}
+
+void Delta::DoRegression(const BuffersBase<float*>& in, size_t origin,
+                         int first, int last,
+                         BuffersBase<float*>* out) const noexcept {
+  int count = in.Count();
+  int size = input_format_->Size();
+  if (count < 3) {
+    // There are no buffers with both neighbours
+    for (int i = first; i < last; i++) {
+      if (count == 2) {
+        DoSimple(use_simd(), in[0], in[1], size, (*out)[i]);
+      } else {
+        std::fill((*out)[i], (*out)[i] + size, 0.f);
       }
-      for (size_t i = rstep - 1; i > 0; i--) {
-        norm = 2 * i * (i + 1) * (2 * i + 1) / 6;
-        DoRegression(use_simd(), in, i, i, norm, input_format_->Size(), out);
-        DoRegression(use_simd(), in, in.Count() - i, i, norm,
-                     input_format_->Size(), out);
+    }
+    return;
+  }
+  // The first and the last buffers copy their neighbours
+  bool copy_first = first == 0, copy_last = last == count;
+  if (copy_first) {
+    last = std::max(last, 2);
+  }
+  if (copy_last) {
+    first = std::min(first, count - 2);
+  }
+  int rstep = rlength_ / 2;
+  // The buffers with the full window, [rstep, count - rstep). The blocks
+  // are aligned to the beginning of the stream, so that the rounding does not
+  // depend on how the stream is split into pieces.
+  int begin = std::max(first, rstep);
+  int end = std::min(last, count - rstep);
+  int offset = origin;
+  int first_block = 0, blocks = 0;
+  if (begin < end) {
+    first_block = (offset + begin - rstep) / kBlockSize;
+    blocks = (offset + end - 1 - rstep) / kBlockSize + 1 - first_block;
+  }
+  float scale = 1 / RegressionNorm(rstep);
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for num_threads(threads_number())
+#endif
+  for (int b = 0; b < blocks; b++) {
+    float* sums = buffers_.Get().get();
+    // Keep wsums aligned for the SIMD loads and stores
+    float* wsums = sums + ScratchStride(size);
+    int start = rstep + (first_block + b) * kBlockSize - offset;
+    int bfirst = std::max(start, begin);
+    int blast = std::min(start + kBlockSize, end);
+    InitializeRegressionSums(in, rstep, start, size, sums, wsums);
+    for (int i = start; i < blast; i++) {
+      if (i >= bfirst) {
+        real_multiply_scalar(wsums, size, scale, (*out)[i]);
       }
-      for (size_t i = 0; i < input_format_->Size(); i++) {
-        (*out)[0][i] = (*out)[1][i];
-        (*out)[in.Count() - 1][i] = (*out)[in.Count() - 2][i];
+      if (i + 1 < blast) {
+        SlideRegressionSums(use_simd(), in, rstep, i, size, sums, wsums);
       }
-      break;
     }
   }
+  // The window shrinks near the edges
+  for (int i = std::max(first, 1); i < std::min(last, count - 1); i++) {
+    int r = std::min(i, count - 1 - i);
+    if (r < rstep) {
+      DoRegression(in, r, i, size, (*out)[i]);
+    }
+  }
+  if (copy_first) {
+    std::copy((*out)[1], (*out)[1] + size, (*out)[0]);
+  }
+  if (copy_last) {
+    std::copy((*out)[count - 2], (*out)[count - 2] + size,
+              (*out)[count - 1]);
+  }
+}
+
+size_t Delta::ScratchStride(size_t size) noexcept {
+  return (size + 15) & ~static_cast<size_t>(15);
+}
+
+float Delta::RegressionNorm(int rstep) noexcept {
+  return rstep * (rstep + 1) * (2 * rstep + 1) / 3.f;
 }
 
 void Delta::DoSimple(bool simd, const float* prev, const float* cur,
@@ -138,57 +279,84 @@ void Delta::DoSimple(bool simd, const float* prev, const float* cur,
   }
 }
 
-void Delta::DoRegression(bool simd, const BuffersBase<float*>& in,
-                         int rstep, int i, float norm, int windowSize,
-                         BuffersBase<float*>* out) noexcept {
-  assert(false && "Unstable implementation of Delta regression");
+void Delta::DoRegression(const BuffersBase<float*>& in,
+                         int rstep, int i, int windowSize,
+                         float* out) noexcept {
+  float norm = RegressionNorm(rstep);
+  for (int j = 0; j < windowSize; j++) {
+    float sum = 0.f;
+    for (int k = 1; k <= rstep; k++) {
+      sum += (in[i + k][j] - in[i - k][j]) * k;
+    }
+    out[j] = sum / norm;
+  }
+}
+
+void Delta::InitializeRegressionSums(const BuffersBase<float*>& in,
+                                     int rstep, int i, int windowSize,
+                                     float* sums, float* wsums) noexcept {
+  std::fill(sums, sums + windowSize, 0.f);
+  std::fill(wsums, wsums + windowSize, 0.f);
+  for (int k = -rstep; k <= rstep; k++) {
+    const float* buffer = in[i + k];
+    for (int j = 0; j < windowSize; j++) {
+      sums[j] += buffer[j];
+      wsums[j] += k * buffer[j];
+    }
+  }
+}
+
+void Delta::SlideRegressionSums(bool simd, const BuffersBase<float*>& in,
+                                int rstep, int i, int windowSize,
+                                float* sums, float* wsums) noexcept {
+  // S(i + 1) = S(i) - in[i - rstep] + in[i + rstep + 1]
+  // W(i + 1) = W(i) - S(i) + (rstep + 1) in[i - rstep] +
+  //            rstep in[i + rstep + 1]
+  const float* leaving = in[i - rstep];
+  const float* entering = in[i + rstep + 1];
+  float lweight = rstep + 1, eweight = rstep;
   if (simd) {
 #ifdef __AVX__
-    __m256 normvec = _mm256_set1_ps(norm);
+    const __m256 lwvec = _mm256_set1_ps(lweight);
+    const __m256 ewvec = _mm256_set1_ps(eweight);
     for (int j = 0; j < windowSize - 7; j += 8) {
-      __m256 sum = _mm256_setzero_ps();
-      __m256 kvec = _mm256_set1_ps(1.f);
-      for (int k = 1; k <= rstep; k++) {
-        __m256 rvec = _mm256_load_ps(in[i + k] + j);
-        __m256 lvec = _mm256_load_ps(in[i - k] + j);
-        __m256 diff = _mm256_sub_ps(rvec, lvec);
-        diff = _mm256_mul_ps(diff, kvec);
-        sum = _mm256_add_ps(sum, diff);
-        kvec = _mm256_add_ps(kvec, _mm256_set1_ps(1.f));
-      }
-      sum = _mm256_div_ps(sum, normvec);
-      _mm256_store_ps((*out)[i] + j, sum);
+      __m256 svec = _mm256_load_ps(sums + j);
+      __m256 wvec = _mm256_load_ps(wsums + j);
+      __m256 lvec = _mm256_load_ps(leaving + j);
+      __m256 evec = _mm256_load_ps(entering + j);
+      wvec = _mm256_sub_ps(wvec, svec);
+      wvec = _mm256_add_ps(wvec, _mm256_mul_ps(lvec, lwvec));
+      wvec = _mm256_add_ps(wvec, _mm256_mul_ps(evec, ewvec));
+      svec = _mm256_add_ps(svec, _mm256_sub_ps(evec, lvec));
+      _mm256_store_ps(sums + j, svec);
+      _mm256_store_ps(wsums + j, wvec);
     }
     for (int j = windowSize & ~7; j < windowSize; j++) {
-      float sum = 0.f;
-      for (int k = 1; k <= rstep; k++) {
-        sum += (in[i + k][j] - in[i - k][j]) * k;
-      }
-      (*out)[i][j] = sum / norm;
+      wsums[j] = wsums[j] - sums[j] + leaving[j] * lweight +
+          entering[j] * eweight;
+      sums[j] += entering[j] - leaving[j];
     }
     return;
   } else {
 #elif defined(__ARM_NEON__)
-    float32x4_t normvec = vdupq_n_f32(1.f / norm);
+    const float32x4_t lwvec = vdupq_n_f32(lweight);
+    const float32x4_t ewvec = vdupq_n_f32(eweight);
     for (int j = 0; j < windowSize - 3; j += 4) {
-      float32x4_t sum = vdupq_n_f32(0.f);
-      float32x4_t kvec = vdupq_n_f32(1.f);
-      for (int k = 1; k <= rstep; k++) {
-        float32x4_t rvec = vld1q_f32(in[i + k] + j);
-        float32x4_t lvec = vld1q_f32(in[i - k] + j);
-        float32x4_t diff = vsubq_f32(rvec, lvec);
-        sum = vmlaq_f32(diff, kvec, sum);
-        kvec = vaddq_f32(kvec, vdupq_n_f32(1.f));
-      }
-      sum = vmulq_f32(sum, normvec);
-      vst1q_f32((*out)[i] + j, sum);
+      float32x4_t svec = vld1q_f32(sums + j);
+      float32x4_t wvec = vld1q_f32(wsums + j);
+      float32x4_t lvec = vld1q_f32(leaving + j);
+      float32x4_t evec = vld1q_f32(entering + j);
+      wvec = vsubq_f32(wvec, svec);
+      wvec = vmlaq_f32(wvec, lvec, lwvec);
+      wvec = vmlaq_f32(wvec, evec, ewvec);
+      svec = vaddq_f32(svec, vsubq_f32(evec, lvec));
+      vst1q_f32(sums + j, svec);
+      vst1q_f32(wsums + j, wvec);
     }
     for (int j = windowSize & ~3; j < windowSize; j++) {
-      float sum = 0.f;
-      for (int k = 1; k <= rstep; k++) {
-        sum += (in[i + k][j] - in[i - k][j]) * k;
-      }
-      (*out)[i][j] = sum / norm;
+      wsums[j] = wsums[j] - sums[j] + leaving[j] * lweight +
+          entering[j] * eweight;
+      sums[j] += entering[j] - leaving[j];
     }
     return;
   } else {
@@ -196,11 +364,9 @@ void Delta::DoRegression(bool simd, const BuffersBase<float*>& in,
   } {
 #endif
     for (int j = 0; j < windowSize; j++) {
-      float sum = 0.f;
-      for (int k = 1; k <= rstep; k++) {
-        sum += (in[i + k][j] - in[i - k][j]) * k;
-      }
-      (*out)[i][j] = sum / norm;
+      wsums[j] = wsums[j] - sums[j] + leaving[j] * lweight +
+          entering[j] * eweight;
+      sums[j] += entering[j] - leaving[j];
     }
   }
 }
@@ -31,8 +31,8 @@
 #ifndef SRC_TRANSFORMS_DELTA_H_
 #define SRC_TRANSFORMS_DELTA_H_
 
-#include "src/formats/array_format.h"
-#include "src/transform_base.h"
+#include "src/transforms/common.h"
+#include "src/lookahead_stream.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
@@ -72,7 +72,8 @@ namespace std {
 namespace sound_feature_extraction {
 namespace transforms {
 
-class Delta : public UniformFormatTransform<formats::ArrayFormatF> {
+class Delta : public UniformFormatOmpAwareTransform<formats::ArrayFormatF>,
+              public StreamingAware {
  public:
   Delta();
 
@@ -87,19 +88,75 @@ class Delta : public UniformFormatTransform<formats::ArrayFormatF> {
          "The linear regression window length. Only odd values "
          " greater than 1 are accepted.")
 
+  virtual bool BufferInvariant() const noexcept override final {
+    return false;
+  }
+
+  virtual void Initialize() const override;
+
+  virtual void ResetStream() const override;
+  virtual bool StreamsWindows() const noexcept override;
+  virtual StreamPiece PrepareStreamPiece(const StreamPiece& input) const
+      noexcept override;
+  virtual bool StreamPending() const noexcept override;
+
  protected:
   static constexpr DeltaType kDefaultDeltaType = DeltaType::kSimple;
   static constexpr int kDefaultRegressionLength = 5;
+  /// @brief The number of buffers in a block of the regression. The sliding
+  /// sums are recalculated from scratch at the beginning of each block,
+  /// since the rounding error of the weighted sums grows quadratically.
+  static constexpr int kBlockSize = 16;
+
+  virtual size_t OnFormatChanged(size_t buffersCount) override;
 
   virtual void Do(const BuffersBase<float*>& in,
                   BuffersBase<float*>* out) const noexcept override;
 
+  /// @brief Calculates the deltas of the buffers [first, last).
+  /// @param origin The index of in[0] in the stream. The blocks of
+  /// the regression are aligned to it.
+  void Calculate(const BuffersBase<float*>& in, size_t origin, int first,
+                 int last, BuffersBase<float*>* out) const noexcept;
+
+  void DoSimple(const BuffersBase<float*>& in, int first, int last,
+                BuffersBase<float*>* out) const noexcept;
+
+  void DoRegression(const BuffersBase<float*>& in, size_t origin, int first,
+                    int last, BuffersBase<float*>* out) const noexcept;
+
   static void DoSimple(bool simd, const float* prev, const float* cur,
                        size_t length, float* res) noexcept;
 
-  static void DoRegression(bool simd, const BuffersBase<float*>& in,
-                           int rstep, int i, float norm, int windowSize,
-                           BuffersBase<float*>* out) noexcept;
+  /// @brief Calculates the regression delta of buffer i directly.
+  /// @param rstep The number of buffers on each side to take.
+  static void DoRegression(const BuffersBase<float*>& in,
+                           int rstep, int i, int windowSize,
+                           float* out) noexcept;
+
+  /// @brief Calculates sum_{k=-rstep}^{rstep} in[i + k] and
+  /// sum_{k=-rstep}^{rstep} k in[i + k].
+  static void InitializeRegressionSums(const BuffersBase<float*>& in,
+                                       int rstep, int i, int windowSize,
+                                       float* sums, float* wsums) noexcept;
+
+  /// @brief Moves the sums calculated by InitializeRegressionSums() from
+  /// buffer i to buffer i + 1.
+  static void SlideRegressionSums(bool simd, const BuffersBase<float*>& in,
+                                  int rstep, int i, int windowSize,
+                                  float* sums, float* wsums) noexcept;
+
+  /// @brief Returns the aligned distance between the sums and the weighted
+  /// sums in the scratch buffer.
+  static size_t ScratchStride(size_t size) noexcept;
+
+  /// @brief Returns 2 sum_{k=1}^{rstep} k^2.
+  static float RegressionNorm(int rstep) noexcept;
+
+ private:
+  mutable ThreadWorkspace<FloatPtr> buffers_;
+  mutable LookaheadStream stream_;
+  size_t buffers_count_;
 };
 
 }  // namespace transforms
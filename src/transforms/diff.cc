@@ -37,7 +37,7 @@ namespace sound_feature_extraction {
 namespace transforms {
 
 Diff::Diff()
-    : rectify_(false), swt_(kNoSWT), swt_buffer_(nullptr, std::free) {
+    : rectify_(false), swt_(kNoSWT) {
 }
 
 ALWAYS_VALID_TP(Diff, rectify)
@@ -49,25 +49,27 @@ bool Diff::validate_swt(const int& value) noexcept {
 
 void Diff::Initialize() const {
   if (swt_ != kNoSWT) {
-    swt_buffer_ = std::uniquify(mallocf(input_format_->Size()),
-                                std::free);
+    size_t size = input_format_->Size();
+    swt_buffers_.Reset([size]() {
+      return std::uniquify(mallocf(size), std::free);
+    }, threads_number());
   }
 }
 
 void Diff::Do(const float* in, float* out) const noexcept {
   if (swt_ != kNoSWT) {
-    // swt_buffer_ is shared among all the threads; we just do not care
-    // because it is not really used.
+    // The buffer receives the unused half of the transform
+    auto swt_buffer = swt_buffers_.Get().get();
     stationary_wavelet_apply(WAVELET_TYPE_DAUBECHIES, 2, 1,
                              EXTENSION_TYPE_CONSTANT, in, input_format_->Size(),
-                             swt_ == 1? out : swt_buffer_.get(),
-                             swt_ == 1? swt_buffer_.get() : out);
+                             swt_ == 1? out : swt_buffer,
+                             swt_ == 1? swt_buffer : out);
     for (int i = 2; i <= swt_; i++) {
       stationary_wavelet_apply(
           WAVELET_TYPE_DAUBECHIES, 2, i, EXTENSION_TYPE_CONSTANT,
           out, input_format_->Size(),
-          i == swt_? out : swt_buffer_.get(),
-          i == swt_? swt_buffer_.get() : out);
+          i == swt_? out : swt_buffer,
+          i == swt_? swt_buffer : out);
     }
     if (rectify_) {
       Rectify(use_simd(), out, input_format_->Size(), out);
@@ -204,6 +206,10 @@ void Diff::Rectify(bool simd, const float* input, int length,
   }
 }
 
+void Diff::DoBuffer(const float* in, float* out) const noexcept {
+  Do(in, out);
+}
+
 RTP(Diff, rectify)
 RTP(Diff, swt)
 REGISTER_TRANSFORM(Diff);
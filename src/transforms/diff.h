@@ -31,13 +31,15 @@
 #ifndef SRC_TRANSFORMS_DIFF_H_
 #define SRC_TRANSFORMS_DIFF_H_
 
+#include "src/fusable.h"
 #include "src/transforms/common.h"
 #include <vector>
 
 namespace sound_feature_extraction {
 namespace transforms {
 
-class Diff : public OmpUniformFormatTransform<formats::ArrayFormatF> {
+class Diff : public OmpUniformFormatTransform<formats::ArrayFormatF>,
+             public Fusable {
  public:
   Diff();
 
@@ -51,6 +53,8 @@ class Diff : public OmpUniformFormatTransform<formats::ArrayFormatF> {
      "(db1) of the specified level. The level must be greater than "
      "or equal to 0. If set to zero, this parameter is ignored.")
 
+  virtual void DoBuffer(const float* in, float* out) const noexcept override;
+
  protected:
   virtual void Initialize() const override;
 
@@ -68,7 +72,7 @@ class Diff : public OmpUniformFormatTransform<formats::ArrayFormatF> {
   static constexpr int kNoSWT = 0;
 
  private:
-  mutable FloatPtr swt_buffer_;
+  mutable ThreadWorkspace<FloatPtr> swt_buffers_;
 };
 
 }  // namespace transforms
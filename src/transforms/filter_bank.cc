@@ -29,11 +29,12 @@
  */
 
 #include "src/transforms/filter_bank.h"
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 #include <simd/arithmetic-inl.h>
+#include <simd/instruction_set.h>
 #include "src/transforms/filter_base.h"
-#include "src/primitives/energy.h"
 #include "src/make_unique.h"
 
 namespace sound_feature_extraction {
@@ -55,12 +56,18 @@ ScaleType Parse(const std::string& value, identity<ScaleType>) {
 
 constexpr ScaleType FilterBank::kDefaultScale;
 constexpr float FilterBank::kMidiFreqs[];
+constexpr size_t FilterBank::kBlockBytes;
+constexpr size_t FilterBank::kMaxBlockFrames;
 
 FilterBank::FilterBank()
     : type_(kDefaultScale),
       number_(kDefaultNumber),
       frequency_min_(kDefaultMinFrequency),
-      frequency_max_(kDefaultMaxFrequency) {
+      frequency_max_(kDefaultMaxFrequency),
+      coefficients_(nullptr, std::free),
+      weights_(nullptr, std::free),
+      stride_(0),
+      block_frames_(1) {
 }
 
 ALWAYS_VALID_TP(FilterBank, type)
@@ -160,7 +167,7 @@ float FilterBank::ScaleToLinear(ScaleType type, float value) {
 }
 
 void FilterBank::CalcTriangularFilter(float center, float halfWidth,
-                                      Filter* out) const {
+                                      float* data, Filter* out) const {
   float left_freq = ScaleToLinear(type_, center - halfWidth);
   float center_freq = ScaleToLinear(type_, center);
   float right_freq = ScaleToLinear(type_, center + halfWidth);
@@ -211,37 +218,54 @@ void FilterBank::CalcTriangularFilter(float center, float halfWidth,
       // Right slope
       value += dist;
     }
-    out->data[i - left_index] = value;
+    data[i - left_index] = value;
   }
-  out->data[roundf(center_index) - left_index] = 1.f;
+  data[static_cast<int>(roundf(center_index)) - left_index] = 1.f;
 }
 
 void FilterBank::Initialize() const {
   filter_bank_.resize(number_);
-  int count = threads_number();
-  buffers_.resize(count);
-  for (int i = 0; i < count; i++) {
-    buffers_[i].data = std::uniquify(mallocf(input_format_->Size()),
-                                     std::free);
-  }
+  size_t size = input_format_->Size();
+  // Keep each squared frame in the buffer 32-byte aligned
+  stride_ = (size + 7) & ~static_cast<size_t>(7);
+  block_frames_ = std::max(static_cast<size_t>(1), std::min(
+      kMaxBlockFrames, kBlockBytes / (stride_ * sizeof(float))));
+  size_t buffer_size = stride_ * block_frames_;
+  buffers_.Reset([buffer_size]() {
+    return std::uniquify(mallocf(buffer_size), std::free);
+  }, threads_number());
 
   float scaleMin = LinearToScale(type_, frequency_min_);
   float scaleMax = LinearToScale(type_, frequency_max_);
   float dsc = (scaleMax - scaleMin) / (number_ + 1);
 
+  // The bands are not known beforehand, so calculate each filter into
+  // a full size scratch array and then pack the band
+  FloatPtr scratch(mallocf(size), std::free);
+  std::vector<float> packed;
+  std::vector<size_t> offsets(number_);
   for (int i = 0; i < number_; i++) {
-    filter_bank_[i].data = std::uniquify(mallocf(input_format_->Size()),
-                                         std::free);
-    CalcTriangularFilter(scaleMin + dsc * (i + 1), dsc, &filter_bank_[i]);
+    auto& filter = filter_bank_[i];
+    CalcTriangularFilter(scaleMin + dsc * (i + 1), dsc, scratch.get(),
+                         &filter);
+    offsets[i] = packed.size();
+    packed.insert(packed.end(), scratch.get(),
+                  scratch.get() + filter.end - filter.begin + 1);
   }
 
+  size_t total = std::max(packed.size(), static_cast<size_t>(1));
+  coefficients_ = FloatPtr(mallocf(total), std::free);
+  weights_ = FloatPtr(mallocf(total), std::free);
+  std::copy(packed.begin(), packed.end(), coefficients_.get());
   if (squared_) {
-    for (int i = 0; i < number_; i++) {
-      real_multiply_array(filter_bank_[i].data.get(),
-                          filter_bank_[i].data.get(),
-                          filter_bank_[i].end - filter_bank_[i].begin + 1,
-                          filter_bank_[i].data.get());
-    }
+    real_multiply_array(coefficients_.get(), coefficients_.get(),
+                        packed.size(), coefficients_.get());
+  }
+  real_multiply_array(coefficients_.get(), coefficients_.get(),
+                      packed.size(), weights_.get());
+  for (int i = 0; i < number_; i++) {
+    filter_bank_[i].data = coefficients_.get() + offsets[i];
+    filter_bank_[i].weights = weights_.get() + offsets[i];
   }
   if (debug_) {
     std::stringstream ss;
@@ -276,23 +300,91 @@ size_t FilterBank::OnInputFormatChanged(size_t buffersCount) {
   return buffersCount;
 }
 
+float FilterBank::Dot(bool simd, const float* a, const float* b,
+                       size_t length) noexcept {
+  int ilength = length;
+  float sum = 0.f;
+  if (simd) {
+#ifdef __AVX__
+    __m256 accum1 = _mm256_setzero_ps(), accum2 = _mm256_setzero_ps();
+    for (int j = 0; j < ilength - 15; j += 16) {
+      __m256 vec1 = _mm256_mul_ps(_mm256_loadu_ps(a + j),
+                                  _mm256_loadu_ps(b + j));
+      __m256 vec2 = _mm256_mul_ps(_mm256_loadu_ps(a + j + 8),
+                                  _mm256_loadu_ps(b + j + 8));
+      accum1 = _mm256_add_ps(accum1, vec1);
+      accum2 = _mm256_add_ps(accum2, vec2);
+    }
+    accum1 = _mm256_add_ps(accum1, accum2);
+    accum1 = _mm256_hadd_ps(accum1, accum1);
+    accum1 = _mm256_hadd_ps(accum1, accum1);
+    sum = _mm256_get_ps(accum1, 0) + _mm256_get_ps(accum1, 4);
+    for (int j = (ilength & ~0xF); j < ilength; j++) {
+      sum += a[j] * b[j];
+    }
+    return sum;
+  } else {
+#elif defined(__ARM_NEON__)
+    float32x4_t accum = vdupq_n_f32(0.f);
+    for (int j = 0; j < ilength - 3; j += 4) {
+      accum = vmlaq_f32(accum, vld1q_f32(a + j), vld1q_f32(b + j));
+    }
+    float32x2_t sums = vpadd_f32(vget_high_f32(accum), vget_low_f32(accum));
+    sum = vget_lane_f32(sums, 0) + vget_lane_f32(sums, 1);
+    for (int j = (ilength & ~0x3); j < ilength; j++) {
+      sum += a[j] * b[j];
+    }
+    return sum;
+  } else {
+#else
+  } {
+#endif
+    for (int j = 0; j < ilength; j++) {
+      sum += a[j] * b[j];
+    }
+    return sum;
+  }
+}
+
+void FilterBank::DoBlock(const float* const* in, float* const* out,
+                         size_t count, float* buffer) const noexcept {
+  assert(count <= block_frames_);
+  size_t size = input_format_->Size();
+  for (size_t f = 0; f < count; f++) {
+    real_multiply_array(in[f], in[f], size, buffer + f * stride_);
+  }
+  // Filter-major order: the row stays in L1 while the block is in L2
+  for (int i = 0; i < number_; i++) {
+    auto& filter = filter_bank_[i];
+    size_t length = filter.end - filter.begin + 1;
+    for (size_t f = 0; f < count; f++) {
+      out[f][i] = Dot(use_simd(), buffer + f * stride_ + filter.begin,
+                      filter.weights, length);
+    }
+  }
+}
+
 void FilterBank::Do(const float* in, float* out) const noexcept {
-  bool executed = false;
-  while (!executed) {
-    for (auto& buf : buffers_) {
-      if (buf.mutex.try_lock()) {
-        for (int i = 0; i < number_; i++) {
-          size_t length = filter_bank_[i].end - filter_bank_[i].begin + 1;
-          real_multiply_array(in + filter_bank_[i].begin,
-                              filter_bank_[i].data.get(),
-                              length, buf.data.get());
-          out[i] = calculate_energy(use_simd(), false, buf.data.get(), length);
-        }
-        buf.mutex.unlock();
-        executed = true;
-        break;
-      }
+  DoBlock(&in, &out, 1, buffers_.Get().get());
+}
+
+void FilterBank::Do(const BuffersBase<float*>& in,
+                    BuffersBase<float*>* out) const noexcept {
+  size_t count = in.Count();
+  size_t blocks = (count + block_frames_ - 1) / block_frames_;
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for num_threads(threads_number())
+#endif
+  for (size_t b = 0; b < blocks; b++) {
+    const float* block_in[kMaxBlockFrames];
+    float* block_out[kMaxBlockFrames];
+    size_t first = b * block_frames_;
+    size_t block_count = std::min(block_frames_, count - first);
+    for (size_t f = 0; f < block_count; f++) {
+      block_in[f] = in[first + f];
+      block_out[f] = (*out)[first + f];
     }
+    DoBlock(block_in, block_out, block_count, buffers_.Get().get());
   }
 }
 
@@ -116,12 +116,16 @@ class FilterBank : public OmpTransformBase<formats::ArrayFormatF,
   virtual void Initialize() const override;
 
  protected:
+  /// @brief A row of the compact filter bank matrix. Only the nonzero
+  /// band [begin, end] is stored.
   struct Filter {
-    Filter() : data(nullptr, std::free),
-               begin(0), end(0) {
+    Filter() : data(nullptr), weights(nullptr), begin(0), end(0) {
     }
 
-    FloatPtr data;
+    /// @brief The values of the filter, points to coefficients_.
+    const float* data;
+    /// @brief The squared values of the filter, points to weights_.
+    const float* weights;
     int begin;
     int end;
   };
@@ -131,6 +135,10 @@ class FilterBank : public OmpTransformBase<formats::ArrayFormatF,
   static constexpr float kDefaultMinFrequency = 130;
   static constexpr float kDefaultMaxFrequency = 6854;
   static constexpr bool kDefaultSquared = false;
+  /// @brief The approximate size of the squared spectra which are processed
+  /// together, so that each filter row is reused while it is hot.
+  static constexpr size_t kBlockBytes = 128 * 1024;
+  static constexpr size_t kMaxBlockFrames = 64;
   static constexpr float kMidiFreqs[] {
     8.1757989156, 8.6619572180, 9.1770239974, 9.722718241, 10.3008611535,
     10.9133822323, 11.5623257097, 12.2498573744, 12.9782717994, 13.7500000000,
@@ -142,6 +150,13 @@ class FilterBank : public OmpTransformBase<formats::ArrayFormatF,
   virtual void Do(const float* in,
                   float* out) const noexcept override;
 
+  virtual void Do(const BuffersBase<float*>& in,
+                  BuffersBase<float*>* out) const noexcept override;
+
+  /// @brief Calculates the dot product of two arbitrarily aligned arrays.
+  static float Dot(bool simd, const float* a, const float* b,
+                   size_t length) noexcept;
+
   static float LinearToScale(ScaleType type, float freq);
   static float ScaleToLinear(ScaleType type, float value);
 
@@ -154,10 +169,28 @@ class FilterBank : public OmpTransformBase<formats::ArrayFormatF,
   /// @param halfWidth The half width of the base of the triangle,
   /// in psychoacoustic scale units.
   /// @param out The resulting filter.
-  void CalcTriangularFilter(float center, float halfWidth, Filter* out) const;
+  /// @param data Where to write the values of the filter.
+  void CalcTriangularFilter(float center, float halfWidth, float* data,
+                            Filter* out) const;
+  /// @brief Multiplies the squared frames by the squared filter bank.
+  /// @param in The frames to process.
+  /// @param out The resulting scales of the frames.
+  /// @param count The number of frames, not greater than block_frames_.
+  /// @param buffer The scratch space for the squared frames.
+  void DoBlock(const float* const* in, float* const* out, size_t count,
+               float* buffer) const noexcept;
 
   mutable std::vector<Filter> filter_bank_;
-  mutable std::vector<ThreadSafeFloatPtr> buffers_;
+  /// @brief The filter values, stored contiguously row by row.
+  mutable FloatPtr coefficients_;
+  /// @brief The squared coefficients_, so that the energy of the filtered
+  /// spectrum is the dot product of the squared spectrum and a row.
+  mutable FloatPtr weights_;
+  /// @brief The aligned distance between the squared frames in the buffer.
+  mutable size_t stride_;
+  /// @brief The number of frames in a cache block.
+  mutable size_t block_frames_;
+  mutable ThreadWorkspace<FloatPtr> buffers_;
 };
 
 }  // namespace transforms
@@ -31,11 +31,9 @@
 #ifndef SRC_TRANSFORMS_FILTER_BASE_H_
 #define SRC_TRANSFORMS_FILTER_BASE_H_
 
-#include <cassert>
-#include <vector>
-#include <mutex>
 #include "src/formats/array_format.h"
 #include "src/omp_transform_base.h"
+#include "src/thread_workspace.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
@@ -45,7 +43,7 @@ class FilterBase : public OmpUniformFormatTransform<formats::ArrayFormatF> {
  public:
   FilterBase() noexcept
       : length_(kDefaultFilterLength),
-        max_executors_(threads_number()) {
+        shared_executor_(false) {
   }
 
   TRANSFORM_PARAMETERS_SUPPORT(FilterBase)
@@ -53,34 +51,27 @@ class FilterBase : public OmpUniformFormatTransform<formats::ArrayFormatF> {
   TP(length, int, kDefaultFilterLength, "Filter size in samples (order).")
 
   virtual void Initialize() const override {
-    executors_.resize(max_executors_);
-    for (int i = 0; i < max_executors_; i++) {
-      executors_[i].executor = CreateExecutor();
-      executors_[i].mutex = std::make_shared<std::mutex>();
-    }
+    ResetExecutors();
   }
 
   virtual void Do(const float* in, float* out) const noexcept override final {
-    bool executed = false;
-    while (!executed) {
-      for (auto& sse : executors_) {
-        if (sse.mutex->try_lock()) {
-          Execute(sse.executor, in, out);
-          sse.mutex->unlock();
-          executed = true;
-          break;
-        }
-      }
+    if (shared_executor_) {
+      Execute(executor_, in, out);
+    } else {
+      Execute(executors_.Get(), in, out);
     }
   }
 
-  int max_executors() const {
-    return max_executors_;
+  /// @brief Indicates whether all the calls to Do() use the same executor,
+  /// so that its state is carried between them. Otherwise, each thread
+  /// uses its own executor. The caller must not execute the shared
+  /// executor simultaneously.
+  bool shared_executor() const noexcept {
+    return shared_executor_;
   }
 
-  void set_max_executors(int value) {
-    assert(value > 0);
-    max_executors_ = value;
+  void set_shared_executor(bool value) noexcept {
+    shared_executor_ = value;
   }
 
   static bool ValidateFrequency(const int& value) noexcept {
@@ -98,14 +89,22 @@ class FilterBase : public OmpUniformFormatTransform<formats::ArrayFormatF> {
   virtual void Execute(const std::shared_ptr<E>& exec, const float* in,
                        float* out) const = 0;
 
- private:
-  struct ThreadSafeExecutor {
-    std::shared_ptr<E> executor;
-    std::shared_ptr<std::mutex> mutex;
-  };
+  /// @brief Creates all the executors anew, discarding their state.
+  void ResetExecutors() const {
+    if (shared_executor_) {
+      executor_ = CreateExecutor();
+      executors_.Clear();
+    } else {
+      executor_.reset();
+      executors_.Reset([this]() { return CreateExecutor(); },
+                       threads_number());
+    }
+  }
 
-  mutable std::vector<ThreadSafeExecutor> executors_;
-  int max_executors_;
+ private:
+  mutable std::shared_ptr<E> executor_;
+  mutable ThreadWorkspace<std::shared_ptr<E>> executors_;
+  bool shared_executor_;
 };
 
 template <class E>
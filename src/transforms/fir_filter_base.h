@@ -31,6 +31,7 @@
 #ifndef SRC_TRANSFORMS_FIR_FILTER_BASE_H_
 #define SRC_TRANSFORMS_FIR_FILTER_BASE_H_
 
+#include <vector>
 #include "src/transforms/filter_base.h"
 
 struct ConvolutionHandle;
@@ -66,7 +66,8 @@ FrequencyBands::FrequencyBands()
     : number_(kDefaultBandsNumber),
       bands_(),
       filter_(kDefaultFilterType),
-      lengths_() {
+      lengths_(),
+      stateful_(kDefaultStateful) {
 }
 
 bool FrequencyBands::validate_number(const int& value) noexcept {
@@ -100,6 +101,7 @@ bool FrequencyBands::validate_bands(const std::string& value) noexcept {
   return true;
 }
 ALWAYS_VALID_TP(FrequencyBands, filter)
+ALWAYS_VALID_TP(FrequencyBands, stateful)
 
 bool FrequencyBands::validate_lengths(const FilterOrders& value) noexcept {
   for (int len : value) {
@@ -172,6 +174,7 @@ void FrequencyBands::Initialize() const {
 void FrequencyBands::SetupFilter(size_t index, int frequency,
                                  IIRFilterBase* filter) const {
   filter->set_type(filter_);
+  filter->set_stateful(stateful_);
   auto ratio = frequency / input_format_->SamplingRate() * 2;
   if (lengths_.size() > index) {
     filter->set_length(lengths_[index]);
@@ -186,6 +189,17 @@ void FrequencyBands::SetupFilter(size_t index, int frequency,
 
 void FrequencyBands::Do(const BuffersBase<float*>& in,
                         BuffersBase<float*>* out) const noexcept {
+  if (stateful_) {
+    // The bands are independent, while the windows of each band must be
+    // filtered in order
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for num_threads(threads_number())
+#endif
+    for (size_t i = 0; i < filters_.size(); i++) {
+      filters_[i]->DoContinuous(in, i, filters_.size(), out);
+    }
+    return;
+  }
 #ifdef HAVE_OPENMP
   #pragma omp parallel for num_threads(threads_number())
 #endif
@@ -198,6 +212,7 @@ RTP(FrequencyBands, number)
 RTP(FrequencyBands, bands)
 RTP(FrequencyBands, filter)
 RTP(FrequencyBands, lengths)
+RTP(FrequencyBands, stateful)
 REGISTER_TRANSFORM(FrequencyBands);
 
 }  // namespace transforms
@@ -81,6 +81,9 @@ class FrequencyBands
   TP(filter, IIRFilterType, kDefaultFilterType, "IIR filter type to apply.")
   TP(lengths, FilterOrders, FilterOrders(),
      "IIR filter orders. \"auto\" for automatic selection.")
+  TP(stateful, bool, kDefaultStateful,
+     "Treat the sequential windows of each band as the consecutive pieces "
+     "of the same signal, carrying the filter state between them.")
 
   virtual bool BufferInvariant() const noexcept override final {
     return false;
@@ -92,6 +95,7 @@ class FrequencyBands
   static constexpr IIRFilterType kDefaultFilterType =
       IIRFilterType::kChebyshevII;
   static constexpr int kDefaultBandsNumber = Fork::kDefaultFactor;
+  static constexpr bool kDefaultStateful = false;
 
   virtual void Do(const BuffersBase<float*>& in,
                   BuffersBase<float*>* out) const noexcept override;
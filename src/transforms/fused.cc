@@ -0,0 +1,163 @@
+/*! @file fused.cc
+ *  @brief Executes a chain of fusable transforms buffer by buffer.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/transforms/fused.h"
+#include <cassert>
+#include <algorithm>
+#include <simd/memory.h>
+#include "src/make_unique.h"
+#include "src/transforms/common.h"
+
+namespace sound_feature_extraction {
+namespace transforms {
+
+constexpr const char* Fused::kSeparator;
+
+Fused::Fused(const std::vector<std::shared_ptr<Transform>>& transforms)
+    : transforms_(transforms),
+      threads_number_(get_omp_transforms_max_threads_num()) {
+  assert(!transforms.empty());
+  for (auto& t : transforms_) {
+    auto fusable = dynamic_cast<const Fusable*>(t.get());
+    assert(fusable != nullptr);
+    fusables_.push_back(fusable);
+    if (!name_.empty()) {
+      name_ += kSeparator;
+    }
+    name_ += t->Name();
+    // Respect the most restrictive threads number of the chain
+    auto omp = dynamic_cast<const OmpAwareTransform<
+        formats::ArrayFormatF, formats::ArrayFormatF>*>(t.get());
+    if (omp != nullptr) {
+      threads_number_ = std::min(threads_number_, omp->threads_number());
+    }
+  }
+}
+
+const std::string& Fused::Name() const noexcept {
+  return name_;
+}
+
+const std::string& Fused::Description() const noexcept {
+  static const std::string desc("Executes the chain of transforms on each "
+                                "buffer in turn.");
+  return desc;
+}
+
+bool Fused::BufferInvariant() const noexcept {
+  for (auto& t : transforms_) {
+    if (!t->BufferInvariant()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const std::shared_ptr<BufferFormat> Fused::InputFormat() const noexcept {
+  return transforms_.front()->InputFormat();
+}
+
+size_t Fused::SetInputFormat(const std::shared_ptr<BufferFormat>& format,
+                             size_t buffersCount) {
+  auto current = format;
+  for (auto& t : transforms_) {
+    buffersCount = t->SetInputFormat(current, buffersCount);
+    current = t->OutputFormat();
+  }
+  return buffersCount;
+}
+
+const std::shared_ptr<BufferFormat> Fused::OutputFormat() const noexcept {
+  return transforms_.back()->OutputFormat();
+}
+
+size_t Fused::ScratchOffset() const noexcept {
+  size_t size = 0;
+  for (size_t i = 0; i < transforms_.size() - 1; i++) {
+    size = std::max(size, transforms_[i]->OutputFormat()->SizeInBytes());
+  }
+  return size / sizeof(float);
+}
+
+void Fused::Initialize() const {
+  if (transforms_.size() < 2) {
+    return;
+  }
+  // The intermediate results ping-pong between two halves
+  size_t size = ScratchOffset() * 2;
+  scratches_.Reset([size]() {
+    return std::uniquify(mallocf(size), std::free);
+  }, threads_number_);
+}
+
+void Fused::Do(const Buffers& in, Buffers* out) const noexcept {
+  assert(in.Count() == out->Count());
+  size_t offset = ScratchOffset();
+  int last = fusables_.size() - 1;
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for num_threads(threads_number_)
+#endif
+  for (size_t i = 0; i < in.Count(); i++) {
+    float* scratch = last > 0? scratches_.Get().get() : nullptr;
+    auto input = reinterpret_cast<const float*>(in[i]);
+    for (int j = 0; j < last; j++) {
+      float* output = scratch + (j % 2) * offset;
+      fusables_[j]->DoBuffer(input, output);
+      input = output;
+    }
+    fusables_[last]->DoBuffer(input, reinterpret_cast<float*>((*out)[i]));
+  }
+}
+
+std::shared_ptr<Buffers> Fused::CreateOutputBuffers(
+    size_t count, void* reusedMemory) const noexcept {
+  return transforms_.back()->CreateOutputBuffers(count, reusedMemory);
+}
+
+const SupportedParametersMap& Fused::SupportedParameters() const noexcept {
+  static const SupportedParametersMap sp;
+  return sp;
+}
+
+const ParametersMap& Fused::GetParameters() const noexcept {
+  static const ParametersMap p;
+  return p;
+}
+
+void Fused::SetParameters(const ParametersMap&) {
+}
+
+const std::vector<std::shared_ptr<Transform>>& Fused::transforms()
+    const noexcept {
+  return transforms_;
+}
+
+}  // namespace transforms
+}  // namespace sound_feature_extraction
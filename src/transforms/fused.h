@@ -0,0 +1,100 @@
+/*! @file fused.h
+ *  @brief Executes a chain of fusable transforms buffer by buffer.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#ifndef SRC_TRANSFORMS_FUSED_H_
+#define SRC_TRANSFORMS_FUSED_H_
+
+#include <vector>
+#include "src/floatptr.h"
+#include "src/fusable.h"
+#include "src/thread_workspace.h"
+#include "src/transform.h"
+
+namespace sound_feature_extraction {
+namespace transforms {
+
+/// @brief Runs the chain of Fusable transforms on each buffer in turn.
+/// The intermediate results live in the small per-thread scratch buffers
+/// which stay in the CPU cache, instead of the full intermediate buffers
+/// in the arena. It is created by TransformTree and is not registered.
+class Fused : public Transform {
+ public:
+  /// @param transforms The initialized transforms to execute in the order
+  /// of the chain. Each of them must be Fusable.
+  explicit Fused(const std::vector<std::shared_ptr<Transform>>& transforms);
+
+  virtual const std::string& Name() const noexcept override;
+
+  virtual const std::string& Description() const noexcept override;
+
+  virtual bool BufferInvariant() const noexcept override;
+
+  virtual const std::shared_ptr<BufferFormat> InputFormat()
+      const noexcept override;
+
+  virtual size_t SetInputFormat(const std::shared_ptr<BufferFormat>& format,
+                                size_t buffersCount) override;
+
+  virtual const std::shared_ptr<BufferFormat> OutputFormat()
+      const noexcept override;
+
+  virtual void Initialize() const override;
+
+  virtual void Do(const Buffers& in, Buffers* out) const noexcept override;
+
+  virtual std::shared_ptr<Buffers> CreateOutputBuffers(
+      size_t count, void* reusedMemory = nullptr) const noexcept override;
+
+  virtual const SupportedParametersMap&
+      SupportedParameters() const noexcept override;
+
+  virtual const ParametersMap& GetParameters() const noexcept override;
+
+  virtual void SetParameters(const ParametersMap& params) override;
+
+  /// @brief The fused transforms in the order of execution.
+  const std::vector<std::shared_ptr<Transform>>& transforms() const noexcept;
+
+  static constexpr const char* kSeparator = " + ";
+
+ private:
+  /// @brief The offset of the second scratch buffer, in floats.
+  size_t ScratchOffset() const noexcept;
+
+  std::vector<std::shared_ptr<Transform>> transforms_;
+  std::vector<const Fusable*> fusables_;
+  std::string name_;
+  int threads_number_;
+  mutable ThreadWorkspace<FloatPtr> scratches_;
+};
+
+}  // namespace transforms
+}  // namespace sound_feature_extraction
+#endif  // SRC_TRANSFORMS_FUSED_H_
@@ -36,6 +36,11 @@ namespace transforms {
 RTP(IIRFilterBase, type)
 RTP(IIRFilterBase, ripple)
 RTP(IIRFilterBase, rolloff)
+RTP(IIRFilterBase, stateful)
+
+namespace {
+thread_local bool continues_signal = false;
+}
 
 IIRFilterType Parse(const std::string& value, identity<IIRFilterType>) {
   static const std::unordered_map<std::string, IIRFilterType> map {
@@ -58,7 +63,8 @@ constexpr IIRFilterType IIRFilterBase::kDefaultIIRFilterType;
 IIRFilterBase::IIRFilterBase() noexcept
     : type_(kDefaultIIRFilterType),
       ripple_(kDefaultIIRFilterRipple),
-      rolloff_(kDefaultIIRFilterRolloff) {
+      rolloff_(kDefaultIIRFilterRolloff),
+      stateful_(kDefaultStateful) {
 }
 ALWAYS_VALID_TP(IIRFilterBase, type)
 
@@ -67,6 +73,47 @@ bool IIRFilterBase::validate_ripple(const float& value) noexcept {
 }
 
 ALWAYS_VALID_TP(IIRFilterBase, rolloff)
+ALWAYS_VALID_TP(IIRFilterBase, stateful)
+
+void IIRFilterBase::set_streaming(bool value) {
+  StreamingAware::set_streaming(value);
+  // The state of the stream must be kept by a single executor which
+  // processes the buffers in order
+  set_shared_executor(value);
+  if (value) {
+    set_threads_number(1);
+  }
+}
+
+void IIRFilterBase::ResetStream() const {
+  ResetExecutors();
+}
+
+void IIRFilterBase::Do(const BuffersBase<float*>& in,
+                       BuffersBase<float*>* out) const noexcept {
+  if (stateful_ && !streaming()) {
+    DoContinuous(in, 0, 1, out);
+  } else {
+    // The streaming filters execute the buffers in order with a single
+    // thread and never reset the shared executor
+    OmpTransformBase<formats::ArrayFormatF, formats::ArrayFormatF>::Do(
+        in, out);
+  }
+}
+
+void IIRFilterBase::DoContinuous(const BuffersBase<float*>& in, size_t first,
+                                 size_t step, BuffersBase<float*>* out)
+    const noexcept {
+  for (size_t i = first; i < in.Count(); i += step) {
+    continues_signal = i != first;
+    Do(in[i], (*out)[i]);
+  }
+  continues_signal = false;
+}
+
+bool IIRFilterBase::ContinuesSignal() noexcept {
+  return continues_signal;
+}
 
 }  // namespace formats
 }  // namespace sound_feature_extraction
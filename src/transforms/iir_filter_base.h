@@ -38,6 +38,7 @@
 #pragma GCC diagnostic ignored "-Wsequence-point"
 #include <DspFilters/Dsp.h>
 #pragma GCC diagnostic pop
+#include "src/streaming_aware.h"
 #include "src/transforms/filter_base.h"
 
 namespace sound_feature_extraction {
@@ -100,7 +101,12 @@ namespace transforms {
 
 typedef Dsp::Cascade IIRFilter;
 
-class IIRFilterBase : public FilterBase<IIRFilter> {
+/// @brief The base class of all IIR filters.
+/// @details In the streaming mode, the filter state is carried between
+/// the sequential pieces of the signal instead of being reset. In the stateful
+/// mode, the buffers passed to Do() are treated as the consecutive pieces of
+/// the same signal, so the state is carried between them as well.
+class IIRFilterBase : public FilterBase<IIRFilter>, public StreamingAware {
  public:
   IIRFilterBase() noexcept;
 
@@ -112,14 +118,36 @@ class IIRFilterBase : public FilterBase<IIRFilter> {
      "Ripple level in dB (used by a subset of filter types).")
   TP(rolloff, float, kDefaultIIRFilterRolloff,
      "Rolloff level in dB (used by a subset of filter types).")
+  TP(stateful, bool, kDefaultStateful,
+     "Carry the filter state between the consecutive buffers instead of "
+     "filtering each buffer independently.")
+
+  using FilterBase<IIRFilter>::Do;
+
+  virtual bool BufferInvariant() const noexcept override {
+    return !stateful_;
+  }
+
+  virtual void set_streaming(bool value) override;
+  virtual void ResetStream() const override;
+
+  /// @brief Filters in[first], in[first + step], in[first + 2 * step], ...
+  /// as the consecutive pieces of the same signal in the calling thread.
+  void DoContinuous(const BuffersBase<float*>& in, size_t first, size_t step,
+                    BuffersBase<float*>* out) const noexcept;
 
  protected:
+  virtual void Do(const BuffersBase<float*>& in,
+                  BuffersBase<float*>* out) const noexcept override;
+
   template <class F>
   void Execute(const std::shared_ptr<F>& exec, const float* in,
                float* out) const {
     memcpy(out, in, input_format_->UnalignedSizeInBytes());
     auto ptr = std::const_pointer_cast<F>(exec);
-    ptr->reset();
+    if (!streaming() && !ContinuesSignal()) {
+      ptr->reset();
+    }
     ptr->process(input_format_->Size(), &out);
   }
 
@@ -127,6 +155,12 @@ class IIRFilterBase : public FilterBase<IIRFilter> {
       IIRFilterType::kChebyshevII;
   static constexpr float kDefaultIIRFilterRipple = 1;
   static constexpr float kDefaultIIRFilterRolloff = 0;
+  static constexpr bool kDefaultStateful = false;
+
+ private:
+  /// @brief Indicates whether the calling thread is inside DoContinuous()
+  /// and has already filtered the previous piece of the signal.
+  static bool ContinuesSignal() noexcept;
 };
 
 }  // namespace transforms
@@ -118,6 +118,10 @@ void LogRaw::Do(const float* in, float* out) const noexcept {
   Do(use_simd(), in, this->input_format_->Size(), out);
 }
 
+void LogRaw::DoBuffer(const float* in, float* out) const noexcept {
+  Do(in, out);
+}
+
 void LogRawInverse::Do(const float* in UNUSED, float* out UNUSED)
     const noexcept {
   assert("Not implemented yet");
@@ -32,6 +32,7 @@
 #define SRC_TRANSFORMS_LOG_H_
 
 #include "src/formats/single_format.h"
+#include "src/fusable.h"
 #include "src/transforms/common.h"
 
 namespace sound_feature_extraction {
@@ -125,7 +126,10 @@ RTP(LogBase<F>, add1)
 template <class F>
 RTP(LogBase<F>, scale)
 
-class LogRaw : public LogBase<formats::ArrayFormatF> {
+class LogRaw : public LogBase<formats::ArrayFormatF>, public Fusable {
+ public:
+  virtual void DoBuffer(const float* in, float* out) const noexcept override;
+
  protected:
   virtual void Do(const float* in, float* out) const noexcept override;
 
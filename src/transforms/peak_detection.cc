@@ -71,8 +71,7 @@ PeakDetection::PeakDetection()
       max_pos_(kDefaultMaxPos),
       swt_type_(kDefaultSWTType),
       swt_order_(kDefaultWaveletOrder),
-      swt_level_(kDefaultSWTLevel),
-      swt_details_buffer_(nullptr, std::free) {
+      swt_level_(kDefaultSWTLevel) {
 }
 ALWAYS_VALID_TP(PeakDetection, sort)
 
@@ -100,14 +99,10 @@ size_t PeakDetection::OnInputFormatChanged(size_t buffersCount) {
 
 void PeakDetection::Initialize() const {
   if (swt_level_ != 0) {
-    swt_details_buffer_ = std::uniquify(mallocf(input_format_->Size()),
-                                        std::free);
-    int count = threads_number();
-    swt_buffers_.resize(count);
-    for (int i = 0; i < count; i++) {
-      swt_buffers_[i].data = std::uniquify(mallocf(input_format_->Size()),
-                                           std::free);
-    }
+    size_t size = DetailsOffset();
+    swt_buffers_.Reset([size]() {
+      return std::uniquify(mallocf(size * 2), std::free);
+    }, threads_number());
   }
 }
 
@@ -116,31 +111,18 @@ void PeakDetection::Do(const float* in,
   ExtremumPoint* results;
   size_t count;
   if (swt_level_ > 0) {
-    bool executed = false;
-    while (!executed) {
-      for (auto& buf : swt_buffers_) {
-        if (buf.mutex.try_lock()) {
-          // swt_details_buffer_ is shared among all the threads; we just
-          // do not care because it is not really used.
-          stationary_wavelet_apply(swt_type_, swt_order_, 1,
-                                   EXTENSION_TYPE_CONSTANT, in,
-                                   input_format_->Size(),
-                                   swt_details_buffer_.get(),
-                                   buf.data.get());
-          for (int i = 2; i <= swt_level_; i++) {
-            stationary_wavelet_apply(
-                swt_type_, swt_order_, i, EXTENSION_TYPE_CONSTANT,
-                buf.data.get(), input_format_->Size(),
-                swt_details_buffer_.get(), buf.data.get());
-          }
-          detect_peaks(use_simd(), buf.data.get(), input_format_->Size(), type_,
-                       &results, &count);
-          buf.mutex.unlock();
-          executed = true;
-          break;
-        }
-      }
+    size_t size = input_format_->Size();
+    auto buffer = swt_buffers_.Get().get();
+    auto details = buffer + DetailsOffset();
+    stationary_wavelet_apply(swt_type_, swt_order_, 1,
+                             EXTENSION_TYPE_CONSTANT, in, size,
+                             details, buffer);
+    for (int i = 2; i <= swt_level_; i++) {
+      stationary_wavelet_apply(
+          swt_type_, swt_order_, i, EXTENSION_TYPE_CONSTANT,
+          buffer, size, details, buffer);
     }
+    detect_peaks(use_simd(), buffer, size, type_, &results, &count);
   } else {
     detect_peaks(use_simd(), in, input_format_->Size(), type_, &results,
                  &count);
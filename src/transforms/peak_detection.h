@@ -31,7 +31,6 @@
 #ifndef SRC_TRANSFORMS_PEAK_DETECTION_H_
 #define SRC_TRANSFORMS_PEAK_DETECTION_H_
 
-#include <mutex>
 #include <vector>
 #include <simd/detect_peaks.h>
 #include <simd/wavelet_types.h>
@@ -112,8 +111,13 @@ class PeakDetection : public OmpTransformBase<
   static constexpr int kDefaultSWTLevel = 0;
 
  private:
-  mutable FloatPtr swt_details_buffer_;
-  mutable std::vector<ThreadSafeFloatPtr> swt_buffers_;
+  /// @brief Returns the aligned offset of the SWT details in swt_buffers_.
+  size_t DetailsOffset() const noexcept {
+    return (input_format_->Size() + 15) & ~static_cast<size_t>(15);
+  }
+
+  /// @brief The smoothed signal followed by the details of SWT.
+  mutable ThreadWorkspace<FloatPtr> swt_buffers_;
 };
 
 }  // namespace transforms
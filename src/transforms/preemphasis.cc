@@ -35,17 +35,31 @@ namespace sound_feature_extraction {
 namespace transforms {
 
 Preemphasis::Preemphasis()
-    : value_(kDefaultValue) {
+    : value_(kDefaultValue),
+      stream_last_(0),
+      stream_continued_(false) {
 }
 
 bool Preemphasis::validate_value(const float& value) noexcept {
   return value > 0 && value <= 1;
 }
 
+void Preemphasis::ResetStream() const {
+  stream_continued_ = false;
+}
+
 void Preemphasis::Do(const float* in,
                      float* out) const noexcept {
-
+  float first = in[0];
+  float last = in[input_format_->Size() - 1];
   Do(use_simd(), in, input_format_->Size(), value_, out);
+  if (streaming()) {
+    if (stream_continued_) {
+      out[0] = first - value_ * stream_last_;
+    }
+    stream_last_ = last;
+    stream_continued_ = true;
+  }
 }
 
 void Preemphasis::Do(bool simd, const float* input, size_t length,
@@ -90,6 +104,10 @@ void Preemphasis::Do(bool simd, const float* input, size_t length,
   }
 }
 
+void Preemphasis::DoBuffer(const float* in, float* out) const noexcept {
+  Do(in, out);
+}
+
 RTP(Preemphasis, value)
 REGISTER_TRANSFORM(Preemphasis);
 
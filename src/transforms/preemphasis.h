@@ -31,12 +31,16 @@
 #ifndef SRC_TRANSFORMS_PREEMPHASIS_H_
 #define SRC_TRANSFORMS_PREEMPHASIS_H_
 
+#include "src/fusable.h"
+#include "src/streaming_aware.h"
 #include "src/transforms/common.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
 
-class Preemphasis : public OmpUniformFormatTransform<formats::ArrayFormatF> {
+class Preemphasis : public OmpUniformFormatTransform<formats::ArrayFormatF>,
+                    public StreamingAware,
+                    public Fusable {
  public:
   Preemphasis();
 
@@ -48,6 +52,10 @@ class Preemphasis : public OmpUniformFormatTransform<formats::ArrayFormatF> {
      "The filter coefficient from range (0..1]. "
      "The higher, the more emphasis occurs.")
 
+  virtual void ResetStream() const override;
+
+  virtual void DoBuffer(const float* in, float* out) const noexcept override;
+
  protected:
   static constexpr float kDefaultValue = 0.9f;
 
@@ -55,6 +63,11 @@ class Preemphasis : public OmpUniformFormatTransform<formats::ArrayFormatF> {
 
   static void Do(bool simd, const float* input, size_t length,
                  float k, float* output) noexcept;
+
+ private:
+  /// @brief The last sample of the previous piece in the streaming mode.
+  mutable float stream_last_;
+  mutable bool stream_continued_;
 };
 
 }  // namespace transforms
@@ -29,8 +29,6 @@
  */
 
 #include "src/transforms/rdft.h"
-#include <vector>
-#include <fftf/api.h>
 #include <simd/arithmetic-inl.h>
 
 namespace sound_feature_extraction {
@@ -46,56 +44,35 @@ size_t RDFTInverse::OnFormatChanged(size_t buffersCount) {
   return buffersCount;
 }
 
+const FFTFInstance* RDFT::Plan(const Buffers& in, Buffers* out) const {
+  return plan_cache()->Get(FFTF_TYPE_REAL, FFTF_DIRECTION_FORWARD,
+                           input_format_->Size(), in, out);
+}
+
+const FFTFInstance* RDFTInverse::Plan(const Buffers& in, Buffers* out) const {
+  return plan_cache()->Get(FFTF_TYPE_REAL, FFTF_DIRECTION_BACKWARD,
+                           output_format_->Size(), in, out);
+}
+
+void RDFT::PreparePlans(const Buffers& in, Buffers* out) const {
+  Plan(in, out);
+}
+
+void RDFTInverse::PreparePlans(const Buffers& in, Buffers* out) const {
+  Plan(in, out);
+}
+
 void RDFT::Do(const BuffersBase<float*>& in,
               BuffersBase<float*>* out) const noexcept {
-  int length = input_format_->Size();
-  std::vector<const float*> inputs(in.Count());
-  std::vector<float*> outputs(in.Count());
-  for (size_t i = 0; i < in.Count(); i++) {
-    inputs[i] = in[i];
-    outputs[i] = (*out)[i];
-  }
-  fftf_set_backend(FFTF_BACKEND_NONE);
-  fftf_ensure_is_supported(FFTF_TYPE_REAL, input_format_->Size());
-  auto fft_plan = std::unique_ptr<FFTFInstance, void (*)(FFTFInstance *)>(
-      fftf_init_batch(
-          FFTF_TYPE_REAL,
-          FFTF_DIRECTION_FORWARD,
-          FFTF_DIMENSION_1D,
-          &length,
-          FFTF_NO_OPTIONS,
-          in.Count(),
-          &inputs[0], &outputs[0]),
-      fftf_destroy);
-
-  fftf_calc(fft_plan.get());
+  fftf_calc(Plan(in, out));
 }
 
 void RDFTInverse::Do(const BuffersBase<float*>& in,
                      BuffersBase<float*>* out) const noexcept {
   int length = output_format_->Size();
-  std::vector<const float*> inputs(in.Count());
-  std::vector<float*> outputs(in.Count());
-  for (size_t i = 0; i < in.Count(); i++) {
-    inputs[i] = in[i];
-    outputs[i] = (*out)[i];
-  }
-  fftf_set_backend(FFTF_BACKEND_NONE);
-  fftf_ensure_is_supported(FFTF_TYPE_REAL, output_format_->Size());
-  auto fft_plan = std::unique_ptr<FFTFInstance, void (*)(FFTFInstance *)>(
-      fftf_init_batch(
-          FFTF_TYPE_REAL,
-          FFTF_DIRECTION_BACKWARD,
-          FFTF_DIMENSION_1D,
-          &length,
-          FFTF_NO_OPTIONS,
-          in.Count(),
-          &inputs[0], &outputs[0]),
-      fftf_destroy);
-
-  fftf_calc(fft_plan.get());
+  fftf_calc(Plan(in, out));
   for (size_t i = 0; i < in.Count(); i++) {
-    real_multiply_scalar(outputs[i], length, 1.0f / length, outputs[i]);
+    real_multiply_scalar((*out)[i], length, 1.0f / length, (*out)[i]);
   }
 }
 
@@ -32,12 +32,14 @@
 #define SRC_TRANSFORMS_RDFT_H_
 
 #include "src/formats/array_format.h"
+#include "src/fftf_plan_cache.h"
 #include "src/transform_base.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
 
-class RDFT : public UniformFormatTransform<formats::ArrayFormatF> {
+class RDFT : public UniformFormatTransform<formats::ArrayFormatF>,
+             public FFTFPlanCacheAware {
  public:
   TRANSFORM_INTRO("RDFT", "Performs Discrete Fourier Transform "
                           "on the input signal (using real FFT).",
@@ -47,25 +49,38 @@ class RDFT : public UniformFormatTransform<formats::ArrayFormatF> {
     return true;
   }
 
+  virtual void PreparePlans(const Buffers& in,
+                            Buffers* out) const override;
+
  protected:
   virtual size_t OnFormatChanged(size_t buffersCount) override;
 
   virtual void Do(const BuffersBase<float*>& in,
                   BuffersBase<float*>* out) const noexcept override;
+
+ private:
+  const FFTFInstance* Plan(const Buffers& in, Buffers* out) const;
 };
 
 class RDFTInverse
-    : public InverseUniformFormatTransform<RDFT> {
+    : public InverseUniformFormatTransform<RDFT>,
+      public FFTFPlanCacheAware {
  public:
   virtual bool BufferInvariant() const noexcept override final {
     return true;
   }
 
+  virtual void PreparePlans(const Buffers& in,
+                            Buffers* out) const override;
+
  protected:
   virtual size_t OnFormatChanged(size_t buffersCount) override;
 
   virtual void Do(const BuffersBase<float*>& in,
                   BuffersBase<float*>* out) const noexcept override;
+
+ private:
+  const FFTFInstance* Plan(const Buffers& in, Buffers* out) const;
 };
 
 }  // namespace transforms
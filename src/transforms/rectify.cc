@@ -79,6 +79,10 @@ void Rectify::Do(bool simd, const float* input, int length,
   }
 }
 
+void Rectify::DoBuffer(const float* in, float* out) const noexcept {
+  Do(in, out);
+}
+
 REGISTER_TRANSFORM(Rectify);
 
 }  // namespace transforms
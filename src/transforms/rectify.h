@@ -31,17 +31,21 @@
 #ifndef SRC_TRANSFORMS_RECTIFY_H_
 #define SRC_TRANSFORMS_RECTIFY_H_
 
+#include "src/fusable.h"
 #include "src/transforms/common.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
 
-class Rectify : public OmpUniformFormatTransform<formats::ArrayFormatF> {
+class Rectify : public OmpUniformFormatTransform<formats::ArrayFormatF>,
+                public Fusable {
  public:
   TRANSFORM_INTRO("Rectify", "Wave rectification to decrease high-frequency "
                              "content.",
                   Rectify)
 
+  virtual void DoBuffer(const float* in, float* out) const noexcept override;
+
  protected:
   virtual void Do(const float* in, float* out) const noexcept override;
 
@@ -91,6 +91,10 @@ void Selector::Do(const float* in, float* out) const noexcept {
   }
 }
 
+void Selector::DoBuffer(const float* in, float* out) const noexcept {
+  Do(in, out);
+}
+
 RTP(Selector, from)
 RTP(Selector, length)
 RTP(Selector, select)
@@ -31,6 +31,7 @@
 #ifndef SRC_TRANSFORMS_SELECTOR_H_
 #define SRC_TRANSFORMS_SELECTOR_H_
 
+#include "src/fusable.h"
 #include "src/transforms/common.h"
 
 namespace sound_feature_extraction {
@@ -64,7 +65,8 @@ namespace std {
 namespace sound_feature_extraction {
 namespace transforms {
 
-class Selector : public OmpUniformFormatTransform<formats::ArrayFormatF> {
+class Selector : public OmpUniformFormatTransform<formats::ArrayFormatF>,
+                 public Fusable {
  public:
   Selector();
 
@@ -79,6 +81,8 @@ class Selector : public OmpUniformFormatTransform<formats::ArrayFormatF> {
   TP(from, Anchor, kDefaultAnchor,
      "The anchor of the selection. Can be either \"left\" or \"right\".")
 
+  virtual void DoBuffer(const float* in, float* out) const noexcept override;
+
  protected:
   virtual size_t OnFormatChanged(size_t buffersCount) override;
 
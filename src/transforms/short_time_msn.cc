@@ -28,14 +28,21 @@
  *  under the License.
  */
 
-#include <simd/arithmetic-inl.h>
 #include "src/transforms/short_time_msn.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include "src/make_unique.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
 
+constexpr int ShortTimeMeanScaleNormalization::kGroupSize;
+constexpr int ShortTimeMeanScaleNormalization::kMinSumsBlockSize;
+
 ShortTimeMeanScaleNormalization::ShortTimeMeanScaleNormalization()
-    : length_(kDefaultLength) {
+    : length_(kDefaultLength),
+      buffers_count_(0) {
 }
 
 bool ShortTimeMeanScaleNormalization::validate_length(
@@ -43,41 +50,188 @@ bool ShortTimeMeanScaleNormalization::validate_length(
   return value >= 2;
 }
 
+size_t ShortTimeMeanScaleNormalization::OnFormatChanged(
+    size_t buffersCount) {
+  buffers_count_ = buffersCount;
+  return buffersCount;
+}
+
+void ShortTimeMeanScaleNormalization::Initialize() const {
+  if (streaming()) {
+    int back = length_ / 2;
+    int front = length_ - back;
+    // The sums block of a buffer may start SumsBlockSize() - 1 buffers
+    // earlier; the window of buffer i ends with i + front - 1
+    stream_.Initialize(input_format_, buffers_count_,
+                       back + SumsBlockSize() - 1, front - 1);
+  }
+  size_t size = PaddedCount(MaxCount()) * kGroupSize * 4;
+  extremums_.Reset([size]() {
+    return std::uniquify(mallocf(size), std::free);
+  }, threads_number());
+}
+
+void ShortTimeMeanScaleNormalization::ResetStream() const {
+  stream_.Reset();
+}
+
+bool ShortTimeMeanScaleNormalization::StreamsWindows() const noexcept {
+  return true;
+}
+
+StreamPiece ShortTimeMeanScaleNormalization::PrepareStreamPiece(
+    const StreamPiece& input) const noexcept {
+  return stream_.Prepare(input);
+}
+
+bool ShortTimeMeanScaleNormalization::StreamPending() const noexcept {
+  return stream_.Pending();
+}
+
+int ShortTimeMeanScaleNormalization::SumsBlockSize() const noexcept {
+  return std::max(length_, kMinSumsBlockSize);
+}
+
+int ShortTimeMeanScaleNormalization::MaxCount() const noexcept {
+  int count = buffers_count_;
+  if (streaming()) {
+    // The sequence of the stream holds the history and the lookahead, too
+    int back = length_ / 2;
+    count += back + SumsBlockSize() - 1 + length_ - back - 1;
+  }
+  return count;
+}
+
+int ShortTimeMeanScaleNormalization::PaddedCount(int count) const noexcept {
+  return count + length_ - 1;
+}
+
 void ShortTimeMeanScaleNormalization::Do(
     const BuffersBase<float*>& in,
     BuffersBase<float*>* out) const noexcept {
+  if (streaming()) {
+    stream_.Process(in, out, [this](
+        const BuffersBase<float*>& sequence, size_t origin, size_t first,
+        size_t last, BuffersBase<float*>* results) {
+      Calculate(sequence, origin, first, last, results);
+    });
+    return;
+  }
+  Calculate(in, 0, 0, in.Count(), out);
+}
+
+void ShortTimeMeanScaleNormalization::Calculate(
+    const BuffersBase<float*>& in, size_t origin, int first, int last,
+    BuffersBase<float*>* out) const noexcept {
+  int size = input_format_->Size();
+  int groups = (size + kGroupSize - 1) / kGroupSize;
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for num_threads(threads_number())
+#endif
+  for (int g = 0; g < groups; g++) {
+    DoGroup(in, origin, first, last, g * kGroupSize,
+            std::min(kGroupSize, size - g * kGroupSize), out);
+  }
+}
+
+void ShortTimeMeanScaleNormalization::DoGroup(
+    const BuffersBase<float*>& in, size_t origin, int first, int last,
+    int begin, int width, BuffersBase<float*>* out) const noexcept {
+  int count = in.Count();
+  if (count == 0 || first >= last) {
+    return;
+  }
   int back = length_ / 2;
   int front = length_ - back;
-  for (size_t i = 0; i < in.Count(); i++) {
-    for (int j = 0; j < static_cast<int>(input_format_->Size()); j++) {
-      int len = length_;
-      int backind = i - back;
-      if (backind < 0) {
-        len += backind;
-        backind = 0;
+  // The sequence is padded with back neutral values on the left and
+  // front - 1 on the right, so that every window has length_ elements.
+  // The window of buffer i is then [i, i + length_) in the padded indices.
+  int padded = PaddedCount(count);
+  const float kLowest = -std::numeric_limits<float>::max();
+  const float kHighest = std::numeric_limits<float>::max();
+  // Prefix and suffix extremums inside each block of length_ elements
+  assert(count <= MaxCount());
+  float* prefix_max = extremums_.Get().get();
+  float* prefix_min = prefix_max + padded * kGroupSize;
+  float* suffix_max = prefix_min + padded * kGroupSize;
+  float* suffix_min = suffix_max + padded * kGroupSize;
+  for (int p = 0; p < padded; p++) {
+    int k = p - back;
+    float* pmax = &prefix_max[p * kGroupSize];
+    float* pmin = &prefix_min[p * kGroupSize];
+    if (k < 0 || k >= count) {
+      std::fill(pmax, pmax + width, kLowest);
+      std::fill(pmin, pmin + width, kHighest);
+    } else {
+      std::copy(in[k] + begin, in[k] + begin + width, pmax);
+      std::copy(in[k] + begin, in[k] + begin + width, pmin);
+    }
+    std::copy(pmax, pmax + width, &suffix_max[p * kGroupSize]);
+    std::copy(pmin, pmin + width, &suffix_min[p * kGroupSize]);
+    if (p % length_ != 0) {
+      const float* prev_max = pmax - kGroupSize;
+      const float* prev_min = pmin - kGroupSize;
+      for (int c = 0; c < width; c++) {
+        pmax[c] = std::max(pmax[c], prev_max[c]);
+        pmin[c] = std::min(pmin[c], prev_min[c]);
       }
-      int frontind = i + front;
-      if (frontind > static_cast<int>(in.Count())) {
-        len += in.Count() - frontind;
-        frontind = static_cast<int>(in.Count());
+    }
+  }
+  for (int p = padded - 2; p >= 0; p--) {
+    if (p % length_ == length_ - 1) {
+      continue;
+    }
+    float* smax = &suffix_max[p * kGroupSize];
+    float* smin = &suffix_min[p * kGroupSize];
+    for (int c = 0; c < width; c++) {
+      smax[c] = std::max(smax[c], smax[c + kGroupSize]);
+      smin[c] = std::min(smin[c], smin[c + kGroupSize]);
+    }
+  }
+
+  // The sums are recalculated at the beginning of each block, which is
+  // aligned to the beginning of the stream, so that the rounding does not
+  // depend on how the stream is split into pieces
+  int block_size = SumsBlockSize();
+  int offset = origin;
+  int start = first - (offset + first) % block_size;
+  double sums[kGroupSize] = {};
+  for (int i = start; i < last; i++) {
+    if ((offset + i) % block_size == 0) {
+      std::fill(sums, sums + width, 0.);
+      for (int k = std::max(0, i - back); k < std::min(count, i + front);
+           k++) {
+        for (int c = 0; c < width; c++) {
+          sums[c] += in[k][begin + c];
+        }
       }
-      float sum = 0.f;
-      float thisval = in[i][j];
-      float min = thisval;
-      float max = thisval;
-      for (int k = backind; k < frontind; k++) {
-        float val = in[k][j];
-        sum += val;
-        if (min > val) {
-          min = val;
-        } else if (max < val) {
-          max = val;
+    }
+    if (i >= first) {
+      int len = std::min(count, i + front) - std::max(0, i - back);
+      const float* smax = &suffix_max[i * kGroupSize];
+      const float* smin = &suffix_min[i * kGroupSize];
+      const float* pmax = &prefix_max[(i + length_ - 1) * kGroupSize];
+      const float* pmin = &prefix_min[(i + length_ - 1) * kGroupSize];
+      for (int c = 0; c < width; c++) {
+        float max = std::max(smax[c], pmax[c]);
+        float min = std::min(smin[c], pmin[c]);
+        if (max - min > 0) {
+          (*out)[i][begin + c] = (in[i][begin + c] - sums[c] / len) /
+              (max - min);
+        } else {
+          (*out)[i][begin + c] = 0;
         }
       }
-      if (max - min > 0) {
-        (*out)[i][j] = (thisval - sum / len) / (max - min);
-      } else {
-        (*out)[i][j] = 0;
+    }
+    // Slide the window
+    if (i + front < count) {
+      for (int c = 0; c < width; c++) {
+        sums[c] += in[i + front][begin + c];
+      }
+    }
+    if (i - back >= 0) {
+      for (int c = 0; c < width; c++) {
+        sums[c] -= in[i - back][begin + c];
       }
     }
   }
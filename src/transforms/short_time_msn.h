@@ -31,14 +31,15 @@
 #ifndef SRC_TRANSFORMS_SHORT_TIME_MSN_H_
 #define SRC_TRANSFORMS_SHORT_TIME_MSN_H_
 
-#include "src/formats/array_format.h"
-#include "src/transform_base.h"
+#include "src/transforms/common.h"
+#include "src/lookahead_stream.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
 
 class ShortTimeMeanScaleNormalization
-    : public UniformFormatTransform<formats::ArrayFormatF> {
+    : public UniformFormatOmpAwareTransform<formats::ArrayFormatF>,
+      public StreamingAware {
  public:
   ShortTimeMeanScaleNormalization();
 
@@ -52,11 +53,60 @@ class ShortTimeMeanScaleNormalization
 
   TP(length, int, kDefaultLength, "The amount of local values to average.")
 
+  virtual bool BufferInvariant() const noexcept override final {
+    return false;
+  }
+
+  virtual void Initialize() const override;
+
+  virtual void ResetStream() const override;
+  virtual bool StreamsWindows() const noexcept override;
+  virtual StreamPiece PrepareStreamPiece(const StreamPiece& input) const
+      noexcept override;
+  virtual bool StreamPending() const noexcept override;
+
  protected:
+  virtual size_t OnFormatChanged(size_t buffersCount) override;
+
   virtual void Do(const BuffersBase<float*>& in,
                   BuffersBase<float*>* out) const noexcept override;
 
+  /// @brief Normalizes the buffers [first, last).
+  /// @param origin The index of in[0] in the stream. The blocks of the sums
+  /// are aligned to it.
+  void Calculate(const BuffersBase<float*>& in, size_t origin, int first,
+                 int last, BuffersBase<float*>* out) const noexcept;
+
+  /// @brief Normalizes the coefficients [begin, begin + width) of
+  /// the buffers [first, last). The window minimums and maximums are found
+  /// with the van Herk/Gil-Werman algorithm, the sums are updated
+  /// incrementally inside each block of SumsBlockSize() buffers.
+  void DoGroup(const BuffersBase<float*>& in, size_t origin, int first,
+               int last, int begin, int width,
+               BuffersBase<float*>* out) const noexcept;
+
+  /// @brief The number of buffers between the recalculations of the sums
+  /// from scratch.
+  int SumsBlockSize() const noexcept;
+
+  /// @brief The largest number of the buffers passed to DoGroup().
+  int MaxCount() const noexcept;
+
+  /// @brief The number of the buffers padded by DoGroup() for the specified
+  /// count.
+  int PaddedCount(int count) const noexcept;
+
   static constexpr int kDefaultLength = 300;
+  /// @brief The number of coefficients processed together, one cache line.
+  static constexpr int kGroupSize = 16;
+  static constexpr int kMinSumsBlockSize = 64;
+
+ private:
+  /// @brief The prefix and suffix extremums of DoGroup(), sized for
+  /// the longest sequence in Initialize().
+  mutable ThreadWorkspace<FloatPtr> extremums_;
+  mutable LookaheadStream stream_;
+  size_t buffers_count_;
 };
 
 }  // namespace transforms
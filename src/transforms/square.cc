@@ -52,6 +52,10 @@ void SquareInverse::Do(const float* in UNUSED,
   assert(false && "Not implemented yet");
 }
 
+void Square::DoBuffer(const float* in, float* out) const noexcept {
+  Do(in, out);
+}
+
 REGISTER_TRANSFORM(Square);
 REGISTER_TRANSFORM(SquareInverse);
 
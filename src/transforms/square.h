@@ -31,17 +31,21 @@
 #ifndef SRC_TRANSFORMS_SQUARE_H_
 #define SRC_TRANSFORMS_SQUARE_H_
 
+#include "src/fusable.h"
 #include "src/transforms/common.h"
 
 namespace sound_feature_extraction {
 namespace transforms {
 
-class Square : public OmpUniformFormatTransform<formats::ArrayFormatF> {
+class Square : public OmpUniformFormatTransform<formats::ArrayFormatF>,
+               public Fusable {
  public:
   TRANSFORM_INTRO("Square", "Squares the signal (window floating point "
                             "format).",
                   Square)
 
+  virtual void DoBuffer(const float* in, float* out) const noexcept override;
+
  protected:
   virtual void Do(const float* in, float* out) const noexcept override;
 
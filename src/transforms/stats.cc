@@ -33,8 +33,9 @@
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 #include <boost/regex.hpp>
 #pragma GCC diagnostic pop
+#include <algorithm>
 #include <cmath>
-#include <simd/instruction_set.h>
+#include <vector>
 
 namespace sound_feature_extraction {
 namespace transforms {
@@ -82,6 +83,9 @@ const std::unordered_map<int, Stats::CalculateFunc> Stats::kStatsFuncs {
   { kStatsTypeKurtosis, Stats::CalculateKurtosis }
 };
 
+constexpr size_t Stats::kMinChunkLength;
+constexpr size_t Stats::kRecenterPeriod;
+
 Stats::Stats()
     : types_(kDefaultStatsTypes()),
       interval_(kDefaultInterval),
@@ -123,189 +127,203 @@ size_t Stats::OnInputFormatChanged(size_t buffersCount) {
   return buffersCount;
 }
 
+size_t Stats::IntervalsCount() const noexcept {
+  return output_format_->Size() / types_.size();
+}
+
+size_t Stats::IntervalStart(size_t index) const noexcept {
+  size_t step = interval_ - overlap_;
+  return std::min(index * step, input_format_->Size() - interval_);
+}
+
 void Stats::Do(const float* in, float* out) const noexcept {
-  float rawMoments[kStatsTypeCount];
-  if (interval_ == 0) {
-    CalculateRawMoments(true, in, 0, input_format_->Size(), rawMoments);
-    Calculate(rawMoments, out);
-  } else {
-    size_t i;
-    size_t step = interval_ - overlap_;
-    for (i = 0; i < input_format_->Size() - interval_ + 1; i += step) {
-      CalculateRawMoments(true, in, i, interval_, rawMoments);
-      Calculate(rawMoments, out + i / step * types_.size());
+  DoBuffer(in, out, 1);
+}
+
+void Stats::Do(const BuffersBase<float*>& in,
+               BuffersBase<float*>* out) const noexcept {
+  if (static_cast<int>(in.Count()) >= threads_number()) {
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for num_threads(threads_number())
+#endif
+    for (size_t i = 0; i < in.Count(); i++) {
+      DoBuffer(in[i], (*out)[i], 1);
     }
-    if ((input_format_->Size() - interval_) % step != 0) {
-      int index = input_format_->Size() - interval_;
-      CalculateRawMoments(true, in, index, interval_, rawMoments);
-      Calculate(rawMoments, out + i / step * types_.size());
+    return;
+  }
+  for (size_t i = 0; i < in.Count(); i++) {
+    DoBuffer(in[i], (*out)[i], threads_number());
+  }
+}
+
+void Stats::DoBuffer(const float* in, float* out, int threads)
+    const noexcept {
+  if (interval_ != 0) {
+    int count = IntervalsCount();
+    int chunks = std::max(1, std::min(threads, count));
+#ifdef HAVE_OPENMP
+    #pragma omp parallel for num_threads(chunks) if (chunks > 1)
+#endif
+    for (int c = 0; c < chunks; c++) {
+      DoIntervals(in, static_cast<size_t>(count) * c / chunks,
+                  static_cast<size_t>(count) * (c + 1) / chunks, out);
+    }
+    return;
+  }
+
+  // Find the mean first, so that the centered sums do not lose precision
+  size_t size = input_format_->Size();
+  int chunks = std::max(1, std::min(
+      threads, static_cast<int>(size / kMinChunkLength)));
+  std::vector<double> sums((kStatsTypeCount + 1) * chunks, 0.);
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for num_threads(chunks) if (chunks > 1)
+#endif
+  for (int c = 0; c < chunks; c++) {
+    double sum = 0;
+    for (size_t i = size * c / chunks; i < size * (c + 1) / chunks; i++) {
+      sum += in[i];
     }
+    sums[c * (kStatsTypeCount + 1)] = sum;
+  }
+  double shift = 0;
+  for (int c = 0; c < chunks; c++) {
+    shift += sums[c * (kStatsTypeCount + 1)];
+  }
+  shift /= size;
+#ifdef HAVE_OPENMP
+  #pragma omp parallel for num_threads(chunks) if (chunks > 1)
+#endif
+  for (int c = 0; c < chunks; c++) {
+    size_t begin = size * c / chunks;
+    AddShiftedSums(in, begin, size * (c + 1) / chunks - begin, shift,
+                   &sums[c * (kStatsTypeCount + 1) + 1]);
+  }
+  double total[kStatsTypeCount] = {};
+  for (int c = 0; c < chunks; c++) {
+    for (int k = 0; k < kStatsTypeCount; k++) {
+      total[k] += sums[c * (kStatsTypeCount + 1) + 1 + k];
+    }
+  }
+  double rawMoments[kStatsTypeCount];
+  SumsToRawMoments(total, size, rawMoments);
+  Calculate(rawMoments, shift, out);
+}
+
+void Stats::DoIntervals(const float* in, size_t first, size_t last,
+                        float* out) const noexcept {
+  size_t start = 0;
+  double shift = 0;
+  double sums[kStatsTypeCount];
+  double rawMoments[kStatsTypeCount];
+  for (size_t index = first; index < last; index++) {
+    size_t next = IntervalStart(index);
+    // Center the sums on the current interval at the beginning of each
+    // block, so that they stay small and the sliding errors do not pile up.
+    // The blocks do not depend on [first, last), so the results are
+    // the same for any number of threads.
+    if (index == first || index % kRecenterPeriod == 0) {
+      start = next;
+      shift = 0;
+      for (size_t i = start; i < start + interval_; i++) {
+        shift += in[i];
+      }
+      shift /= interval_;
+      std::fill(sums, sums + kStatsTypeCount, 0.);
+      AddShiftedSums(in, start, interval_, shift, sums);
+    } else {
+      // Slide the window: drop the leading samples and add the new ones
+      size_t delta = next - start;
+      double dropped[kStatsTypeCount] = {};
+      AddShiftedSums(in, start, delta, shift, dropped);
+      AddShiftedSums(in, start + interval_, delta, shift, sums);
+      for (int k = 0; k < kStatsTypeCount; k++) {
+        sums[k] -= dropped[k];
+      }
+      start = next;
+    }
+    SumsToRawMoments(sums, interval_, rawMoments);
+    Calculate(rawMoments, shift, out + index * types_.size());
   }
 }
 
-void Stats::Calculate(const float* rawMoments, float* out) const noexcept {
+void Stats::Calculate(const double* rawMoments, double shift, float* out)
+    const noexcept {
   for (auto stat : types_) {
     int sind = 0;
     int istat = stat;
     while (istat >>= 1) {
       sind++;
     }
-    out[sind] = kStatsFuncs.find(stat)->second(rawMoments);
+    double value = kStatsFuncs.find(stat)->second(rawMoments);
+    if (stat == kStatsTypeAverage) {
+      value += shift;
+    }
+    out[sind] = value;
   }
 }
 
-void Stats::CalculateRawMoments(bool simd, const float* in, int startIndex,
-                                int length, float* rawMoments) noexcept {
-  float avg1 = 0, avg2 = 0, avg3 = 0, avg4 = 0;
-  auto end_index = startIndex + length;
-  if (simd) {
-#ifdef __AVX__
-    __m256 avg1vec = _mm256_setzero_ps();
-    __m256 avg2vec = _mm256_setzero_ps();
-    __m256 avg3vec = _mm256_setzero_ps();
-    __m256 avg4vec = _mm256_setzero_ps();
-    for (int i = startIndex; i < end_index - 7; i+=8) {
-      __m256 val = _mm256_loadu_ps(in + i);
-      avg1vec = _mm256_add_ps(avg1vec, val);
-      __m256 val2 = _mm256_mul_ps(val, val);
-      avg2vec = _mm256_add_ps(avg2vec, val2);
-      val = _mm256_mul_ps(val2, val);
-      avg3vec = _mm256_add_ps(avg3vec, val);
-      val2 = _mm256_mul_ps(val2, val2);
-      avg4vec = _mm256_add_ps(avg4vec, val2);
-    }
-    avg1vec = _mm256_hadd_ps(avg1vec, avg1vec);
-    avg1vec = _mm256_hadd_ps(avg1vec, avg1vec);
-    avg1 += _mm256_get_ps(avg1vec, 0);
-    avg1 += _mm256_get_ps(avg1vec, 4);
-    avg2vec = _mm256_hadd_ps(avg2vec, avg2vec);
-    avg2vec = _mm256_hadd_ps(avg2vec, avg2vec);
-    avg2 += _mm256_get_ps(avg2vec, 0);
-    avg2 += _mm256_get_ps(avg2vec, 4);
-    avg3vec = _mm256_hadd_ps(avg3vec, avg3vec);
-    avg3vec = _mm256_hadd_ps(avg3vec, avg3vec);
-    avg3 += _mm256_get_ps(avg3vec, 0);
-    avg3 += _mm256_get_ps(avg3vec, 4);
-    avg4vec = _mm256_hadd_ps(avg4vec, avg4vec);
-    avg4vec = _mm256_hadd_ps(avg4vec, avg4vec);
-    avg4 += _mm256_get_ps(avg4vec, 0);
-    avg4 += _mm256_get_ps(avg4vec, 4);
-    for (int i = ((end_index) & ~0x7); i < end_index; i++) {
-      float v = in[i];
-      avg1 += v;
-      float v2 = v * v;
-      avg2 += v2;
-      v *= v2;
-      avg3 += v;
-      v2 *= v2;
-      avg4 += v2;
-    }
-  } else {
-#elif defined(__ARM_NEON__)
-    float32x4_t avg1vec = vdupq_n_f32(0);
-    float32x4_t avg2vec = vdupq_n_f32(0);
-    float32x4_t avg3vec = vdupq_n_f32(0);
-    float32x4_t avg4vec = vdupq_n_f32(0);
-    for (int i = startIndex; i < end_index - 3; i+=4) {
-      float32x4_t val = vld1q_f32(in + i);
-      avg1vec = vaddq_f32(avg1vec, val);
-      float32x4_t val2 = vmulq_f32(val, val);
-      avg2vec = vaddq_f32(avg2vec, val2);
-      val = vmulq_f32(val2, val);
-      avg3vec = vaddq_f32(avg3vec, val);
-      val2 = vmulq_f32(val2, val2);
-      avg4vec = vaddq_f32(avg4vec, val2);
-    }
-    avg1 += vgetq_lane_f32(avg1vec, 0);
-    avg1 += vgetq_lane_f32(avg1vec, 1);
-    avg1 += vgetq_lane_f32(avg1vec, 2);
-    avg1 += vgetq_lane_f32(avg1vec, 3);
-    avg2 += vgetq_lane_f32(avg2vec, 0);
-    avg2 += vgetq_lane_f32(avg2vec, 1);
-    avg2 += vgetq_lane_f32(avg2vec, 2);
-    avg2 += vgetq_lane_f32(avg2vec, 3);
-    avg3 += vgetq_lane_f32(avg3vec, 0);
-    avg3 += vgetq_lane_f32(avg3vec, 1);
-    avg3 += vgetq_lane_f32(avg3vec, 2);
-    avg3 += vgetq_lane_f32(avg3vec, 3);
-    avg4 += vgetq_lane_f32(avg4vec, 0);
-    avg4 += vgetq_lane_f32(avg4vec, 1);
-    avg4 += vgetq_lane_f32(avg4vec, 2);
-    avg4 += vgetq_lane_f32(avg4vec, 3);
-    for (int i = ((end_index) & ~0x3); i < end_index; i++) {
-      float v = in[i];
-      avg1 += v;
-      float v2 = v * v;
-      avg2 += v2;
-      v *= v2;
-      avg3 += v;
-      v2 *= v2;
-      avg4 += v2;
-    }
-  } else {
-#else
-  } {
-#endif
-    for (int i = startIndex; i < end_index; i++) {
-      float v = in[i];
-      avg1 += v;
-      float v2 = v * v;
-      avg2 += v2;
-      v *= v2;
-      avg3 += v;
-      v2 *= v2;
-      avg4 += v2;
-    }
+void Stats::AddShiftedSums(const float* in, size_t startIndex,
+                           size_t length, double shift,
+                           double* sums) noexcept {
+  double sum1 = 0, sum2 = 0, sum3 = 0, sum4 = 0;
+  for (size_t i = startIndex; i < startIndex + length; i++) {
+    double v = in[i] - shift;
+    double v2 = v * v;
+    sum1 += v;
+    sum2 += v2;
+    sum3 += v2 * v;
+    sum4 += v2 * v2;
+  }
+  sums[0] += sum1;
+  sums[1] += sum2;
+  sums[2] += sum3;
+  sums[3] += sum4;
+}
+
+void Stats::SumsToRawMoments(const double* sums, size_t length,
+                             double* rawMoments) noexcept {
+  for (int k = 0; k < kStatsTypeCount; k++) {
+    rawMoments[k] = sums[k] / length;
   }
-  avg1 /= length;
-  avg2 /= length;
-  avg3 /= length;
-  avg4 /= length;
-  rawMoments[0] = avg1;
-  rawMoments[1] = avg2;
-  rawMoments[2] = avg3;
-  rawMoments[3] = avg4;
 }
 
-float Stats::CalculateAverage(const float* rawMoments) noexcept {
+float Stats::CalculateAverage(const double* rawMoments) noexcept {
   return rawMoments[0];
 }
 
-float Stats::CalculateStdDeviation(const float* rawMoments) noexcept {
-  auto value = rawMoments[1] - rawMoments[0] * rawMoments[0];
+float Stats::CalculateStdDeviation(const double* rawMoments) noexcept {
+  double value = rawMoments[1] - rawMoments[0] * rawMoments[0];
   if (value < 0) {
     return 0;
   }
-  value = sqrtf(value);
-  return value;
+  return sqrt(value);
 }
 
-float Stats::CalculateSkewness(const float* rawMoments) noexcept {
-  float avg1 = rawMoments[0];
-  float avg2 = rawMoments[1];
-  float avg3 = rawMoments[2];
+float Stats::CalculateSkewness(const double* rawMoments) noexcept {
+  double avg1 = rawMoments[0];
+  double avg2 = rawMoments[1];
+  double avg3 = rawMoments[2];
   double u2 = avg2 - avg1 * avg1;
   if (u2 <= 0) {
     return 0;
   }
   double u3 = avg3 - 3 * avg2 * avg1 + 2 * avg1 * avg1 * avg1;
-  auto value = u3 / (sqrt(u2) * u2);
-  return value;
+  return u3 / (sqrt(u2) * u2);
 }
 
-float Stats::CalculateKurtosis(const float* rawMoments) noexcept {
-  float avg1 = rawMoments[0];
-  float avg2 = rawMoments[1];
-  float avg3 = rawMoments[2];
-  float avg4 = rawMoments[3];
+float Stats::CalculateKurtosis(const double* rawMoments) noexcept {
+  double avg1 = rawMoments[0];
+  double avg2 = rawMoments[1];
+  double avg3 = rawMoments[2];
+  double avg4 = rawMoments[3];
   double u2 = avg2 - avg1 * avg1;
   if (u2 == 0) {
     return -2.f;
   }
   double u4 = avg4 - 4 * avg3 * avg1 + 6 * avg2 * avg1 * avg1
       - 3 * avg1 * avg1 * avg1 * avg1;
-  auto value = u4 / (u2 * u2) - 3;
-  return value;
+  return u4 / (u2 * u2) - 3;
 }
 
 RTP(Stats, types)
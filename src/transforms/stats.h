@@ -125,7 +125,7 @@ class Stats : public OmpTransformBase<formats::ArrayFormatF,
   virtual void Initialize() const override;
 
  protected:
-  typedef float(*CalculateFunc)(const float*);
+  typedef float(*CalculateFunc)(const double*);
 
   static std::set<StatsType> kDefaultStatsTypes() noexcept {
     return { kStatsTypeAverage, kStatsTypeStdDeviation,
@@ -133,19 +133,54 @@ class Stats : public OmpTransformBase<formats::ArrayFormatF,
   }
   static constexpr int kDefaultInterval = 0;
   static constexpr int kDefaultOverlap = 0;
+  /// @brief The minimal number of samples per thread when a single buffer
+  /// is split.
+  static constexpr size_t kMinChunkLength = 16384;
+  /// @brief The number of the intervals after which the sliding sums are
+  /// centered on the current interval and recalculated from scratch.
+  static constexpr size_t kRecenterPeriod = 32;
   static const std::unordered_map<int, CalculateFunc> kStatsFuncs;
 
   virtual size_t OnInputFormatChanged(size_t buffersCount) override;
 
   virtual void Do(const float* in, float* out) const noexcept override;
 
-  void Calculate(const float* rawMoments, float* out) const noexcept;
-  static void CalculateRawMoments(bool simd, const float* in, int startIndex,
-                                  int length, float* rawMoments) noexcept;
-  static float CalculateAverage(const float* rawMoments) noexcept;
-  static float CalculateStdDeviation(const float* rawMoments) noexcept;
-  static float CalculateSkewness(const float* rawMoments) noexcept;
-  static float CalculateKurtosis(const float* rawMoments) noexcept;
+  /// @brief Splits each buffer between the threads if there are fewer
+  /// buffers than threads, e.g. after Merge.
+  virtual void Do(const BuffersBase<float*>& in,
+                  BuffersBase<float*>* out) const noexcept override;
+
+  /// @brief Calculates the stats of a single buffer.
+  /// @param threads The number of OpenMP threads to split the work between.
+  void DoBuffer(const float* in, float* out, int threads) const noexcept;
+
+  /// @brief Calculates the stats of the intervals [first, last) with
+  /// the sliding sums, so that each sample is visited at most twice, plus
+  /// once per kRecenterPeriod intervals.
+  void DoIntervals(const float* in, size_t first, size_t last,
+                   float* out) const noexcept;
+
+  /// @brief The number of the intervals in a buffer.
+  size_t IntervalsCount() const noexcept;
+
+  /// @brief The starting sample of the specified interval.
+  size_t IntervalStart(size_t index) const noexcept;
+
+  /// @param shift The value which was subtracted from the samples
+  /// before calculating rawMoments.
+  void Calculate(const double* rawMoments, double shift, float* out)
+      const noexcept;
+  /// @brief Adds sum (x - shift)^k, k = 1..4, over [startIndex,
+  /// startIndex + length) to sums.
+  static void AddShiftedSums(const float* in, size_t startIndex,
+                             size_t length, double shift,
+                             double* sums) noexcept;
+  static void SumsToRawMoments(const double* sums, size_t length,
+                               double* rawMoments) noexcept;
+  static float CalculateAverage(const double* rawMoments) noexcept;
+  static float CalculateStdDeviation(const double* rawMoments) noexcept;
+  static float CalculateSkewness(const double* rawMoments) noexcept;
+  static float CalculateKurtosis(const double* rawMoments) noexcept;
 };
 
 }  // namespace transforms
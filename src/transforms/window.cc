@@ -29,7 +29,6 @@
  */
 
 #include "src/transforms/window.h"
-#include <fftf/api.h>
 #include <simd/arithmetic-inl.h>
 
 namespace sound_feature_extraction {
@@ -92,15 +91,9 @@ void Window::Initialize() const {
     int length = input_format_->Size();
     int fftLength = (length - 2) / 2;
     window_ = InitializeWindow(fftLength, type_, length);
-    auto fftPlan = std::unique_ptr<FFTFInstance, void (*)(FFTFInstance *)>(
-        fftf_init(
-            FFTF_TYPE_REAL, FFTF_DIRECTION_FORWARD,
-            FFTF_DIMENSION_1D,
-            &fftLength, FFTF_NO_OPTIONS,
-            window_.get(), window_.get()),
-        fftf_destroy);
-
-    fftf_calc(fftPlan.get());
+    // The plan is needed only once, so do not keep it in the cache
+    plan_cache()->CalculateOnce(FFTF_TYPE_REAL, FFTF_DIRECTION_FORWARD,
+                                fftLength, window_.get(), window_.get());
   }
 }
 
@@ -110,6 +103,10 @@ const noexcept {
   ApplyWindow(use_simd(), window_.get(), input_format_->Size(), in, out);
 }
 
+void Window::DoBuffer(const float* in, float* out) const noexcept {
+  Do(in, out);
+}
+
 RTP(Window, type)
 RTP(Window, predft)
 REGISTER_TRANSFORM(Window);
@@ -31,6 +31,8 @@
 #ifndef SRC_TRANSFORMS_WINDOW_H_
 #define SRC_TRANSFORMS_WINDOW_H_
 
+#include "src/fftf_plan_cache.h"
+#include "src/fusable.h"
 #include "src/transforms/common.h"
 #include "src/primitives/window.h"
 
@@ -38,7 +40,9 @@ namespace sound_feature_extraction {
 namespace transforms {
 
 //// @brief Applies a window function to each buffer.
-class Window : public OmpUniformFormatTransform<formats::ArrayFormatF> {
+class Window : public OmpUniformFormatTransform<formats::ArrayFormatF>,
+               public FFTFPlanCacheAware,
+               public Fusable {
   template <class T> friend class WindowSplitterTemplate;
   friend class WindowSplitter16;
   friend class WindowSplitterF;
@@ -56,6 +60,8 @@ class Window : public OmpUniformFormatTransform<formats::ArrayFormatF> {
 
   virtual void Initialize() const override;
 
+  virtual void DoBuffer(const float* in, float* out) const noexcept override;
+
  protected:
   typedef std::unique_ptr<float, void(*)(void*)> WindowContentsPtr;
   static constexpr WindowType kDefaultType = WindowType::kWindowTypeHamming;
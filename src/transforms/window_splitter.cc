@@ -43,9 +43,11 @@ const noexcept {
   float fbuf[output_format_->Size()] __attribute__ ((aligned (64)));  // NOLINT(*)
   float* window = window_.get();
 
+  assert(!streaming() || in.Count() == 1);
   for (size_t i = 0; i < in.Count(); i++) {
+    auto source = StreamSource(in[i]);
     for (int j = 0; j < windows_count_; j++) {
-      auto input = in[i] + j * step();
+      auto input = source + j * step();
       auto output = interleaved()? (*out)[i * windows_count_ + j] :
                                   (*out)[j * in.Count() + i];
       if (type() != WindowType::kWindowTypeRectangular) {
@@ -67,6 +69,7 @@ const noexcept {
       }
     }
   }
+  CarryStreamOverlap();
 }
 
 void WindowSplitterF::Do(const BuffersBase<float*>& in,
@@ -75,9 +78,11 @@ const noexcept {
 #ifdef __AVX__
   float intbuf[output_format_->Size()] __attribute__ ((aligned (32)));  // NOLINT(*)
 #endif
+  assert(!streaming() || in.Count() == 1);
   for (size_t i = 0; i < in.Count(); i++) {
+    auto source = StreamSource(in[i]);
     for (int j = 0; j < windows_count_; j++) {
-      auto input = in[i] + j * step();
+      auto input = source + j * step();
       auto output = (*out)[i * windows_count_ + j];
       if (type() != WindowType::kWindowTypeRectangular) {
 #ifdef __AVX__
@@ -97,6 +102,7 @@ const noexcept {
       }
     }
   }
+  CarryStreamOverlap();
 }
 
 REGISTER_TRANSFORM(WindowSplitter16);
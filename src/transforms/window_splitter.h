@@ -31,6 +31,8 @@
 #ifndef SRC_TRANSFORMS_WINDOW_SPLITTER_H_
 #define SRC_TRANSFORMS_WINDOW_SPLITTER_H_
 
+#include <simd/memory.h>
+#include "src/streaming_aware.h"
 #include "src/transforms/window.h"
 
 namespace sound_feature_extraction {
@@ -92,14 +94,18 @@ template <class T>
 RTP(WindowSplitterTemplateBase<T>, interleaved)
 
 /// @brief Splits the raw stream into numerous small chunks aka windows.
+/// @details In the streaming mode, the last windows of each piece are
+/// completed with the samples of the next one.
 template <class T>
 class WindowSplitterTemplate
     : public WindowSplitterTemplateBase<T>,
-      public TransformLogger<WindowSplitterTemplate<T>> {
+      public TransformLogger<WindowSplitterTemplate<T>>,
+      public StreamingAware {
  public:
   WindowSplitterTemplate()
       : type_(kDefaultWindowType),
-        window_(nullptr, free) {
+        window_(nullptr, free),
+        stream_buffer_(nullptr, free) {
   }
 
   TRANSFORM_INTRO("Window", "Splits the raw input signal into numerous "
@@ -111,31 +117,103 @@ class WindowSplitterTemplate
      "Type of the window. E.g. \"rectangular\" or \"hamming\".")
 
   virtual void Initialize() const {
-    int realSize = this->input_format_->Size() - this->output_format_->Size();
-    int excess = realSize % this->step();
-    if (excess != 0) {
-      WRN("(input buffer size %zu - window length %zu) = %i is not "
-          "divisible by step %i. Its excess (%i samples) will not be "
-          "processed.",
-          this->input_format_->Size(), this->output_format_->Size(),
-          realSize, this->step(), excess);
+    if (!this->streaming()) {
+      int realSize = this->input_format_->Size() -
+          this->output_format_->Size();
+      int excess = realSize % this->step();
+      if (excess != 0) {
+        WRN("(input buffer size %zu - window length %zu) = %i is not "
+            "divisible by step %i. Its excess (%i samples) will not be "
+            "processed.",
+            this->input_format_->Size(), this->output_format_->Size(),
+            realSize, this->step(), excess);
+      }
+    } else {
+      stream_buffer_ = std::unique_ptr<T, void(*)(void*)>(
+          reinterpret_cast<T*>(malloc_aligned(
+              (StreamOverlap() + this->input_format_->Size()) * sizeof(T))),
+          free);
+      ResetStream();
     }
 
     window_ = Window::InitializeWindow(this->output_format_->Size(), type_);
   }
 
+  virtual void ResetStream() const override {
+    memset(stream_buffer_.get(), 0, StreamOverlap() * sizeof(T));
+  }
+
+  virtual bool SplitsStream() const noexcept override {
+    return true;
+  }
+
+  virtual size_t StreamDelay() const noexcept override {
+    return StreamOverlap() / this->step();
+  }
+
+  virtual size_t StreamedSize(size_t validInput) const noexcept override {
+    size_t available = StreamOverlap() + validInput;
+    size_t length = this->length();
+    if (available < length) {
+      return 0;
+    }
+    return std::min(static_cast<size_t>(this->windows_count_),
+                    (available - length) / this->step() + 1);
+  }
+
  protected:
   virtual size_t OnFormatChanged(size_t buffersCount) override final {
     this->output_format_->SetSize(this->length());
+    if (this->streaming()) {
+      // Each piece yields the windows which start inside it
+      if (this->input_format_->Size() % this->step() != 0) {
+        throw InvalidStreamedPieceSizeException(this->input_format_->Size(),
+                                                this->step());
+      }
+      this->windows_count_ = this->input_format_->Size() / this->step();
+      return this->windows_count_ * buffersCount;
+    }
     int realSize = this->input_format_->Size() - this->output_format_->Size();
     this->windows_count_ = realSize / this->step()+ 1;
     return this->windows_count_ * buffersCount;
   }
 
+  /// @brief The number of the trailing samples of the previous piece which
+  /// precede the current one in the streaming mode. It is the multiple of
+  /// step, so that the windows stay aligned to the beginning of the stream.
+  size_t StreamOverlap() const noexcept {
+    int overlap = this->length() - this->step();
+    if (overlap <= 0) {
+      return 0;
+    }
+    return (overlap + this->step() - 1) / this->step() * this->step();
+  }
+
+  /// @brief Returns the signal to split: the input itself or, in the
+  /// streaming mode, the overlap followed by the input.
+  const T* StreamSource(const T* input) const noexcept {
+    if (!this->streaming()) {
+      return input;
+    }
+    memcpy(stream_buffer_.get() + StreamOverlap(), input,
+           this->input_format_->Size() * sizeof(T));
+    return stream_buffer_.get();
+  }
+
+  /// @brief Keeps the tail of the current piece for the next one.
+  void CarryStreamOverlap() const noexcept {
+    if (this->streaming()) {
+      memmove(stream_buffer_.get(),
+              stream_buffer_.get() + this->input_format_->Size(),
+              StreamOverlap() * sizeof(T));
+    }
+  }
+
   static constexpr WindowType kDefaultWindowType =
       WindowType::kWindowTypeHamming;
 
   mutable Window::WindowContentsPtr window_;
+  mutable std::unique_ptr<T, void(*)(void*)> stream_buffer_;
 };
 
 template <class T>
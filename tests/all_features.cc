@@ -28,111 +28,113 @@
  *  under the License.
  */
 
+#include <vector>
 #include <gtest/gtest.h>
 #include <fftf/api.h>
 #include "src/transform_tree.h"
 #include "src/transform_registry.h"
+#include "src/allocators/sliding_blocks_allocator.h"
 #include "src/formats/array_format.h"
 #include "tests/speech_sample.inc"
 
 using sound_feature_extraction::TransformTree;
 using sound_feature_extraction::BuffersBase;
+using sound_feature_extraction::memory_allocation::SlidingBlocksAllocator;
 
-TEST(Features, All) {
-  fftf_available_backends(nullptr, nullptr);
-  TransformTree tt( { 48000, 22050 } );  // NOLINT(*)
-  tt.AddFeature("Energy", { { "Window", "type=rectangular" }, { "Window", "" },
+static void AddAllFeatures(TransformTree* tt) {
+  tt->AddFeature("Energy", { { "Window", "type=rectangular" }, { "Window", "" },
       { "Energy", "" }
   });
-  tt.AddFeature("Centroid", { { "Window", "type=rectangular" },
+  tt->AddFeature("Centroid", { { "Window", "type=rectangular" },
       { "Window", "" },  { "RDFT", "" }, { "ComplexMagnitude", "" },
       { "Centroid", "" }
   });
-  tt.AddFeature("Rolloff", { { "Window", "type=rectangular" }, { "Window", "" },
-      { "RDFT", "" }, { "ComplexMagnitude", "" }, { "Rolloff", "" }
+  tt->AddFeature("Rolloff", { { "Window", "type=rectangular" },
+      { "Window", "" }, { "RDFT", "" }, { "ComplexMagnitude", "" },
+      { "Rolloff", "" }
   });
-  tt.AddFeature("Flux", { { "Window", "type=rectangular" }, { "Window", "" },
+  tt->AddFeature("Flux", { { "Window", "type=rectangular" }, { "Window", "" },
       { "RDFT", "" }, { "ComplexMagnitude", "" }, { "Flux", "" }
   });
-  tt.AddFeature("ZeroCrossings", {
+  tt->AddFeature("ZeroCrossings", {
       { "Window", "type=rectangular,length=512,step=205" },
       { "ZeroCrossings", "" },
       { "Merge", "" },
       { "Stats", "interval=50" }
   });
-  tt.AddFeature("WPP", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("WPP", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" },
       { "DWPT", "" }, { "SubbandEnergy", "" }, { "Log", "" },
       /*{ "Square", "" },*/ { "DWPT", "order=4, tree=1 2 3 3" },
       { "Selector", "length=16, threads_number=1" }, { "STMSN", "length=25" }
   });
-  tt.AddFeature("WPP_D1", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("WPP_D1", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" },
       { "DWPT", "" }, { "SubbandEnergy", "" }, { "Log", "" },
       /*{ "Square", "" },*/ { "DWPT", "order=4, tree=1 2 3 3" },
       { "Selector", "length=16, threads_number=1" }, { "Delta", "" },
       { "STMSN", "length=25" }
   });
-  tt.AddFeature("WPP_D2", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("WPP_D2", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" },
       { "DWPT", "" }, { "SubbandEnergy", "" }, { "Log", "" },
       /*{ "Square", "" },*/ { "DWPT", "order=4, tree=1 2 3 3" },
       { "Selector", "length=16, threads_number=1" }, { "Delta", "" },
       { "Delta", "" }, { "STMSN", "length=25" }
   });
-  tt.AddFeature("SFM", { { "Window", "type=rectangular" }, { "Window", "" },
+  tt->AddFeature("SFM", { { "Window", "type=rectangular" }, { "Window", "" },
       { "RDFT", "" }, { "ComplexMagnitude", "" },
       { "Mean", "types=arithmetic geometric" }, { "SFM", "" }
   });
-  tt.AddFeature("DominantFrequency", { { "Window", "type=rectangular" },
+  tt->AddFeature("DominantFrequency", { { "Window", "type=rectangular" },
       { "Window", "" }, { "RDFT", "" },
       { "ComplexMagnitude", "" }, { "Peaks", "number=1" }
   });
-  tt.AddFeature("SBC", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("SBC", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" },
       { "DWPT", "" }, { "SubbandEnergy", "" }, { "Log", "" },
       /*{ "Square", "" },*/ { "ZeroPadding", "" }, { "DCT", "" },
       { "Selector", "length=16, threads_number=1" }, { "STMSN", "length=25" }
   });
-  tt.AddFeature("SBC_D1", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("SBC_D1", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" },
       { "DWPT", "" }, { "SubbandEnergy", "" }, { "Log", "" },
       /*{ "Square", "" },*/ { "ZeroPadding", "" }, { "DCT", "" },
       { "Selector", "length=16, threads_number=1" }, { "Delta", "" },
       { "STMSN", "length=25" }
   });
-  tt.AddFeature("SBC_D2", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("SBC_D2", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" },
       { "DWPT", "" }, { "SubbandEnergy", "" }, { "Log", "" },
       /*{ "Square", "" },*/ { "ZeroPadding", "" }, { "DCT", "" },
       { "Selector", "length=16, threads_number=1" }, { "Delta", "" },
       { "Delta", "" }, { "STMSN", "length=25" }
   });
-  tt.AddFeature("MFCC", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("MFCC", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" }, { "Window", "" },
       { "RDFT", "" }, { "SpectralEnergy", "" },
       { "FilterBank", "squared=true" }, { "Log", "" }, { "Square", "" },
       { "DCT", "" }, { "Selector", "length=16, threads_number=1" },
       { "STMSN", "length=25" }
   });
-  tt.AddFeature("MFCC_D1", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("MFCC_D1", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" }, { "Window", "" },
       { "RDFT", "" }, { "SpectralEnergy", "" },
       { "FilterBank", "squared=true" }, { "Log", "" }, { "Square", "" },
       { "DCT", "" }, { "Selector", "length=16, threads_number=1"},
       { "Delta", "" }, { "STMSN", "length=25" }
   });
-  tt.AddFeature("MFCC_D2", { { "Preemphasis", "value=0.2" },
+  tt->AddFeature("MFCC_D2", { { "Preemphasis", "value=0.2" },
       { "Window", "type=rectangular" }, { "Window", "" },
       { "RDFT", "" }, { "SpectralEnergy", "" },
       { "FilterBank", "squared=true" }, { "Log", "" }, { "Square", "" },
       { "DCT", "" }, { "Selector", "length=16, threads_number=1"},
       { "Delta", "" }, { "Delta", "" }, { "STMSN", "length=25" }
   });
-  tt.AddFeature("F0_HPS", { { "Window", "type=rectangular" }, { "Window", "" },
+  tt->AddFeature("F0_HPS", { { "Window", "type=rectangular" }, { "Window", "" },
       { "RDFT", "" }, { "ComplexMagnitude", "" }, { "SHC", "" }, { "Peaks", "" }
   });
-  tt.AddFeature("CRP", { { "Window", "length=4096,step=2048" },{ "RDFT", "" },
+  tt->AddFeature("CRP", { { "Window", "length=4096,step=2048" },{ "RDFT", "" },
       { "SpectralEnergy", "" }, { "FilterBank", "type=midi,number=108,"
           "frequency_min=7.946364,frequency_max=8137.0754,squared=true" },
       { "Log", "add1=true,scale=1000" }, { "DCT", "" },
@@ -140,6 +142,12 @@ TEST(Features, All) {
       { "Reorder", "algorithm=chroma" },
       { "Stats", "types=average,interval=9" }
   });
+}
+
+TEST(Features, All) {
+  fftf_available_backends(nullptr, nullptr);
+  TransformTree tt( { 48000, 22050 } );  // NOLINT(*)
+  AddAllFeatures(&tt);
   int16_t* buffers = new int16_t[48000];
   memcpy(buffers, data, sizeof(data));
   tt.PrepareForExecution();
@@ -187,4 +195,52 @@ TEST(Features, All) {
   }
 }
 
+TEST(Features, BranchThreads) {
+  fftf_available_backends(nullptr, nullptr);
+  TransformTree sequential( { 48000, 22050 } );  // NOLINT(*)
+  AddAllFeatures(&sequential);
+  TransformTree parallel( { 48000, 22050 } );  // NOLINT(*)
+  AddAllFeatures(&parallel);
+  parallel.set_branch_threads_number(4);
+  sequential.PrepareForExecution();
+  parallel.PrepareForExecution();
+  std::vector<int16_t> buffers(48000);
+  memcpy(buffers.data(), data, sizeof(data));
+  auto expected = sequential.Execute(buffers.data());
+  // The second run is prioritized using the times measured by the first
+  for (int run = 0; run < 2; run++) {
+    auto res = parallel.Execute(buffers.data());
+    ASSERT_EQ(expected.size(), res.size());
+    for (auto& feature : expected) {
+      SCOPED_TRACE(feature.first);
+      auto& actual = res[feature.first];
+      ASSERT_NE(nullptr, actual);
+      ASSERT_EQ(feature.second->Count(), actual->Count());
+      size_t size = feature.second->Format()->SizeInBytes();
+      ASSERT_EQ(size, actual->Format()->SizeInBytes());
+      for (size_t i = 0; i < actual->Count(); i++) {
+        ASSERT_EQ(0, memcmp((*feature.second)[i], (*actual)[i], size)) << i;
+      }
+    }
+  }
+}
+
+TEST(Features, Allocators) {
+  fftf_available_backends(nullptr, nullptr);
+  TransformTree heuristic( { 48000, 22050 } );  // NOLINT(*)
+  AddAllFeatures(&heuristic);
+  heuristic.PrepareForExecution();
+  TransformTree sliding( { 48000, 22050 } );  // NOLINT(*)
+  AddAllFeatures(&sliding);
+  sliding.set_allocator(std::make_shared<SlidingBlocksAllocator>());
+  sliding.PrepareForExecution();
+  printf("HeuristicAllocator: %zu bytes, SlidingBlocksAllocator: %zu bytes\n",
+         heuristic.NeededMemory(), sliding.NeededMemory());
+  // The default allocator must not take more memory than the previous one
+  ASSERT_LE(heuristic.NeededMemory(), sliding.NeededMemory());
+  std::vector<int16_t> buffers(48000);
+  memcpy(buffers.data(), data, sizeof(data));
+  ASSERT_EQ(18U, sliding.Execute(buffers.data()).size());
+}
+
 #include "tests/google/src/gtest_main.cc"
@@ -0,0 +1,113 @@
+/*! @file heuristic_allocator.cc
+ *  @brief Tests for HeuristicAllocator.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/allocators/heuristic_allocator.h"
+#include <gtest/gtest.h>
+#include <memory>
+
+using sound_feature_extraction::memory_allocation::Node;
+using sound_feature_extraction::memory_allocation::HeuristicAllocator;
+
+TEST(HeuristicAllocator, Solve) {
+  int data;
+  int *item = &data;
+  auto root = std::make_shared<Node>(1, nullptr, item++);
+  Node* node = root.get();
+  node->Children.push_back(Node(1, node, item++));
+
+  node = &node->Children[0];
+  node->Children.push_back(Node(1, node, item++));
+
+  node->Children.push_back(Node(1, node, item++));
+  node->Children.push_back(Node(2, node, item++));
+
+  node = &node->Children[1];
+  node->Children.push_back(Node(3, node, item++));
+  node->Children.push_back(Node(2, node, item++));
+  node->Children.push_back(Node(4, node, item++));
+
+  node = &node->Children[0];
+  node->Children.push_back(Node(1, node, item++));
+  node->Children.push_back(Node(2, node, item++));
+
+  node = &node->Parent->Children[1];
+  node->Children.push_back(Node(1, node, item++));
+
+  node = &node->Children[0];
+  node->Children.push_back(Node(1, node, item++));
+
+
+  HeuristicAllocator alloc;
+  size_t peak = alloc.Solve(root.get());
+  root->Dump("/tmp/heuristic_allocator_test.dot");
+  ASSERT_TRUE(alloc.Validate(*root));
+  EXPECT_GE(peak, alloc.lower_bound());
+}
+
+/// @brief The tree is too large for the exhaustive enumeration of
+/// the traversal orders.
+TEST(HeuristicAllocator, SolveLarge) {
+  std::vector<int> items(1 + 8 + 8 * 6 + 8 * 6 * 4);
+  int *item = &items[0];
+  auto root = std::make_shared<Node>(0, nullptr, item++);
+  for (int i = 0; i < 8; i++) {
+    root->Children.push_back(Node(100 + i * 10, root.get(), item++));
+  }
+  for (int i = 0; i < 8; i++) {
+    auto branch = &root->Children[i];
+    for (int j = 0; j < 6; j++) {
+      branch->Children.push_back(Node(50 + i * j, branch, item++));
+    }
+    for (int j = 0; j < 6; j++) {
+      auto node = &branch->Children[j];
+      for (int k = 0; k < 4; k++) {
+        node->Children.push_back(Node(1 + (i + j + k) % 5, node, item++));
+      }
+    }
+  }
+  // Without the budget only the initial order is taken
+  HeuristicAllocator alloc;
+  alloc.set_time_budget(std::chrono::milliseconds(0));
+  size_t initial = alloc.Solve(root.get());
+  ASSERT_TRUE(alloc.Validate(*root));
+  EXPECT_EQ(0, alloc.iterations());
+  EXPECT_GE(initial, alloc.lower_bound());
+  // The local search may only improve it
+  alloc.set_time_budget(std::chrono::milliseconds(100));
+  size_t peak = alloc.Solve(root.get());
+  ASSERT_TRUE(alloc.Validate(*root));
+  EXPECT_GE(peak, alloc.lower_bound());
+  EXPECT_LE(peak, initial);
+  if (initial > alloc.lower_bound()) {
+    EXPECT_GT(alloc.iterations(), 0);
+  }
+}
+
+#include "tests/google/src/gtest_main.cc"
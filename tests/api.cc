@@ -37,6 +37,8 @@
 #pragma GCC diagnostic pop
 #include <fstream>
 #include <streambuf>
+#include <thread>
+#include <vector>
 
 TEST(API, query_transforms_list) {
   char** names = nullptr;
@@ -114,6 +116,330 @@ TEST(API, extract_sound_features) {
   delete[] buffer;
 }
 
+TEST(API, extract_sound_features_to) {
+  const char *features[] = {
+      "MFCC [Window(length=512), RDFT, SpectralEnergy,"
+      "FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]",
+      "Energy [Window(length=512), Energy]"
+  };
+  auto config = setup_features_extraction(features, 2, 48000, 16000);
+  ASSERT_NE(nullptr, config);
+  auto buffer = new int16_t[48000];
+  for (int i = 0; i < 48000; i++) {
+    buffer[i] = sinf(i / 4.0f) * INT16_MAX;
+  }
+  char **sizeNames = nullptr;
+  size_t *sizes = nullptr;
+  int count = 0;
+  query_feature_output_sizes(config, &sizeNames, &sizes, &count);
+  ASSERT_EQ(2, count);
+  std::vector<std::vector<char>> outputs(count);
+  std::vector<void*> outputPtrs(count);
+  for (int i = 0; i < count; i++) {
+    ASSERT_GT(sizes[i], 0U);
+    outputs[i].resize(sizes[i]);
+    outputPtrs[i] = outputs[i].data();
+  }
+  ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+            extract_sound_features_to(config, buffer, outputPtrs.data()));
+  char **featureNames = nullptr;
+  void **results = nullptr;
+  int *lengths = nullptr;
+  ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+            extract_sound_features(config, buffer, &featureNames, &results,
+                                   &lengths));
+  for (int i = 0; i < count; i++) {
+    int j = strcmp(featureNames[i], sizeNames[0])? 1 : 0;
+    ASSERT_STREQ(featureNames[i], sizeNames[j]);
+    ASSERT_EQ(sizes[j], static_cast<size_t>(lengths[i]));
+    ASSERT_EQ(0, memcmp(results[i], outputs[j].data(), lengths[i]));
+  }
+  free_results(count, featureNames, results, lengths);
+  destroy_feature_output_sizes(sizeNames, sizes, count);
+  destroy_features_configuration(config);
+  delete[] buffer;
+}
+
+TEST(API, extract_selected_sound_features_to) {
+  const char *features[] = {
+      "MFCC [Window(length=512), RDFT, SpectralEnergy,"
+      "FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]",
+      "Energy [Window(length=512), Energy]"
+  };
+  auto config = setup_features_extraction(features, 2, 48000, 16000);
+  ASSERT_NE(nullptr, config);
+  auto buffer = new int16_t[48000];
+  for (int i = 0; i < 48000; i++) {
+    buffer[i] = sinf(i / 4.0f) * INT16_MAX;
+  }
+  char **sizeNames = nullptr;
+  size_t *sizes = nullptr;
+  int count = 0;
+  query_feature_output_sizes(config, &sizeNames, &sizes, &count);
+  ASSERT_EQ(2, count);
+  int energy = strcmp(sizeNames[0], "Energy")? 1 : 0;
+  std::vector<char> selected(sizes[energy]);
+  void *selectedPtr = selected.data();
+  const char *selectedName = "Energy";
+  ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+            extract_selected_sound_features_to(config, buffer, &selectedName,
+                                               1, &selectedPtr));
+  std::vector<std::vector<char>> outputs(count);
+  std::vector<void*> outputPtrs(count);
+  for (int i = 0; i < count; i++) {
+    outputs[i].resize(sizes[i]);
+    outputPtrs[i] = outputs[i].data();
+  }
+  ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+            extract_sound_features_to(config, buffer, outputPtrs.data()));
+  ASSERT_EQ(0, memcmp(selected.data(), outputs[energy].data(),
+                      selected.size()));
+  const char *unknownName = "Unknown";
+  ASSERT_EQ(FEATURE_EXTRACTION_RESULT_ERROR,
+            extract_selected_sound_features_to(config, buffer, &unknownName,
+                                               1, &selectedPtr));
+  destroy_feature_output_sizes(sizeNames, sizes, count);
+  destroy_features_configuration(config);
+  delete[] buffer;
+}
+
+TEST(API, extract_sound_features_in_context) {
+  const char *feature = "MFCC [Window(length=512), RDFT, SpectralEnergy,"
+      "FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]";
+  auto config = setup_features_extraction(&feature, 1, 48000, 16000);
+  ASSERT_NE(nullptr, config);
+  const int threads_count = 4;
+  std::vector<std::vector<int16_t>> buffers(threads_count);
+  for (int t = 0; t < threads_count; t++) {
+    buffers[t].resize(48000);
+    for (int i = 0; i < 48000; i++) {
+      buffers[t][i] = sinf(i / (4.0f + t)) * INT16_MAX;
+    }
+  }
+  char **featureNames = nullptr;
+  size_t *sizes = nullptr;
+  int count = 0;
+  query_feature_output_sizes(config, &featureNames, &sizes, &count);
+  ASSERT_EQ(1, count);
+  // Calculate the reference results sequentially
+  std::vector<std::vector<char>> expected(threads_count);
+  for (int t = 0; t < threads_count; t++) {
+    expected[t].resize(sizes[0]);
+    void *output = expected[t].data();
+    ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+              extract_sound_features_to(config, buffers[t].data(), &output));
+  }
+  std::vector<std::vector<char>> actual(threads_count);
+  std::vector<ExtractionContext*> contexts(threads_count);
+  for (int t = 0; t < threads_count; t++) {
+    actual[t].resize(sizes[0]);
+    contexts[t] = create_extraction_context(config);
+    ASSERT_NE(nullptr, contexts[t]);
+  }
+  std::vector<std::thread> threads;
+  std::vector<FeatureExtractionResult> statuses(
+      threads_count, FEATURE_EXTRACTION_RESULT_ERROR);
+  for (int t = 0; t < threads_count; t++) {
+    threads.emplace_back([&, t]() {
+      void *output = actual[t].data();
+      for (int i = 0; i < 10; i++) {
+        statuses[t] = extract_sound_features_in_context(
+            config, contexts[t], buffers[t].data(), &output);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < threads_count; t++) {
+    ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK, statuses[t]);
+    ASSERT_EQ(0, memcmp(expected[t].data(), actual[t].data(), sizes[0]));
+    destroy_extraction_context(contexts[t]);
+  }
+  destroy_feature_output_sizes(featureNames, sizes, count);
+  destroy_features_configuration(config);
+}
+
+TEST(API, extract_sound_features_batch) {
+  const char *features[] = {
+      "MFCC [Window(length=512), RDFT, SpectralEnergy,"
+      "FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]",
+      "Energy [Window(length=512), Energy]"
+  };
+  const size_t bucket = 8000;
+  auto batch = setup_features_batch(features, 2, bucket, 16000, 3);
+  ASSERT_NE(nullptr, batch);
+  const int clips_count = 7;
+  std::vector<std::vector<int16_t>> clips(clips_count);
+  std::vector<const int16_t*> clipPtrs(clips_count);
+  std::vector<size_t> clipSizes(clips_count);
+  for (int c = 0; c < clips_count; c++) {
+    clipSizes[c] = 8000 + 3000 * c;
+    clips[c].resize(clipSizes[c]);
+    for (size_t i = 0; i < clipSizes[c]; i++) {
+      clips[c][i] = sinf(i / (4.0f + c)) * INT16_MAX;
+    }
+    clipPtrs[c] = clips[c].data();
+  }
+  char **featureNames = nullptr;
+  void ***results = nullptr;
+  int **lengths = nullptr;
+  ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+            extract_sound_features_batch(batch, clipPtrs.data(),
+                                         clipSizes.data(), clips_count,
+                                         &featureNames, &results, &lengths));
+  ASSERT_STREQ("Energy", featureNames[0]);
+  ASSERT_STREQ("MFCC", featureNames[1]);
+  // Compare with the separate extraction from each clip: the frames which
+  // come from the padding are trimmed
+  for (int c = 0; c < clips_count; c++) {
+    auto config = setup_features_extraction(features, 2, clipSizes[c], 16000);
+    ASSERT_NE(nullptr, config);
+    char **names = nullptr;
+    void **expected = nullptr;
+    int *expectedLengths = nullptr;
+    ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+              extract_sound_features(config, clips[c].data(), &names,
+                                     &expected, &expectedLengths));
+    for (int i = 0; i < 2; i++) {
+      int j = strcmp(names[i], featureNames[0])? 1 : 0;
+      ASSERT_EQ(expectedLengths[i], lengths[c][j]) << names[i] << " " << c;
+      ASSERT_EQ(0, memcmp(expected[i], results[c][j], lengths[c][j]))
+          << names[i] << " " << c;
+    }
+    free_results(2, names, expected, expectedLengths);
+    destroy_features_configuration(config);
+  }
+  free_batch_results(2, clips_count, featureNames, results, lengths);
+  destroy_features_batch(batch);
+}
+
+TEST(API, extract_sound_features_batch_many_buckets) {
+  const char *feature = "Energy [Window(length=512), Energy]";
+  const size_t bucket = 512;
+  auto batch = setup_features_batch(&feature, 1, bucket, 16000, 3);
+  ASSERT_NE(nullptr, batch);
+  // More padded sizes than the buckets kept at once
+  const int clips_count = 40;
+  std::vector<std::vector<int16_t>> clips(clips_count);
+  std::vector<const int16_t*> clipPtrs(clips_count);
+  std::vector<size_t> clipSizes(clips_count);
+  for (int c = 0; c < clips_count; c++) {
+    clipSizes[c] = bucket * (c + 1);
+    clips[c].resize(clipSizes[c]);
+    for (size_t i = 0; i < clipSizes[c]; i++) {
+      clips[c][i] = sinf(i / (4.0f + c)) * INT16_MAX;
+    }
+    clipPtrs[c] = clips[c].data();
+  }
+  std::vector<std::vector<char>> first(clips_count);
+  for (int pass = 0; pass < 2; pass++) {
+    char **featureNames = nullptr;
+    void ***results = nullptr;
+    int **lengths = nullptr;
+    ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+              extract_sound_features_batch(batch, clipPtrs.data(),
+                                           clipSizes.data(), clips_count,
+                                           &featureNames, &results,
+                                           &lengths));
+    for (int c = 0; c < clips_count; c++) {
+      auto data = reinterpret_cast<const char*>(results[c][0]);
+      std::vector<char> result(data, data + lengths[c][0]);
+      if (pass == 0) {
+        first[c] = result;
+      } else {
+        // The evicted buckets are set up again
+        ASSERT_EQ(first[c], result) << c;
+      }
+    }
+    free_batch_results(1, clips_count, featureNames, results, lengths);
+  }
+  destroy_features_batch(batch);
+}
+
+TEST(API, setup_features_extraction_cached) {
+  const char *feature = "MFCC [Window(length=512), RDFT, SpectralEnergy,"
+      "FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]";
+  const char *same_feature = "MFCC [Window(length=512), RDFT,SpectralEnergy,"
+      " FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]";
+  char plans_dir[] = "/tmp/sfe_plans_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(plans_dir));
+  set_allocation_plans_directory(plans_dir);
+  clear_configurations_cache();
+  auto buffer = new int16_t[48000];
+  for (int i = 0; i < 48000; i++) {
+    buffer[i] = sinf(i / 4.0f) * INT16_MAX;
+  }
+  std::vector<FeaturesConfiguration*> configs;
+  configs.push_back(setup_features_extraction_cached(&feature, 1, 48000,
+                                                     16000));
+  configs.push_back(setup_features_extraction_cached(&same_feature, 1, 48000,
+                                                     16000));
+  configs.push_back(clone_features_configuration(configs[0]));
+  // The allocation plan is loaded from plans_dir this time
+  clear_configurations_cache();
+  configs.push_back(setup_features_extraction_cached(&feature, 1, 48000,
+                                                     16000));
+  set_allocation_plans_directory(nullptr);
+  std::vector<std::vector<char>> results(configs.size());
+  for (size_t i = 0; i < configs.size(); i++) {
+    ASSERT_NE(nullptr, configs[i]);
+    char **featureNames = nullptr;
+    size_t *sizes = nullptr;
+    int count = 0;
+    query_feature_output_sizes(configs[i], &featureNames, &sizes, &count);
+    ASSERT_EQ(1, count);
+    results[i].resize(sizes[0]);
+    void *output = results[i].data();
+    ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+              extract_sound_features_to(configs[i], buffer, &output));
+    destroy_feature_output_sizes(featureNames, sizes, count);
+  }
+  for (size_t i = 1; i < configs.size(); i++) {
+    ASSERT_EQ(results[0], results[i]);
+  }
+  for (auto config : configs) {
+    destroy_features_configuration(config);
+  }
+  set_configurations_cache_capacity(0);
+  ASSERT_EQ(0U, get_configurations_cache_capacity());
+  set_configurations_cache_capacity(16);
+  delete[] buffer;
+}
+
+TEST(API, setup_features_extraction_cached_lists) {
+  // The configurations differ only in the spacing of the bands list
+  const char *features[] = {
+      "Bands [Window(length=512), Fork(factor=4), RDFT, "
+          "FrequencyBands(bands=1000 3000 6000)]",
+      "Bands [Window(length=512), Fork(factor=4), RDFT, "
+          "FrequencyBands(bands=100 03000 6000)]"
+  };
+  clear_configurations_cache();
+  std::vector<int16_t> buffer(48000);
+  for (int i = 0; i < 48000; i++) {
+    buffer[i] = sinf(i / 4.0f) * sinf(i / 300.0f) * INT16_MAX;
+  }
+  std::vector<std::vector<char>> results;
+  for (auto feature : features) {
+    auto config = setup_features_extraction_cached(&feature, 1, 48000,
+                                                   16000);
+    ASSERT_NE(nullptr, config);
+    char **featureNames = nullptr;
+    size_t *sizes = nullptr;
+    int count = 0;
+    query_feature_output_sizes(config, &featureNames, &sizes, &count);
+    ASSERT_EQ(1, count);
+    results.emplace_back(sizes[0]);
+    void *output = results.back().data();
+    ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+              extract_sound_features_to(config, buffer.data(), &output));
+    destroy_feature_output_sizes(featureNames, sizes, count);
+    destroy_features_configuration(config);
+  }
+  ASSERT_NE(results[0], results[1]);
+}
+
 FeaturesConfiguration* test_calculate_features() {
    const char *feature = "MFCC [Window(length=512), RDFT, SpectralEnergy,"
       "FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]";
@@ -182,5 +508,86 @@ TEST(API, report_extraction_time) {
   destroy_features_configuration(config);
 }
 
+TEST(API, feature_stream) {
+  const char *features[] = {
+      "MFCC [Window(length=512, step=256), RDFT, SpectralEnergy,"
+      "FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]",
+      "Energy [Lowpass(frequency=4000, length=8), Preemphasis,"
+      "Window(length=400, step=160), Energy]",
+      "MFCC_D2 [Window(length=512, step=256), RDFT, SpectralEnergy,"
+      "FilterBank(squared=true), Log, Square, DCT, Selector(length=16),"
+      "Delta(type=regression, rlength=7), Delta, STMSN(length=25)]"
+  };
+  const int kFeatures = 3;
+  const int size = 48000;
+  auto buffer = new int16_t[size];
+  for (int i = 0; i < size; i++) {
+    buffer[i] = sinf(i / 4.0f) * INT16_MAX / 2 + sinf(i / 50.f) * 1000;
+  }
+  auto config = setup_features_extraction(features, kFeatures, size, 16000);
+  ASSERT_NE(nullptr, config);
+  char **featureNames = nullptr;
+  char **results = nullptr;
+  int *lengths = nullptr;
+  ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK, extract_sound_features(
+      config, buffer, &featureNames, reinterpret_cast<void ***>(&results),
+      &lengths));
+
+  // The piece size is divisible by both steps
+  auto stream = open_feature_stream(features, kFeatures, 1280 * 3, 16000);
+  ASSERT_NE(nullptr, stream);
+  std::vector<std::vector<char>> streamed(kFeatures);
+  const int pushes[] = { 1000, 5000, 3840, 1, 7679, 12345 };
+  int pushed = 0;
+  for (int count : pushes) {
+    ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+              push_samples(stream, buffer + pushed, count));
+    pushed += count;
+  }
+  ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK,
+            push_samples(stream, buffer + pushed, size - pushed));
+  for (bool flush : { false, true }) {
+    char **streamNames = nullptr;
+    char **streamResults = nullptr;
+    int *streamLengths = nullptr;
+    ASSERT_EQ(FEATURE_EXTRACTION_RESULT_OK, pull_features(
+        stream, flush, &streamNames,
+        reinterpret_cast<void ***>(&streamResults), &streamLengths));
+    for (int i = 0; i < kFeatures; i++) {
+      int j = 0;
+      while (strcmp(streamNames[i], featureNames[j])) {
+        j++;
+      }
+      streamed[j].insert(streamed[j].end(), streamResults[i],
+                         streamResults[i] + streamLengths[i]);
+    }
+    free_results(kFeatures, streamNames,
+                 reinterpret_cast<void **>(streamResults), streamLengths);
+  }
+  ASSERT_NE(FEATURE_EXTRACTION_RESULT_OK, push_samples(stream, buffer, 1));
+  close_feature_stream(stream);
+
+  for (int i = 0; i < kFeatures; i++) {
+    ASSERT_EQ(lengths[i], static_cast<int>(streamed[i].size()))
+        << featureNames[i];
+    ASSERT_EQ(0, memcmp(results[i], streamed[i].data(), lengths[i]))
+        << featureNames[i];
+  }
+  free_results(kFeatures, featureNames, reinterpret_cast<void **>(results),
+               lengths);
+  destroy_features_configuration(config);
+  delete[] buffer;
+}
+
+TEST(API, feature_stream_unsupported) {
+  const char *feature = "ZeroCrossings [Window(length=512, step=256),"
+      "ZeroCrossings, Merge, Stats(interval=50)]";
+  // Merge and Stats need the whole stream
+  ASSERT_EQ(nullptr, open_feature_stream(&feature, 1, 1280, 16000));
+  feature = "MFCC [Window(length=512, step=256), RDFT]";
+  // The piece size is not divisible by the step
+  ASSERT_EQ(nullptr, open_feature_stream(&feature, 1, 1000, 16000));
+}
+
 #include "tests/google/src/gtest_main.cc"
 
@@ -0,0 +1,385 @@
+/*! @file benchmark.cc
+ *  @brief End-to-end benchmark of the realistic feature sets.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include <fftf/api.h>
+#include <sound_feature_extraction/api.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "src/features_parser.h"
+#include "src/transform_tree.h"
+#include "tests/benchmark_common.inc"
+
+using sound_feature_extraction::TransformTree;
+using sound_feature_extraction::formats::ArrayFormat16;
+namespace features = sound_feature_extraction::features;
+
+namespace {
+
+/// @brief The feature sets which are benchmarked. They repeat
+/// the configurations of tests/all_features.cc, tests/mfcc.cc, tests/crp.cc
+/// and tests/tempo.cc in the syntax of setup_features_extraction().
+struct FeatureSet {
+  const char* Name;
+  std::vector<std::string> Features;
+};
+
+const std::vector<FeatureSet> kFeatureSets = {
+  { "mfcc", {
+      "MFCC [Window(length=512), RDFT, SpectralEnergy, "
+          "FilterBank(squared=true), Log, Square, DCT, Selector(length=16)]"
+  } },
+  { "crp", {
+      "CRP [Window(length=4096,step=2048), RDFT, SpectralEnergy, "
+          "FilterBank(type=midi,number=108,frequency_min=7.946364,"
+          "frequency_max=8137.0754,squared=true), "
+          "Log(add1=true,scale=1000), DCT, Selector(select=70,from=right), "
+          "IDCT, Reorder(algorithm=chroma), "
+          "Stats(types=average,interval=9)]"
+  } },
+  { "tempo", {
+      "Tempo [Window(type=rectangular,length=512,step=205), "
+          "Window(type=hamming), Fork(factor=6), RDFT, "
+          "FrequencyBands(bands=200 400 800 1600 3200), IRDFT, "
+          "IWindow(length=512,count=6,interleaved=true), Rectify, "
+          "Convolve(window=half-hanning-right,length=12800), "
+          "Diff(rectify=true), Beat(bands=6)]"
+  } },
+  { "all", {
+      "Energy [Window(type=rectangular), Window, Energy]",
+      "Centroid [Window(type=rectangular), Window, RDFT, ComplexMagnitude, "
+          "Centroid]",
+      "Rolloff [Window(type=rectangular), Window, RDFT, ComplexMagnitude, "
+          "Rolloff]",
+      "Flux [Window(type=rectangular), Window, RDFT, ComplexMagnitude, Flux]",
+      "ZeroCrossings [Window(type=rectangular,length=512,step=205), "
+          "ZeroCrossings, Merge, Stats(interval=50)]",
+      "WPP [Preemphasis(value=0.2), Window(type=rectangular), DWPT, "
+          "SubbandEnergy, Log, DWPT(order=4, tree=1 2 3 3), "
+          "Selector(length=16, threads_number=1), STMSN(length=25)]",
+      "WPP_D1 [Preemphasis(value=0.2), Window(type=rectangular), DWPT, "
+          "SubbandEnergy, Log, DWPT(order=4, tree=1 2 3 3), "
+          "Selector(length=16, threads_number=1), Delta, STMSN(length=25)]",
+      "WPP_D2 [Preemphasis(value=0.2), Window(type=rectangular), DWPT, "
+          "SubbandEnergy, Log, DWPT(order=4, tree=1 2 3 3), "
+          "Selector(length=16, threads_number=1), Delta, Delta, "
+          "STMSN(length=25)]",
+      "SFM [Window(type=rectangular), Window, RDFT, ComplexMagnitude, "
+          "Mean(types=arithmetic geometric), SFM]",
+      "DominantFrequency [Window(type=rectangular), Window, RDFT, "
+          "ComplexMagnitude, Peaks(number=1)]",
+      "SBC [Preemphasis(value=0.2), Window(type=rectangular), DWPT, "
+          "SubbandEnergy, Log, ZeroPadding, DCT, "
+          "Selector(length=16, threads_number=1), STMSN(length=25)]",
+      "SBC_D1 [Preemphasis(value=0.2), Window(type=rectangular), DWPT, "
+          "SubbandEnergy, Log, ZeroPadding, DCT, "
+          "Selector(length=16, threads_number=1), Delta, STMSN(length=25)]",
+      "SBC_D2 [Preemphasis(value=0.2), Window(type=rectangular), DWPT, "
+          "SubbandEnergy, Log, ZeroPadding, DCT, "
+          "Selector(length=16, threads_number=1), Delta, Delta, "
+          "STMSN(length=25)]",
+      "MFCC [Preemphasis(value=0.2), Window(type=rectangular), Window, RDFT, "
+          "SpectralEnergy, FilterBank(squared=true), Log, Square, DCT, "
+          "Selector(length=16, threads_number=1), STMSN(length=25)]",
+      "MFCC_D1 [Preemphasis(value=0.2), Window(type=rectangular), Window, "
+          "RDFT, SpectralEnergy, FilterBank(squared=true), Log, Square, DCT, "
+          "Selector(length=16, threads_number=1), Delta, STMSN(length=25)]",
+      "MFCC_D2 [Preemphasis(value=0.2), Window(type=rectangular), Window, "
+          "RDFT, SpectralEnergy, FilterBank(squared=true), Log, Square, DCT, "
+          "Selector(length=16, threads_number=1), Delta, Delta, "
+          "STMSN(length=25)]",
+      "F0_HPS [Window(type=rectangular), Window, RDFT, ComplexMagnitude, "
+          "SHC, Peaks]",
+      "CRP [Window(length=4096,step=2048), RDFT, SpectralEnergy, "
+          "FilterBank(type=midi,number=108,frequency_min=7.946364,"
+          "frequency_max=8137.0754,squared=true), "
+          "Log(add1=true,scale=1000), DCT, Selector(select=70,from=right), "
+          "IDCT, Reorder(algorithm=chroma), "
+          "Stats(types=average,interval=9)]"
+  } }
+};
+
+struct Options {
+  Options()
+      : Lengths({ 1, 5, 20 }), SamplingRates({ 22050, 32000, 44100 }),
+        Threads({ 1, 2, 4 }), OmpThreads({ 1, 2, 4 }), Iterations(10),
+        Seed(1) {
+    for (auto& set : kFeatureSets) {
+      Sets.push_back(set.Name);
+    }
+  }
+
+  std::vector<std::string> Sets;
+  /// @brief The lengths of the signals in seconds.
+  std::vector<int> Lengths;
+  std::vector<int> SamplingRates;
+  /// @brief The values of TransformTree::branch_threads_number().
+  std::vector<int> Threads;
+  /// @brief The values of set_omp_transforms_max_threads_num(), that is,
+  /// the number of OpenMP threads inside each transform.
+  std::vector<int> OmpThreads;
+  int Iterations;
+  unsigned Seed;
+  /// @brief The name of this build to distinguish the results.
+  std::string Label;
+  /// @brief Where to write the JSON results. If it is empty, they are
+  /// written to stdout.
+  std::string Output;
+};
+
+void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [--sets=mfcc,crp,tempo,all] [--lengths=1,5,20] "
+          "[--rates=22050,32000,44100] [--threads=1,2,4] "
+          "[--omp-threads=1,2,4] "
+          "[--iterations=10] [--seed=1] [--label=<build name>] "
+          "[--output=<file.json>]\n",
+          program);
+}
+
+bool ParseOptions(int argc, char* argv[], Options* options) {
+  return ParseOptions(argc, argv, [options](const std::string& name,
+                                            const std::string& value) {
+    if (name == "sets") {
+      options->Sets = SplitList(value);
+    } else if (name == "lengths") {
+      options->Lengths = SplitIntList(value);
+    } else if (name == "rates") {
+      options->SamplingRates = SplitIntList(value);
+    } else if (name == "threads") {
+      options->Threads = SplitIntList(value);
+    } else if (name == "omp-threads") {
+      options->OmpThreads = SplitIntList(value);
+    } else if (name == "iterations") {
+      options->Iterations = std::stoi(value);
+    } else if (name == "seed") {
+      options->Seed = std::stoul(value);
+    } else if (name == "label") {
+      options->Label = value;
+    } else if (name == "output") {
+      options->Output = value;
+    } else {
+      return false;
+    }
+    return true;
+  }) && options->Iterations > 0;
+}
+
+/// @brief Generates the reproducible music-like signal: the harmonic notes
+/// with the percussive onsets at 120 BPM over the weak white noise. Only
+/// std::minstd_rand's raw output is used, since it is fully specified by
+/// the standard, unlike the random distributions.
+std::vector<int16_t> GenerateSignal(size_t size, int samplingRate,
+                                    unsigned seed) {
+  std::minstd_rand rng(seed);
+  auto uniform = [&rng]() {
+    return (rng() - std::minstd_rand::min() + .0) /
+        (std::minstd_rand::max() - std::minstd_rand::min());
+  };
+  std::vector<int16_t> signal(size);
+  const size_t note_length = samplingRate / 2;
+  double frequency = 0;
+  double phase = 0;
+  for (size_t i = 0; i < size; i++) {
+    size_t position = i % note_length;
+    if (position == 0) {
+      frequency = 110 * std::pow(2., static_cast<int>(uniform() * 36) / 12.);
+    }
+    phase += 2 * M_PI * frequency / samplingRate;
+    double t = (position + .0) / samplingRate;
+    double tone = 0;
+    for (int h = 1; h <= 4; h++) {
+      tone += std::sin(phase * h) / h;
+    }
+    double click = position < 64? (uniform() * 2 - 1) * (64 - position) / 64
+                                : 0;
+    double value = 0.3 * std::exp(-4 * t) * tone + 0.3 * click +
+        0.02 * (uniform() * 2 - 1);
+    signal[i] = static_cast<int16_t>(
+        std::max(-1., std::min(1., value)) * 32767);
+  }
+  return signal;
+}
+
+/// @brief FNV-1a hash of the signal, which shows whether the corpora of two
+/// runs are identical.
+uint64_t Checksum(const std::vector<int16_t>& signal) {
+  uint64_t hash = 14695981039346656037ULL;
+  auto bytes = reinterpret_cast<const uint8_t*>(signal.data());
+  for (size_t i = 0; i < signal.size() * sizeof(int16_t); i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+double Milliseconds(const std::chrono::high_resolution_clock::duration& d) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() /
+      1000000.;
+}
+
+/// @brief Returns the percentile of the sorted values using the nearest
+/// rank method.
+double Percentile(const std::vector<double>& sorted, double p) {
+  size_t rank = static_cast<size_t>(std::ceil(p / 100 * sorted.size()));
+  return sorted[std::max(rank, size_t(1)) - 1];
+}
+
+/// @brief Runs one scenario and returns its JSON object.
+std::string Run(const FeatureSet& set, int length, int samplingRate,
+                int threads, int ompThreads,
+                const std::vector<int16_t>& signal,
+                const Options& options) {
+  std::ostringstream json;
+  json << "{\"set\": " << JsonString(set.Name)
+       << ", \"features\": " << set.Features.size()
+       << ", \"length\": " << length
+       << ", \"sampling_rate\": " << samplingRate
+       << ", \"samples\": " << signal.size()
+       << ", \"threads\": " << threads
+       << ", \"omp_threads\": " << ompThreads;
+  char checksum[24];
+  snprintf(checksum, sizeof(checksum), "%016llx",
+           static_cast<unsigned long long>(Checksum(signal)));  // NOLINT(*)
+  json << ", \"corpus_checksum\": \"" << checksum << "\"";
+  try {
+    // The transforms take their threads number when they are created
+    set_omp_transforms_max_threads_num(ompThreads);
+    fftf_set_openmp_num_threads(ompThreads);
+    auto setup_start = std::chrono::high_resolution_clock::now();
+    TransformTree tree(std::make_shared<ArrayFormat16>(signal.size(),
+                                                       samplingRate));
+    tree.set_branch_threads_number(threads);
+    for (auto& feature : features::Parse(set.Features)) {
+      tree.AddFeature(feature.first, feature.second);
+    }
+    tree.PrepareForExecution();
+    auto setup_time = Milliseconds(
+        std::chrono::high_resolution_clock::now() - setup_start);
+    // The first execution warms up the caches and checks the results
+    for (auto& result : tree.Execute(signal.data())) {
+      result.second->Validate();
+    }
+    std::vector<double> latencies;
+    latencies.reserve(options.Iterations);
+    for (int i = 0; i < options.Iterations; i++) {
+      auto start = std::chrono::high_resolution_clock::now();
+      tree.Execute(signal.data());
+      latencies.push_back(Milliseconds(
+          std::chrono::high_resolution_clock::now() - start));
+    }
+    double total = 0;
+    for (double latency : latencies) {
+      total += latency;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    json << ", \"setup_ms\": " << setup_time
+         << ", \"arena_bytes\": " << tree.NeededMemory()
+         << ", \"throughput\": "
+         << (signal.size() + .0) / samplingRate * latencies.size() /
+            (total / 1000)
+         << ", \"latency_ms\": {\"min\": " << latencies.front()
+         << ", \"mean\": " << total / latencies.size()
+         << ", \"p50\": " << Percentile(latencies, 50)
+         << ", \"p90\": " << Percentile(latencies, 90)
+         << ", \"p99\": " << Percentile(latencies, 99)
+         << ", \"max\": " << latencies.back() << "}}";
+  }
+  catch(const std::exception& e) {
+    json << ", \"error\": " << JsonString(e.what()) << "}";
+  }
+  return json.str();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  fftf_available_backends(nullptr, nullptr);
+  std::vector<std::string> results;
+  for (auto& name : options.Sets) {
+    auto set = std::find_if(kFeatureSets.begin(), kFeatureSets.end(),
+                            [&name](const FeatureSet& fs) {
+      return name == fs.Name;
+    });
+    if (set == kFeatureSets.end()) {
+      fprintf(stderr, "Unknown feature set \"%s\"\n", name.c_str());
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    for (int rate : options.SamplingRates) {
+      for (int length : options.Lengths) {
+        auto signal = GenerateSignal(static_cast<size_t>(length) * rate, rate,
+                                     options.Seed);
+        for (int threads : options.Threads) {
+          for (int omp_threads : options.OmpThreads) {
+            fprintf(stderr, "%s, %d Hz, %d s, %d threads, %d OpenMP "
+                    "threads...\n", set->Name, rate, length, threads,
+                    omp_threads);
+            results.push_back(Run(*set, length, rate, threads, omp_threads,
+                                  signal, options));
+          }
+        }
+      }
+    }
+  }
+  std::ostringstream json;
+  json << "{\"label\": " << JsonString(options.Label)
+       << ", \"simd\": " << (get_use_simd()? "true" : "false")
+       << ", \"fftf_backend\": " << fftf_current_backend()
+       << ", \"iterations\": " << options.Iterations
+       << ", \"seed\": " << options.Seed
+       << ", \"results\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    json << "  " << results[i] << (i < results.size() - 1? ",\n" : "\n");
+  }
+  json << "]}\n";
+  if (options.Output.empty()) {
+    fputs(json.str().c_str(), stdout);
+  } else {
+    std::ofstream file(options.Output);
+    file << json.str();
+    if (!file) {
+      fprintf(stderr, "Failed to write %s\n", options.Output.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+/*! @file cpu_cache.cc
+ *  @brief Tests for CpuCacheTopology.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/cpu_cache.h"
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <fstream>
+
+using sound_feature_extraction::CpuCacheTopology;
+
+class CpuCacheTopologyTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    // 2 sockets * 4 cores * 2 hyperthreads
+    root_ = "/tmp/sfe_test_sysfs_cpu";
+    mkdir(root_.c_str(), 0755);
+    Write("online", "0-15");
+    mkdir((root_ + "/cpu0").c_str(), 0755);
+    mkdir((root_ + "/cpu0/cache").c_str(), 0755);
+    AddCache(0, "Data", 1, "32K", "0,8");
+    AddCache(1, "Instruction", 1, "32K", "0,8");
+    AddCache(2, "Unified", 2, "256K", "0,8");
+    AddCache(3, "Unified", 3, "20480K", "0-3,8-11");
+  }
+
+  void Write(const std::string& file, const std::string& contents) {
+    std::ofstream(root_ + "/" + file) << contents << std::endl;
+  }
+
+  void AddCache(int index, const std::string& type, int level,
+                const std::string& size, const std::string& shared) {
+    auto dir = "cpu0/cache/index" + std::to_string(index);
+    mkdir((root_ + "/" + dir).c_str(), 0755);
+    Write(dir + "/type", type);
+    Write(dir + "/level", std::to_string(level));
+    Write(dir + "/size", size);
+    Write(dir + "/shared_cpu_list", shared);
+  }
+
+  std::string root_;
+};
+
+TEST_F(CpuCacheTopologyTest, Sysfs) {
+  CpuCacheTopology topology(root_);
+  EXPECT_EQ(16, topology.cpus());
+  ASSERT_EQ(3U, topology.levels().size());
+  EXPECT_EQ(1, topology.levels()[0].Level);
+  EXPECT_EQ(32U * 1024, topology.levels()[0].Size);
+  EXPECT_EQ(2, topology.levels()[0].SharedBy);
+  EXPECT_EQ(256U * 1024, topology.Find(2)->Size);
+  EXPECT_EQ(20U * 1024 * 1024, topology.Find(3)->Size);
+  EXPECT_EQ(8, topology.Find(3)->SharedBy);
+  EXPECT_EQ(nullptr, topology.Find(4));
+}
+
+TEST_F(CpuCacheTopologyTest, ThreadBudget) {
+  CpuCacheTopology topology(root_);
+  // One thread owns everything
+  EXPECT_EQ(256U * 1024, topology.ThreadBudget(2, 1));
+  EXPECT_EQ(20U * 1024 * 1024, topology.ThreadBudget(3, 1));
+  // A thread per core: L2 is private, L3 is shared by a socket
+  EXPECT_EQ(256U * 1024, topology.ThreadBudget(2, 8));
+  EXPECT_EQ(5U * 1024 * 1024, topology.ThreadBudget(3, 8));
+  // A thread per hyperthread
+  EXPECT_EQ(128U * 1024, topology.ThreadBudget(2, 16));
+  EXPECT_EQ(20U * 1024 * 1024 / 8, topology.ThreadBudget(3, 16));
+  EXPECT_EQ(0U, topology.ThreadBudget(4, 1));
+}
+
+TEST(CpuCacheTopology, Fallback) {
+  CpuCacheTopology topology("/nonexistent");
+  ASSERT_GT(topology.levels().size(), 0U);
+  EXPECT_GT(topology.cpus(), 0);
+  for (auto& level : topology.levels()) {
+    EXPECT_GT(level.Size, 0U);
+  }
+  auto& host = CpuCacheTopology::Instance();
+  EXPECT_GT(host.levels().size(), 0U);
+}
+
+#include "tests/google/src/gtest_main.cc"
@@ -0,0 +1,75 @@
+/*! @file latency_histogram.cc
+ *  @brief Tests for LatencyHistogram.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/latency_histogram.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using sound_feature_extraction::LatencyHistogram;
+
+TEST(LatencyHistogram, Buckets) {
+  std::vector<uint64_t> values { 0, 1, 15, 16, 17, 1000, 123456789,
+                                LatencyHistogram::kMaxValue };
+  for (auto value : values) {
+    int index = LatencyHistogram::BucketIndex(value);
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, LatencyHistogram::kBucketsCount);
+    ASSERT_LE(value, LatencyHistogram::BucketUpperBound(index));
+    if (index > 0) {
+      ASSERT_GT(value, LatencyHistogram::BucketUpperBound(index - 1));
+    }
+  }
+  ASSERT_EQ(LatencyHistogram::kBucketsCount - 1,
+            LatencyHistogram::BucketIndex(LatencyHistogram::kMaxValue));
+}
+
+TEST(LatencyHistogram, Percentiles) {
+  LatencyHistogram histogram;
+  ASSERT_EQ(0U, histogram.Percentile(0.5));
+  for (uint64_t i = 1; i <= 1000; i++) {
+    histogram.Record(i * 1000);
+  }
+  ASSERT_EQ(1000U, histogram.count());
+  ASSERT_EQ(500500000U, histogram.total());
+  ASSERT_EQ(1000U, histogram.min());
+  ASSERT_EQ(1000000U, histogram.max());
+  // The relative error is below 1 / kSubBucketsCount
+  for (double q : { 0.5, 0.95, 0.99 }) {
+    double expected = q * 1000000;
+    double actual = histogram.Percentile(q);
+    ASSERT_GE(actual, expected);
+    ASSERT_LE(actual, expected * (1 + 1. / LatencyHistogram::kSubBucketsCount));
+  }
+  ASSERT_EQ(histogram.max(), histogram.Percentile(1));
+  histogram.Reset();
+  ASSERT_EQ(0U, histogram.count());
+}
+
+#include "tests/google/src/gtest_main.cc"
@@ -29,12 +29,14 @@
  */
 
 #include <gtest/gtest.h>
+#include <sound_feature_extraction/api.h>
 #include "src/transform_tree.h"
 #include "src/transform_registry.h"
 #include "src/formats/array_format.h"
 #include "tests/speech_sample.inc"
 
 using sound_feature_extraction::TransformTree;
+using sound_feature_extraction::Buffers;
 using sound_feature_extraction::BuffersBase;
 
 TEST(Features, MFCC) {
@@ -77,4 +79,73 @@ TEST(Features, MFCCTrivial) {
   res["MFCC"]->Validate();
 }
 
+TEST(Features, MFCCFusion) {
+  std::vector<std::pair<std::string, std::string>> mfcc {
+      { "Window", "length=512" }, { "RDFT", "" }, { "SpectralEnergy", "" },
+      { "FilterBank", "squared=true" }, { "Log", "" }, { "Square", "" },
+      { "DCT", "" }, { "Selector", "length=16" } };
+  TransformTree fused( { 48000, 16000 } );  // NOLINT(*)
+  fused.AddFeature("MFCC", mfcc);
+  TransformTree plain( { 48000, 16000 } );  // NOLINT(*)
+  plain.set_fusion(false);
+  plain.AddFeature("MFCC", mfcc);
+  fused.PrepareForExecution();
+  plain.PrepareForExecution();
+  std::vector<int16_t> buffers(48000);
+  memcpy(buffers.data(), data, sizeof(data));
+  auto fused_res = fused.Execute(buffers.data());
+  auto plain_res = plain.Execute(buffers.data());
+  const Buffers& fused_buffers = *fused_res["MFCC"];
+  const Buffers& plain_buffers = *plain_res["MFCC"];
+  ASSERT_EQ(plain_buffers.Count(), fused_buffers.Count());
+  ASSERT_EQ(plain_buffers.SizeInBytes(), fused_buffers.SizeInBytes());
+  ASSERT_EQ(0, memcmp(plain_buffers.Data(), fused_buffers.Data(),
+                      plain_buffers.SizeInBytes()));
+  // Log and Square are executed by the same node
+  auto report = fused.ExecutionTimeReport();
+  ASSERT_NE(report.end(), report.find("Log + Square"));
+}
+
+TEST(Features, MFCCSlicedSubtree) {
+  // Window is read by three branches, which are sliced together
+  std::vector<std::pair<std::string, std::string>> mfcc {
+      { "Window", "length=512" }, { "RDFT", "" }, { "SpectralEnergy", "" },
+      { "FilterBank", "squared=true" }, { "Log", "" }, { "Square", "" },
+      { "DCT", "" }, { "Selector", "length=16" } };
+  std::vector<std::pair<std::string, std::string>> energy {
+      { "Window", "length=512" }, { "Energy", "" } };
+  std::vector<std::pair<std::string, std::string>> zc {
+      { "Window", "length=512" }, { "ZeroCrossings", "" } };
+  set_cpu_cache_size(32 * 1024);
+  TransformTree sliced( { 48000, 16000 } );  // NOLINT(*)
+  TransformTree plain( { 48000, 16000 } );  // NOLINT(*)
+  plain.set_cache_optimization(false);
+  for (auto tree : { &sliced, &plain }) {
+    tree->AddFeature("MFCC", mfcc);
+    tree->AddFeature("Energy", energy);
+    tree->AddFeature("ZeroCrossings", zc);
+    tree->PrepareForExecution();
+  }
+  set_cpu_cache_size(0);
+  std::vector<int16_t> buffers(48000);
+  memcpy(buffers.data(), data, sizeof(data));
+  auto sliced_res = sliced.Execute(buffers.data());
+  auto plain_res = plain.Execute(buffers.data());
+  ASSERT_EQ(3U, sliced_res.size());
+  for (auto& feature : plain_res) {
+    const Buffers& sliced_buffers = *sliced_res[feature.first];
+    const Buffers& plain_buffers = *feature.second;
+    ASSERT_EQ(plain_buffers.Count(), sliced_buffers.Count());
+    ASSERT_EQ(0, memcmp(plain_buffers.Data(), sliced_buffers.Data(),
+                        plain_buffers.SizeInBytes())) << feature.first;
+  }
+  int cycles = 0;
+  for (auto& item : sliced.ExecutionTimeReport()) {
+    if (item.first.find("Cycle") == 0) {
+      cycles++;
+    }
+  }
+  ASSERT_EQ(1, cycles);
+}
+
 #include "tests/google/src/gtest_main.cc"
@@ -0,0 +1,115 @@
+/*! @file thread_workspace.cc
+ *  @brief Tests for ThreadWorkspace.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include "src/thread_workspace.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using sound_feature_extraction::ThreadWorkspace;
+
+TEST(ThreadWorkspace, Get) {
+  ThreadWorkspace<int> workspace;
+  std::atomic_int created(0);
+  workspace.Reset([&created]() { return created++; }, 4);
+  int& item = workspace.Get();
+  EXPECT_EQ(&item, &workspace.Get());
+  EXPECT_EQ(1, created);
+  workspace.Reset([&created]() { return created++; }, 4);
+  EXPECT_EQ(1, workspace.Get());
+  EXPECT_EQ(2, created);
+}
+
+TEST(ThreadWorkspace, Threads) {
+  const int kThreadsCount = 100;
+  ThreadWorkspace<std::vector<int>> workspace;
+  workspace.Reset([]() { return std::vector<int>(); }, 1);
+  std::vector<std::vector<int>*> items(kThreadsCount);
+  std::vector<std::thread> threads;
+  std::atomic_int started(0);
+  for (int i = 0; i < kThreadsCount; i++) {
+    threads.emplace_back([&, i]() {
+      items[i] = &workspace.Get();
+      items[i]->push_back(i);
+      // Keep all the threads alive, so that their slots are not reused
+      started++;
+      while (started < kThreadsCount) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::set<std::vector<int>*> unique(items.begin(), items.end());
+  EXPECT_EQ(static_cast<size_t>(kThreadsCount), unique.size());
+  for (int i = 0; i < kThreadsCount; i++) {
+    ASSERT_EQ(1U, items[i]->size());
+    EXPECT_EQ(i, (*items[i])[0]);
+  }
+}
+
+TEST(ThreadWorkspace, Overflow) {
+  // More simultaneous threads than the chunks hold
+  const int kThreadsCount = 64 * 64 + 8;
+  ThreadWorkspace<int> workspace;
+  workspace.Reset([]() { return 0; }, 1);
+  std::vector<int*> items(kThreadsCount);
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable all_started;
+  int started = 0;
+  for (int i = 0; i < kThreadsCount; i++) {
+    threads.emplace_back([&, i]() {
+      items[i] = &workspace.Get();
+      *items[i] = i;
+      std::unique_lock<std::mutex> lock(mutex);
+      if (++started == kThreadsCount) {
+        all_started.notify_all();
+      } else {
+        all_started.wait(lock, [&]() { return started == kThreadsCount; });
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::set<int*> unique(items.begin(), items.end());
+  EXPECT_EQ(static_cast<size_t>(kThreadsCount), unique.size());
+  for (int i = 0; i < kThreadsCount; i++) {
+    ASSERT_EQ(i, *items[i]);
+  }
+}
+
+#include "tests/google/src/gtest_main.cc"
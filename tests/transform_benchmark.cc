@@ -0,0 +1,380 @@
+/*! @file transform_benchmark.cc
+ *  @brief Microbenchmark of every registered transform.
+ *  @author Markovtsev Vadim <v.markovtsev@samsung.com>
+ *  @version 1.0
+ *
+ *  @section Notes
+ *  This code partially conforms to <a href="http://google-styleguide.googlecode.com/svn/trunk/cppguide.xml">Google C++ Style Guide</a>.
+ *
+ *  @section Copyright
+ *  Copyright © 2013 Samsung R&D Institute Russia
+ *
+ *  @section License
+ *  Licensed to the Apache Software Foundation (ASF) under one
+ *  or more contributor license agreements.  See the NOTICE file
+ *  distributed with this work for additional information
+ *  regarding copyright ownership.  The ASF licenses this file
+ *  to you under the Apache License, Version 2.0 (the
+ *  "License"); you may not use this file except in compliance
+ *  with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an
+ *  "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *  KIND, either express or implied.  See the License for the
+ *  specific language governing permissions and limitations
+ *  under the License.
+ */
+
+#include <sound_feature_extraction/api.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "src/formats/array_format.h"
+#include "src/formats/single_format.h"
+#include "src/transform_registry.h"
+#include "tests/benchmark_common.inc"
+
+using sound_feature_extraction::BufferFormat;
+using sound_feature_extraction::Buffers;
+using sound_feature_extraction::Transform;
+using sound_feature_extraction::TransformFactory;
+namespace formats = sound_feature_extraction::formats;
+
+namespace {
+
+constexpr int kSamplingRate = 16000;
+/// @brief Beat is additionally benchmarked on the tempo envelope of a whole
+/// 30 seconds long track, which the sweep sizes are far from. Its comb
+/// filters' FFT is longer than 2^16 there, so libav is avoided as well.
+constexpr int kBeatTrackSize = 30 * kSamplingRate;
+
+/// @brief Creates the input buffers of some format and fills them with
+/// the representative values.
+struct InputFactory {
+  std::function<std::shared_ptr<BufferFormat>(size_t size)> CreateFormat;
+  std::function<void(size_t size, std::minstd_rand* rng, Buffers* buffers)>
+      Fill;
+};
+
+/// @brief The uniformly distributed value in [min, max), which is derived
+/// from the raw output of std::minstd_rand only to be reproducible.
+double Uniform(std::minstd_rand* rng, double min, double max) {
+  return min + (max - min) * ((*rng)() - std::minstd_rand::min()) /
+      (std::minstd_rand::max() - std::minstd_rand::min() + 1.);
+}
+
+template <class T>
+InputFactory ArrayInput(double min, double max) {
+  return {
+    [](size_t size) {
+      return std::make_shared<formats::ArrayFormat<T>>(size, kSamplingRate);
+    },
+    [min, max](size_t size, std::minstd_rand* rng, Buffers* buffers) {
+      for (size_t i = 0; i < buffers->Count(); i++) {
+        auto array = reinterpret_cast<T*>((*buffers)[i]);
+        for (size_t j = 0; j < size; j++) {
+          array[j] = Uniform(rng, min, max);
+        }
+      }
+    }
+  };
+}
+
+template <class T>
+InputFactory SingleInput(double min, double max) {
+  return {
+    [](size_t) {
+      return std::make_shared<formats::SingleFormat<T>>(kSamplingRate);
+    },
+    [min, max](size_t, std::minstd_rand* rng, Buffers* buffers) {
+      for (size_t i = 0; i < buffers->Count(); i++) {
+        *reinterpret_cast<T*>((*buffers)[i]) = Uniform(rng, min, max);
+      }
+    }
+  };
+}
+
+/// @brief The input formats which the benchmark is able to create, indexed
+/// by BufferFormat::Id(). The floating point values are positive, so that
+/// Log and the like do not get NaNs.
+std::map<std::string, InputFactory> InputFactories() {
+  std::vector<InputFactory> factories = {
+    ArrayInput<int16_t>(-8192, 8192), ArrayInput<int32_t>(-8192, 8192),
+    ArrayInput<float>(0.1, 1), SingleInput<int32_t>(1, 1000),
+    SingleInput<float>(0.1, 1)
+  };
+  std::map<std::string, InputFactory> res;
+  for (auto& factory : factories) {
+    res[factory.CreateFormat(1)->Id()] = factory;
+  }
+  return res;
+}
+
+struct Options {
+  Options()
+      : Sizes({ 256, 1024, 4096, 16384 }), Counts({ 1, 16, 256 }),
+        Threads({ 1, 2, 4 }), MinTime(0.05) {
+  }
+
+  /// @brief The transforms to benchmark. If it is empty, all the registered
+  /// transforms are benchmarked.
+  std::vector<std::string> Transforms;
+  /// @brief The number of elements in each array buffer.
+  std::vector<int> Sizes;
+  std::vector<int> Counts;
+  /// @brief The values of "threads_number" parameter of the OpenMP aware
+  /// transforms. The other transforms are run with 1 only.
+  std::vector<int> Threads;
+  /// @brief The minimal time of each measurement in seconds.
+  double MinTime;
+  std::string Label;
+  std::string Output;
+};
+
+void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [--transforms=RDFT,DCT,...] [--sizes=256,1024,4096,16384] "
+          "[--counts=1,16,256] [--threads=1,2,4] [--min-time=0.05] "
+          "[--label=<build name>] [--output=<file.json>]\n",
+          program);
+}
+
+bool ParseOptions(int argc, char* argv[], Options* options) {
+  return ParseOptions(argc, argv, [options](const std::string& name,
+                                            const std::string& value) {
+    if (name == "transforms") {
+      options->Transforms = SplitList(value);
+    } else if (name == "sizes") {
+      options->Sizes = SplitIntList(value);
+    } else if (name == "counts") {
+      options->Counts = SplitIntList(value);
+    } else if (name == "threads") {
+      options->Threads = SplitIntList(value);
+    } else if (name == "min-time") {
+      options->MinTime = std::stod(value);
+    } else if (name == "label") {
+      options->Label = value;
+    } else if (name == "output") {
+      options->Output = value;
+    } else {
+      return false;
+    }
+    return true;
+  }) && options->MinTime > 0;
+}
+
+/// @brief The point of the benchmarked sweep.
+struct Case {
+  std::string Transform;
+  std::string InputFormat;
+  int Size;
+  int Count;
+  int Threads;
+  bool Simd;
+};
+
+/// @brief Executes Do() until Options::MinTime elapses.
+/// @return The average time of one call in nanoseconds.
+double Measure(const Transform& transform, const Buffers& in, Buffers* out,
+               double minTime, int* iterations) {
+  transform.Do(in, out);
+  auto min_duration = std::chrono::duration_cast<
+      std::chrono::high_resolution_clock::duration>(
+          std::chrono::duration<double>(minTime));
+  int count = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  std::chrono::high_resolution_clock::duration elapsed;
+  do {
+    transform.Do(in, out);
+    count++;
+    elapsed = std::chrono::high_resolution_clock::now() - start;
+  } while (elapsed < min_duration || count < 3);
+  *iterations = count;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      elapsed).count() / (count + .0);
+}
+
+/// @brief Runs one case and returns its JSON object.
+/// @param nsPerCall Receives the average time of one call in nanoseconds,
+/// or 0 if the case failed.
+std::string Run(const Case& c,
+                const TransformFactory::TransformConstructor& ctor,
+                const InputFactory& input, double minTime, double* nsPerCall) {
+  std::ostringstream json;
+  json << "{\"transform\": " << JsonString(c.Transform)
+       << ", \"input_format\": " << JsonString(c.InputFormat)
+       << ", \"size\": " << c.Size
+       << ", \"count\": " << c.Count
+       << ", \"threads\": " << c.Threads
+       << ", \"simd\": " << (c.Simd? "true" : "false");
+  *nsPerCall = 0;
+  // Some transforms choose the implementation in Initialize()
+  set_use_simd(c.Simd);
+  try {
+    auto transform = ctor();
+    if (transform->SupportedParameters().count("threads_number") > 0) {
+      transform->SetParameters(
+          { { "threads_number", std::to_string(c.Threads) } });
+    }
+    auto format = input.CreateFormat(c.Size);
+    size_t out_count = transform->SetInputFormat(format, c.Count);
+    transform->Initialize();
+    Buffers in(format, c.Count);
+    std::minstd_rand rng(1);
+    input.Fill(c.Size, &rng, &in);
+    auto out = transform->CreateOutputBuffers(out_count);
+    int iterations;
+    *nsPerCall = Measure(*transform, in, out.get(), minTime, &iterations);
+    json << ", \"iterations\": " << iterations
+         << ", \"ns_per_call\": " << *nsPerCall
+         << ", \"ns_per_buffer\": " << *nsPerCall / c.Count << "}";
+  }
+  catch(const std::exception& e) {
+    json << ", \"error\": " << JsonString(e.what()) << "}";
+  }
+  return json.str();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  bool simd_available = get_use_simd();
+  auto inputs = InputFactories();
+  // Sort the transforms by name to make the results comparable with diff
+  std::map<std::string, std::map<std::string,
+                                 TransformFactory::TransformConstructor>>
+      transforms;
+  for (auto& tit : TransformFactory::Instance().Map()) {
+    if (options.Transforms.empty() ||
+        std::find(options.Transforms.begin(), options.Transforms.end(),
+                  tit.first) != options.Transforms.end()) {
+      transforms[tit.first].insert(tit.second.begin(), tit.second.end());
+    }
+  }
+  std::vector<std::string> results, skipped, regressions;
+  bool sweeps_one = std::find(options.Threads.begin(), options.Threads.end(),
+                              1) != options.Threads.end();
+  for (auto& tit : transforms) {
+    for (auto& fit : tit.second) {
+      auto input = inputs.find(fit.first);
+      if (input == inputs.end()) {
+        skipped.push_back("{\"transform\": " + JsonString(tit.first) +
+                          ", \"input_format\": " + JsonString(fit.first) +
+                          "}");
+        continue;
+      }
+      bool omp_aware =
+          fit.second()->SupportedParameters().count("threads_number") > 0;
+      fprintf(stderr, "%s (%s)...\n", tit.first.c_str(), fit.first.c_str());
+      for (int size : options.Sizes) {
+        for (int count : options.Counts) {
+          for (bool simd : { false, true }) {
+            if (simd && !simd_available) {
+              continue;
+            }
+            // The OpenMP overhead is judged against 1 thread, which is
+            // measured first even if it is not among the swept values
+            double single_threaded = 0;
+            if (omp_aware || sweeps_one) {
+              Case c { tit.first, fit.first, size, count, 1, simd };
+              auto json = Run(c, fit.second, input->second, options.MinTime,
+                              &single_threaded);
+              if (sweeps_one) {
+                results.push_back(json);
+              }
+            }
+            if (!omp_aware) {
+              continue;
+            }
+            for (int threads : options.Threads) {
+              if (threads == 1) {
+                continue;
+              }
+              Case c { tit.first, fit.first, size, count, threads, simd };
+              double ns;
+              results.push_back(Run(c, fit.second, input->second,
+                                    options.MinTime, &ns));
+              if (single_threaded > 0 && ns > single_threaded) {
+                // OpenMP overhead outweighs the parallelism at this size
+                std::ostringstream json;
+                json << "{\"transform\": " << JsonString(tit.first)
+                     << ", \"input_format\": " << JsonString(fit.first)
+                     << ", \"size\": " << size << ", \"count\": " << count
+                     << ", \"threads\": " << threads
+                     << ", \"simd\": " << (simd? "true" : "false")
+                     << ", \"slowdown\": " << ns / single_threaded << "}";
+                regressions.push_back(json.str());
+                fprintf(stderr, "  OpenMP with %d threads is %.2f times "
+                        "slower than 1 thread (size %d, count %d, %s)\n",
+                        threads, ns / single_threaded, size, count,
+                        simd? "SIMD" : "scalar");
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  auto beat = transforms.find("Beat");
+  if (beat != transforms.end()) {
+    auto float_input = ArrayInput<float>(0.1, 1);
+    auto ctor = beat->second.find(float_input.CreateFormat(1)->Id());
+    if (ctor != beat->second.end()) {
+      fprintf(stderr, "Beat on a whole track...\n");
+      for (bool simd : { false, true }) {
+        if (simd && !simd_available) {
+          continue;
+        }
+        for (int threads : options.Threads) {
+          Case c { beat->first, ctor->first, kBeatTrackSize, 1, threads,
+                   simd };
+          double ns;
+          results.push_back(Run(c, ctor->second, float_input,
+                                options.MinTime, &ns));
+        }
+      }
+    }
+  }
+  set_use_simd(simd_available);
+  auto join = [](const std::vector<std::string>& items) {
+    std::string res;
+    for (size_t i = 0; i < items.size(); i++) {
+      res += "  " + items[i] + (i < items.size() - 1? ",\n" : "\n");
+    }
+    return res;
+  };
+  std::ostringstream json;
+  json << "{\"label\": " << JsonString(options.Label)
+       << ", \"simd_available\": " << (simd_available? "true" : "false")
+       << ", \"sampling_rate\": " << kSamplingRate
+       << ", \"min_time\": " << options.MinTime
+       << ",\n\"results\": [\n" << join(results)
+       << "],\n\"omp_regressions\": [\n" << join(regressions)
+       << "],\n\"skipped\": [\n" << join(skipped) << "]}\n";
+  if (options.Output.empty()) {
+    fputs(json.str().c_str(), stdout);
+  } else {
+    std::ofstream file(options.Output);
+    file << json.str();
+    if (!file) {
+      fprintf(stderr, "Failed to write %s\n", options.Output.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -28,7 +28,13 @@
  *  under the License.
  */
 
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
 #include <gtest/gtest.h>
+#include "src/safe_omp.h"
 #include "src/transform_base.h"
 #include "src/transform_tree.h"
 
@@ -121,8 +127,30 @@ class ChildTestTransform
 
 ALWAYS_VALID_TP(ChildTestTransform, AnalysisLength)
 RTP(ChildTestTransform, AnalysisLength)
+
+/// @brief Writes past the end of its output buffers.
+class OverrunTestTransform
+    : public TransformBase<ParentTestFormat, ChildTestFormat> {
+ public:
+  TRANSFORM_INTRO("OverrunTest", "", OverrunTestTransform)
+
+ protected:
+  virtual void InitializeBuffers(const BuffersBase<ParentChunk>&,
+                                 BuffersBase<ChildChunk>*)
+  const noexcept {
+  }
+
+  virtual void Do(const BuffersBase<ParentChunk>&,
+                  BuffersBase<ChildChunk>* out) const noexcept {
+    auto end = reinterpret_cast<char*>(&(*out)[out->Count() - 1]) +
+        out->Format()->SizeInBytes();
+    memset(end, 0xFF, sizeof(uint64_t));
+  }
+};
+
 REGISTER_TRANSFORM(ParentTestTransform);
 REGISTER_TRANSFORM(ChildTestTransform);
+REGISTER_TRANSFORM(OverrunTestTransform);
 
 class TransformTreeTest : public TransformTree, public testing::Test {
  public:
@@ -157,4 +185,327 @@ TEST_F(TransformTreeTest, Dump) {
   Dump("/tmp/ttdump.dot");
 }
 
+TEST_F(TransformTreeTest, ExecutionContext) {
+  AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  ASSERT_THROW(CreateExecutionContext(), TreeIsNotPreparedException);
+  PrepareForExecution();
+  auto context = CreateExecutionContext();
+  ASSERT_NE(nullptr, context);
+  ASSERT_EQ(this, context->tree());
+  std::vector<int16_t> in(4096);
+  auto own = Execute(in.data());
+  auto other = Execute(context.get(), in.data());
+  ASSERT_EQ(1U, other.size());
+  const Buffers& own_buffers = *own["One"];
+  const Buffers& other_buffers = *other["One"];
+  ASSERT_EQ(own_buffers.Count(), other_buffers.Count());
+  ASSERT_NE(own_buffers.Data(), other_buffers.Data());
+}
+
+TEST_F(TransformTreeTest, ExecutionContextPlans) {
+  AddFeature("Spectrum", { { "Window", "length=512, step=256" },
+                           { "RDFT", "" } });
+  PrepareForExecution();
+  size_t plans = plan_cache().Size();
+  ASSERT_GT(plans, 0U);
+  std::vector<int16_t> in(4096);
+  for (int i = 0; i < 3; i++) {
+    auto first = CreateExecutionContext();
+    auto second = CreateExecutionContext();
+    // Each context has its own plans on its own arena
+    ASSERT_EQ(plans * 3, plan_cache().Size());
+    ASSERT_EQ(1U, Execute(second.get(), in.data()).size());
+  }
+  ASSERT_EQ(plans, plan_cache().Size());
+  ASSERT_EQ(1U, Execute(in.data()).size());
+  ASSERT_EQ(plans, plan_cache().Size());
+}
+
+TEST_F(TransformTreeTest, AllocationPlan) {
+  AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  AddFeature("Two", { {"ParentTest", "AmplifyFactor=2" },
+                    { "ChildTest", "" } });
+  ASSERT_THROW(SaveAllocationPlan("/tmp/sfe_test.plan"),
+               TreeIsNotPreparedException);
+  PrepareForExecution();
+  SaveAllocationPlan("/tmp/sfe_test.plan");
+
+  TransformTree same({ 4096, 20000 });
+  same.AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  same.AddFeature("Two", { {"ParentTest", "AmplifyFactor=2" },
+                         { "ChildTest", "" } });
+  ASSERT_TRUE(same.LoadAllocationPlan("/tmp/sfe_test.plan"));
+  same.PrepareForExecution();
+  std::vector<int16_t> in(4096);
+  ASSERT_EQ(2U, same.Execute(in.data()).size());
+
+  TransformTree other({ 4096, 20000 });
+  other.AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  ASSERT_FALSE(other.LoadAllocationPlan("/tmp/sfe_nonexistent.plan"));
+  // The plan describes another tree, so it is solved anew
+  ASSERT_TRUE(other.LoadAllocationPlan("/tmp/sfe_test.plan"));
+  other.PrepareForExecution();
+  ASSERT_EQ(1U, other.Execute(in.data()).size());
+
+  // Place all the buffers at the same memory
+  std::ifstream fr("/tmp/sfe_test.plan");
+  std::ofstream fw("/tmp/sfe_overlapping.plan");
+  std::string line;
+  std::getline(fr, line);
+  fw << line << std::endl;
+  std::getline(fr, line);
+  fw << line << std::endl;
+  int parent, next, cycle;
+  size_t size, offset;
+  while (fr >> parent >> size >> offset >> next >> cycle) {
+    std::getline(fr, line);
+    fw << parent << " " << size << " 0 " << next << " " << cycle << line
+       << std::endl;
+  }
+  fw.close();
+  TransformTree overlapping({ 4096, 20000 });
+  overlapping.AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  overlapping.AddFeature("Two", { {"ParentTest", "AmplifyFactor=2" },
+                                { "ChildTest", "" } });
+  ASSERT_TRUE(overlapping.LoadAllocationPlan("/tmp/sfe_overlapping.plan"));
+  // The plan is rejected and solved anew
+  overlapping.PrepareForExecution();
+  auto results = overlapping.Execute(in.data());
+  ASSERT_EQ(2U, results.size());
+  const Buffers& one = *results["One"];
+  const Buffers& two = *results["Two"];
+  ASSERT_NE(one.Data(), two.Data());
+  overlapping.SaveAllocationPlan("/tmp/sfe_overlapping.plan");
+  std::ifstream solved("/tmp/sfe_overlapping.plan"), original(
+      "/tmp/sfe_test.plan");
+  std::stringstream solved_text, original_text;
+  solved_text << solved.rdbuf();
+  original_text << original.rdbuf();
+  ASSERT_EQ(original_text.str(), solved_text.str());
+}
+
+TEST_F(TransformTreeTest, BranchThreads) {
+  AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  AddFeature("Two", { {"ParentTest", "AmplifyFactor=2" },
+                    { "ChildTest", "" } });
+  AddFeature("Three", { {"ParentTest", "AmplifyFactor=2" },
+                      { "ChildTest", "AnalysisLength=256" } });
+  ASSERT_EQ(1, branch_threads_number());
+  set_branch_threads_number(0);
+  ASSERT_EQ(1, branch_threads_number());
+  set_branch_threads_number(4);
+  ASSERT_EQ(4, branch_threads_number());
+  PrepareForExecution();
+  std::vector<int16_t> in(4096);
+  // The second run is prioritized using the times measured by the first
+  for (int i = 0; i < 2; i++) {
+    auto results = Execute(in.data());
+    ASSERT_EQ(3U, results.size());
+    const Buffers& one = *results["One"];
+    const Buffers& two = *results["Two"];
+    ASSERT_NE(one.Data(), two.Data());
+  }
+  ASSERT_GT(ExecutionTimeReport().size(), 0U);
+}
+
+TEST_F(TransformTreeTest, SelectedFeatures) {
+  AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  AddFeature("Two", { {"ParentTest", "AmplifyFactor=2" },
+                    { "ChildTest", "AnalysisLength=256" } });
+  set_collect_statistics(true);
+  PrepareForExecution();
+  std::vector<int16_t> in(4096);
+  ASSERT_THROW(Execute(in.data(), { "Three" }), FeatureNotFoundException);
+  auto count_nodes = [this]() {
+    auto report = StatisticsReport();
+    int count = 0;
+    for (size_t pos = report.find("\"count\": "); pos != std::string::npos;
+         pos = report.find("\"count\": ", pos + 1)) {
+      count++;
+    }
+    return count;
+  };
+  auto selected = Execute(in.data(), { "One" });
+  ASSERT_EQ(1U, selected.size());
+  ASSERT_NE(selected.end(), selected.find("One"));
+  // Only ParentTest and ChildTest of "One" have been executed
+  ASSERT_EQ(2, count_nodes());
+  auto all = Execute(in.data());
+  ASSERT_EQ(2U, all.size());
+  ASSERT_EQ(4, count_nodes());
+  const Buffers& selected_one = *selected["One"];
+  const Buffers& all_one = *all["One"];
+  ASSERT_EQ(selected_one.Data(), all_one.Data());
+  set_branch_threads_number(2);
+  ASSERT_EQ(1U, Execute(in.data(), { "Two" }).size());
+}
+
+TEST_F(TransformTreeTest, GuardMode) {
+  AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  ASSERT_EQ(GuardMode::kCanary, guard_mode());
+  set_guard_sampling_period(0);
+  ASSERT_EQ(1, guard_sampling_period());
+  set_guard_sampling_period(2);
+  set_guard_mode(GuardMode::kSampled);
+  PrepareForExecution();
+  std::vector<int16_t> in(4096);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(1U, Execute(in.data()).size());
+  }
+  set_memory_protection(true);
+  ASSERT_EQ(GuardMode::kProtect, guard_mode());
+  // The leaves are writable again in the next execution
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(1U, Execute(in.data()).size());
+  }
+  set_guard_mode(GuardMode::kCanary);
+  ASSERT_FALSE(memory_protection());
+  ASSERT_EQ(1U, Execute(in.data()).size());
+
+  TransformTree off({ 4096, 20000 });
+  off.set_guard_mode(GuardMode::kOff);
+  off.AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  off.PrepareForExecution();
+  ASSERT_EQ(1U, off.Execute(in.data()).size());
+  // There is no space for the canaries
+  ASSERT_THROW(off.set_guard_mode(GuardMode::kCanary),
+               TreeAlreadyPreparedException);
+  off.set_guard_mode(GuardMode::kProtect);
+  ASSERT_EQ(1U, off.Execute(in.data()).size());
+}
+
+TEST_F(TransformTreeTest, BufferOverrun) {
+  AddFeature("One", { {"ParentTest", "" }, { "OverrunTest", "" } });
+  PrepareForExecution();
+  std::vector<int16_t> in(4096);
+  for (int i = 0; i < 2; i++) {
+    ASSERT_THROW(Execute(in.data()), BufferOverrunException);
+  }
+
+  TransformTree sampled({ 4096, 20000 });
+  sampled.set_guard_mode(GuardMode::kSampled);
+  sampled.set_guard_sampling_period(2);
+  sampled.AddFeature("One", { {"ParentTest", "" }, { "OverrunTest", "" } });
+  sampled.PrepareForExecution();
+  ASSERT_THROW(sampled.Execute(in.data()), BufferOverrunException);
+  // Only every other execution is checked
+  ASSERT_EQ(1U, sampled.Execute(in.data()).size());
+  ASSERT_THROW(sampled.Execute(in.data()), BufferOverrunException);
+}
+
+TEST_F(TransformTreeTest, Statistics) {
+  AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  ASSERT_FALSE(collect_statistics());
+  PrepareForExecution();
+  std::vector<int16_t> in(4096);
+  Execute(in.data());
+  ASSERT_EQ("{\"nodes\": []}", StatisticsReport());
+  set_collect_statistics(true);
+  for (int i = 0; i < 3; i++) {
+    Execute(in.data());
+  }
+  auto report = StatisticsReport();
+  ASSERT_NE(std::string::npos, report.find("\"name\": \"ChildTest\""));
+  ASSERT_NE(std::string::npos, report.find("\"count\": 3"));
+  ASSERT_NE(std::string::npos, report.find("\"p99_ns\": "));
+  auto trace = ChromeTrace();
+  ASSERT_NE(std::string::npos, trace.find("\"ph\": \"X\""));
+  ASSERT_NE(std::string::npos, trace.find("\"name\": \"ParentTest\""));
+  ResetStatistics();
+  ASSERT_EQ("{\"nodes\": []}", StatisticsReport());
+}
+
+TEST_F(TransformTreeTest, StatisticsWhileExecuting) {
+  AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  AddFeature("Two", { {"ParentTest", "AmplifyFactor=2" },
+                    { "ChildTest", "" } });
+  set_collect_statistics(true);
+  set_branch_threads_number(2);
+  PrepareForExecution();
+  auto context = CreateExecutionContext();
+  std::atomic_bool finished(false);
+  // The reports are made while the nodes record their times
+  std::thread reporter([&]() {
+    while (!finished) {
+      StatisticsReport(*context);
+      ChromeTrace(*context);
+    }
+  });
+  std::vector<int16_t> in(4096);
+  for (int i = 0; i < 100; i++) {
+    Execute(context.get(), in.data());
+  }
+  finished = true;
+  reporter.join();
+  ASSERT_NE(std::string::npos,
+            StatisticsReport(*context).find("\"count\": 100"));
+}
+
+TEST_F(TransformTreeTest, PerfCounters) {
+  AddFeature("One", { {"ParentTest", "" }, { "ChildTest", "" } });
+  ASSERT_FALSE(perf_counters());
+  set_perf_counters(true);
+  PrepareForExecution();
+  std::vector<int16_t> in(4096);
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(1U, Execute(in.data()).size());
+  }
+  // The counters are unavailable without the permissions
+  auto report = PerfReport();
+  ASSERT_EQ(PerfCounters::ThisThread().available(), !report.empty());
+  Dump("/tmp/sfe_perf_counters.dot");
+}
+
+TEST(PerfCountersTest, OpenMPWorkers) {
+  const int kThreads = 4;
+  PerfCounters::OpenWorkers(kThreads);
+  if (!PerfCounters::ThisThread().available()) {
+    return;
+  }
+  PerfSample all_start, all_finish, own_start, own_finish;
+  ASSERT_TRUE(PerfCounters::ReadAll(&all_start));
+  ASSERT_TRUE(PerfCounters::ThisThread().Read(&own_start));
+  volatile float sink = 0;
+#ifdef HAVE_OPENMP
+  #pragma omp parallel num_threads(kThreads)
+#endif
+  {
+    float sum = 0;
+    for (int i = 0; i < 10000000; i++) {
+      sum += i * 0.5f;
+    }
+    sink = sum;
+  }
+  ASSERT_TRUE(PerfCounters::ReadAll(&all_finish));
+  ASSERT_TRUE(PerfCounters::ThisThread().Read(&own_finish));
+  auto all = all_finish - all_start;
+  auto own = own_finish - own_start;
+  ASSERT_GE(all.Instructions, own.Instructions);
+#ifdef HAVE_OPENMP
+  // The workers did three quarters of the work
+  ASSERT_GT(all.Instructions, own.Instructions * 2);
+#endif
+  static_cast<void>(sink);
+}
+
+TEST(PerfCountersTest, ExclusiveEpoch) {
+  ASSERT_EQ(0U, PerfCounters::ExclusiveEpoch());
+  {
+    PerfCounters::Execution first(true);
+    auto epoch = PerfCounters::ExclusiveEpoch();
+    ASSERT_NE(0U, epoch);
+    {
+      PerfCounters::Execution ignored(false);
+      ASSERT_EQ(epoch, PerfCounters::ExclusiveEpoch());
+    }
+    {
+      // The process wide sums are no longer attributed to the first one
+      PerfCounters::Execution second(true);
+      ASSERT_EQ(0U, PerfCounters::ExclusiveEpoch());
+    }
+    ASSERT_NE(epoch, PerfCounters::ExclusiveEpoch());
+  }
+  ASSERT_EQ(0U, PerfCounters::ExclusiveEpoch());
+}
+
 #include "tests/google/src/gtest_main.cc"
@@ -59,3 +59,28 @@ TEST_F(BeatTest, CombConvolve) {
     ASSERT_NEAR(out[i], data_conv_result[i], 0.0001f) << "i = " << i;
   }
 }
+
+TEST_F(BeatTest, CombEnergy) {
+  const int size = 500;
+  float data[size], autocorrelation[size];
+  for (int i = 0; i < size; i++) {
+    data[i] = sinf(i * 0.1f) + (i % 7) * 0.1f;
+  }
+  for (int lag = 0; lag < size; lag++) {
+    autocorrelation[lag] = 0;
+    for (int i = 0; i + lag < size; i++) {
+      autocorrelation[lag] += data[i] * data[i + lag];
+    }
+  }
+  float out[size + 3 * 150];
+  for (int period : { 1, 37, 100, 150 }) {
+    int length = size + 3 * period;
+    CombConvolve(data, size, 4, period, out);
+    float energy = 0;
+    for (int i = 0; i < length; i++) {
+      energy += out[i] * out[i];
+    }
+    ASSERT_NEAR(energy, CombEnergy(autocorrelation, size, 4, period),
+                energy / 10000) << "period = " << period;
+  }
+}
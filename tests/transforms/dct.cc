@@ -28,13 +28,16 @@
  *  under the License.
  */
 
+#include "src/transform_tree.h"
 #include "src/transforms/dct.h"
+#include "tests/speech_sample.inc"
 #include "tests/transforms/transform_test.h"
 
 using sound_feature_extraction::formats::ArrayFormatF;
 using sound_feature_extraction::BuffersBase;
 using sound_feature_extraction::transforms::DCT;
 using sound_feature_extraction::transforms::DCTInverse;
+using sound_feature_extraction::TransformTree;
 
 class DCTTest : public TransformTest<DCT> {
  public:
@@ -71,3 +74,42 @@ TEST_F(DCTInverseTest, Do) {
   ASSERT_EQ(input_format_->Size(), output_format_->Size());
   Do((*Input), &(*Output));
 }
+
+TEST_F(DCTTest, SharedPlanCache) {
+  auto cache = std::make_shared<sound_feature_extraction::FFTFPlanCache>();
+  set_plan_cache(cache);
+  PreparePlans(*Input, Output.get());
+  ASSERT_EQ(1U, cache->Size());
+  Do((*Input), &(*Output));
+  ASSERT_EQ(1U, cache->Size());
+}
+
+TEST(DCT, Siblings) {
+  TransformTree tt( { 48000, 16000 } );  // NOLINT(*)
+  tt.set_validate_after_each_transform(true);
+  // The sliced cycles would execute the plans on the slices
+  tt.set_cache_optimization(false);
+  tt.AddFeature("DCT1", { { "Window", "length=512" }, { "RDFT", "" },
+      { "SpectralEnergy", "" }, { "FilterBank", "" }, { "Log", "" },
+      { "DCT", "" }
+  });
+  tt.AddFeature("DCT2", { { "Window", "length=512" }, { "RDFT", "" },
+      { "SpectralEnergy", "" }, { "FilterBank", "number=64" }, { "Log", "" },
+      { "DCT", "" }, { "IDCT", "" }
+  });
+  std::unique_ptr<int16_t[]> buffers(new int16_t[48000]);
+  memcpy(buffers.get(), data, sizeof(data));
+  tt.PrepareForExecution();
+  auto res1 = tt.Execute(buffers.get());
+  ASSERT_EQ(2U, res1.size());
+  res1["DCT1"]->Validate();
+  res1["DCT2"]->Validate();
+  size_t size = res1["DCT1"]->SizeInBytes();
+  std::unique_ptr<char[]> first(new char[size]);
+  memcpy(first.get(), (*res1["DCT1"])[0], size);
+  auto res2 = tt.Execute(buffers.get());
+  ASSERT_EQ(0, memcmp(first.get(), (*res2["DCT1"])[0], size));
+  // The shared RDFT, DCT of 32 and 64 bands and IDCT of 64 bands; the DCT
+  // nodes use the cache of the tree and reuse their plans
+  ASSERT_EQ(4U, tt.plan_cache().Size());
+}
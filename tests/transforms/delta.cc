@@ -31,11 +31,14 @@
 
 #include "src/transforms/delta.h"
 #include "tests/transforms/transform_test.h"
+#include <vector>
 #include <fftf/api.h>
 
 using sound_feature_extraction::formats::ArrayFormatF;
 using sound_feature_extraction::BuffersBase;
 using sound_feature_extraction::transforms::Delta;
+using sound_feature_extraction::transforms::DeltaType;
+using sound_feature_extraction::StreamPiece;
 
 class DeltaTest : public TransformTest<Delta> {
  public:
@@ -58,17 +61,105 @@ TEST_F(DeltaTest, Do) {
     ASSERT_NEAR((*Output)[0][i], 1, 0.00001f) << i;
   }
 }
-/*
+TEST_F(DeltaTest, DoRegressionLinear) {
+  set_type(sound_feature_extraction::transforms::DeltaType::kRegression);
+  SetUpTransform(100, Size, 18000);
+  for (int k = 0; k < 100; k++) {
+    for (int i = 0; i < Size; i++) {
+      (*Input)[k][i] = i + 0.5f * k;
+    }
+  }
+  Do((*Input), &(*Output));
+  for (int k = 0; k < 100; k++) {
+    for (int i = 0; i < Size; i++) {
+      ASSERT_NEAR((*Output)[k][i], 0.5f, 0.0001f) << k << " " << i;
+    }
+  }
+}
+
 TEST_F(DeltaTest, DoRegression) {
-  set_type(sound_feature_extraction::transforms::kDeltaTypeRegression);
+  set_type(sound_feature_extraction::transforms::DeltaType::kRegression);
+  set_rlength(7);
+  SetUpTransform(100, Size, 18000);
+  for (int k = 0; k < 100; k++) {
+    for (int i = 0; i < Size; i++) {
+      (*Input)[k][i] = (k * 37 + i * 11) % 101 / 10.f;
+    }
+  }
   set_use_simd(false);
   Do((*Input), &(*Output));
   set_use_simd(true);
   auto output_simd = std::static_pointer_cast<Delta::OutBuffers>(
       CreateOutputBuffers(Output->Count()));
   Do((*Input), &(*output_simd));
-  for (int i = 0; i < Size; i++) {
-    ASSERT_NEAR((*Output)[0][i], (*output_simd)[0][i], 0.00001f) << i;
+  for (int k = 1; k < 99; k++) {
+    int rstep = std::min(3, std::min(k, 99 - k));
+    float norm = rstep * (rstep + 1) * (2 * rstep + 1) / 3.f;
+    for (int i = 0; i < Size; i++) {
+      float sum = 0;
+      for (int j = 1; j <= rstep; j++) {
+        sum += j * ((*Input)[k + j][i] - (*Input)[k - j][i]);
+      }
+      ASSERT_NEAR(sum / norm, (*Output)[k][i], 0.0001f) << k << " " << i;
+      ASSERT_NEAR((*Output)[k][i], (*output_simd)[k][i], 0.00001f)
+          << k << " " << i;
+    }
+  }
+}
+
+TEST_F(DeltaTest, DoRegressionUnalignedSize) {
+  set_type(sound_feature_extraction::transforms::DeltaType::kRegression);
+  set_use_simd(true);
+  SetUpTransform(50, 13, 18000);
+  for (int k = 0; k < 50; k++) {
+    for (int i = 0; i < 13; i++) {
+      (*Input)[k][i] = i - 0.25f * k;
+    }
+  }
+  Do((*Input), &(*Output));
+  for (int k = 0; k < 50; k++) {
+    for (int i = 0; i < 13; i++) {
+      ASSERT_NEAR((*Output)[k][i], -0.25f, 0.0001f) << k << " " << i;
+    }
+  }
+}
+
+TEST_F(DeltaTest, Stream) {
+  const int kCount = 100;
+  const int kPiece = 7;
+  for (auto type : { DeltaType::kSimple, DeltaType::kRegression }) {
+    set_type(type);
+    set_rlength(7);
+    set_streaming(false);
+    SetUpTransform(kCount, Size, 18000);
+    for (int k = 0; k < kCount; k++) {
+      for (int i = 0; i < Size; i++) {
+        (*Input)[k][i] = (k * 37 + i * 11) % 101 / 10.f;
+      }
+    }
+    Do((*Input), &(*Output));
+    std::vector<float> reference((*Output)[0], (*Output)[0] + kCount * Size);
+    std::vector<float> signal((*Input)[0], (*Input)[0] + kCount * Size);
+
+    set_streaming(true);
+    SetUpTransform(kPiece, Size, 18000);
+    std::vector<float> streamed;
+    for (int fed = 0; streamed.size() < reference.size(); fed += kPiece) {
+      ASSERT_LT(fed, kCount + 2 * kPiece);
+      int valid = std::max(0, std::min(kPiece, kCount - fed));
+      for (int k = 0; k < valid; k++) {
+        std::copy(&signal[(fed + k) * Size], &signal[(fed + k + 1) * Size],
+                  (*Input)[k]);
+      }
+      auto piece = PrepareStreamPiece({0, static_cast<size_t>(valid),
+                                       fed + kPiece >= kCount});
+      Do((*Input), &(*Output));
+      ASSERT_EQ(0U, piece.Skip);
+      for (size_t k = 0; k < piece.Valid; k++) {
+        streamed.insert(streamed.end(), (*Output)[k], (*Output)[k] + Size);
+      }
+    }
+    ASSERT_FALSE(StreamPending());
+    ASSERT_EQ(reference, streamed);
   }
 }
-*/
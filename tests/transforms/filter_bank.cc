@@ -132,6 +132,23 @@ TEST_F(FilterBankTest, Do) {
   }
 }
 
+TEST_F(FilterBankTest, Batch) {
+  SetUpTransform(100, Size, 16000);
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < Size; j++) {
+      (*Input)[i][j] = (i * 7 + j * 13) % 101;
+    }
+  }
+  Do(*Input, Output.get());
+  std::vector<float> frame(number());
+  for (int i = 0; i < 100; i++) {
+    Do((*Input)[i], frame.data());
+    for (int j = 0; j < number(); j++) {
+      ASSERT_NEAR(frame[j], (*Output)[i][j], frame[j] / 100000) << i;
+    }
+  }
+}
+
 
 class ScaleTest : public ::testing::TestWithParam<std::tuple<ScaleType, float>>,
                   public FilterBank {
@@ -66,6 +66,33 @@ TEST_F(FrequencyBandsTest, DoWithBands) {
   Do((*Input), &(*Output));
 }
 
+TEST_F(FrequencyBandsTest, Stateful) {
+  // Filter the whole signal of each band at once
+  SetUpTransform(Buffers, Size * 2, 16000);
+  for (int i = 0; i < Size * 2; i++) {
+    for (int j = 0; j < Buffers; j++) {
+      (*Input)[j][i] = sinf(i / 10.f);
+    }
+  }
+  Do((*Input), &(*Output));
+  auto whole = Output;
+  // Each band gets two consecutive pieces of the same signal
+  set_stateful(true);
+  SetUpTransform(Buffers * 2, Size, 16000);
+  for (int i = 0; i < Size * 2; i++) {
+    for (int j = 0; j < Buffers; j++) {
+      (*Input)[(i / Size) * Buffers + j][i % Size] = sinf(i / 10.f);
+    }
+  }
+  Do((*Input), &(*Output));
+  for (int i = 0; i < Size * 2; i++) {
+    for (int j = 0; j < Buffers; j++) {
+      ASSERT_NEAR((*whole)[j][i],
+                  (*Output)[(i / Size) * Buffers + j][i % Size], 0.0001f);
+    }
+  }
+}
+
 TEST_F(FrequencyBandsTest, TooBigBands) {
   set_bands("2000 3000 18000");
   Initialize();
@@ -29,6 +29,7 @@
  */
 
 #include <fstream>
+#include <vector>
 #include "src/transforms/lowpass_filter.h"
 #include "tests/transforms/transform_test.h"
 #include "src/primitives/window.h"
@@ -65,3 +66,20 @@ TEST_F(LowpassFilterTest, CalculateLowpassFilter) {
   fs << "]\n";
   */
 }
+
+TEST_F(LowpassFilterTest, Stateful) {
+  Do((*Input)[0], (*Output)[0]);
+  std::vector<float> whole((*Output)[0], (*Output)[0] + 10 * Size);
+  // Cut the same signal into 10 consecutive buffers
+  set_stateful(true);
+  SetUpTransform(10, Size, 5000);
+  for (int i = 0; i < 10; i++) {
+    memcpy((*Input)[i], data_signal, sizeof(data_signal));
+  }
+  Do(*Input, Output.get());
+  for (int i = 0; i < 10; i++) {
+    for (size_t j = 0; j < Size; j++) {
+      ASSERT_EQF(whole[i * Size + j], (*Output)[i][j]);
+    }
+  }
+}
@@ -70,6 +70,19 @@ TEST_F(RDFTTest, Do) {
   Do((*Input), &(*Output));
 }
 
+TEST_F(RDFTTest, ReusePlan) {
+  Do((*Input), &(*Output));
+  ASSERT_EQ(1U, plan_cache()->Size());
+  std::unique_ptr<float[]> first(new float[Size + 2]);
+  memcpy(first.get(), (*Output)[0], (Size + 2) * sizeof(float));
+  Do((*Input), &(*Output));
+  // The plan created by the first call is executed again
+  ASSERT_EQ(1U, plan_cache()->Size());
+  for (int i = 0; i < Size + 2; i++) {
+    ASSERT_EQ(first[i], (*Output)[0][i]);
+  }
+}
+
 TEST_F(RDFTInverseTest, Do) {
   Do((*Input), &(*Output));
 }
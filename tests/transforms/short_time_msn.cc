@@ -31,11 +31,13 @@
 
 #include "src/transforms/short_time_msn.h"
 #include "tests/transforms/transform_test.h"
+#include <vector>
 #include <fftf/api.h>
 
 using sound_feature_extraction::formats::ArrayFormatF;
 using sound_feature_extraction::BuffersBase;
 using sound_feature_extraction::transforms::ShortTimeMeanScaleNormalization;
+using sound_feature_extraction::StreamPiece;
 
 class ShortTimeMeanScaleNormalizationTest
     : public TransformTest<ShortTimeMeanScaleNormalization> {
@@ -72,3 +74,63 @@ TEST_F(ShortTimeMeanScaleNormalizationTest, Do) {
   ASSERT_NEAR((*Output)[9][1], 0.5, 0.00001f);
   ASSERT_NEAR((*Output)[9][2], 0.5, 0.00001f);
 }
+
+TEST_F(ShortTimeMeanScaleNormalizationTest, Reference) {
+  set_length(25);
+  SetUpTransform(100, Size, 18000);
+  for (int k = 0; k < 100; k++) {
+    for (int i = 0; i < Size; i++) {
+      (*Input)[k][i] = (k * 37 + i * 11) % 101 / 10.f;
+    }
+  }
+  Do((*Input), &(*Output));
+  for (int k = 0; k < 100; k++) {
+    int begin = std::max(0, k - 12), end = std::min(100, k + 13);
+    for (int i = 0; i < Size; i++) {
+      float sum = 0, min = (*Input)[k][i], max = min;
+      for (int j = begin; j < end; j++) {
+        sum += (*Input)[j][i];
+        min = std::min(min, (*Input)[j][i]);
+        max = std::max(max, (*Input)[j][i]);
+      }
+      float expected = max > min?
+          ((*Input)[k][i] - sum / (end - begin)) / (max - min) : 0;
+      ASSERT_NEAR(expected, (*Output)[k][i], 0.00001f) << k << " " << i;
+    }
+  }
+}
+
+TEST_F(ShortTimeMeanScaleNormalizationTest, Stream) {
+  const int kCount = 200;
+  const int kPiece = 9;
+  set_length(25);
+  SetUpTransform(kCount, Size, 18000);
+  for (int k = 0; k < kCount; k++) {
+    for (int i = 0; i < Size; i++) {
+      (*Input)[k][i] = (k * 37 + i * 11) % 101 / 10.f;
+    }
+  }
+  Do((*Input), &(*Output));
+  std::vector<float> reference((*Output)[0], (*Output)[0] + kCount * Size);
+  std::vector<float> signal((*Input)[0], (*Input)[0] + kCount * Size);
+
+  set_streaming(true);
+  SetUpTransform(kPiece, Size, 18000);
+  std::vector<float> streamed;
+  for (int fed = 0; streamed.size() < reference.size(); fed += kPiece) {
+    ASSERT_LT(fed, kCount + 5 * kPiece);
+    int valid = std::max(0, std::min(kPiece, kCount - fed));
+    for (int k = 0; k < valid; k++) {
+      std::copy(&signal[(fed + k) * Size], &signal[(fed + k + 1) * Size],
+                (*Input)[k]);
+    }
+    auto piece = PrepareStreamPiece({0, static_cast<size_t>(valid),
+                                     fed + kPiece >= kCount});
+    Do((*Input), &(*Output));
+    for (size_t k = 0; k < piece.Valid; k++) {
+      streamed.insert(streamed.end(), (*Output)[k], (*Output)[k] + Size);
+    }
+  }
+  ASSERT_FALSE(StreamPending());
+  ASSERT_EQ(reference, streamed);
+}
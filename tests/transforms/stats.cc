@@ -102,6 +102,92 @@ TEST_F(StatsTest, DoIntervalOverlap) {
   }
 }
 
+TEST_F(StatsTest, DoIntervalSliding) {
+  set_interval(1000);
+  set_overlap(900);
+  RecreateOutputBuffers();
+  Do((*Input)[0], (*Output)[0]);
+  size_t count = output_format_->Size() / 4;
+  for (size_t w = 0; w < count; w++) {
+    size_t start = std::min(w * 100, input_format_->Size() - 1000);
+    double mean = 0;
+    for (size_t i = start; i < start + 1000; i++) {
+      mean += (*Input)[0][i];
+    }
+    mean /= 1000;
+    double u2 = 0, u3 = 0, u4 = 0;
+    for (size_t i = start; i < start + 1000; i++) {
+      double v = (*Input)[0][i] - mean;
+      u2 += v * v;
+      u3 += v * v * v;
+      u4 += v * v * v * v;
+    }
+    u2 /= 1000;
+    u3 /= 1000;
+    u4 /= 1000;
+    ASSERT_NEAR(mean, (*Output)[0][w * 4], 0.0001) << w;
+    ASSERT_NEAR(sqrt(u2), (*Output)[0][w * 4 + 1], 0.0001) << w;
+    ASSERT_NEAR(u3 / (u2 * sqrt(u2)), (*Output)[0][w * 4 + 2], 0.0001) << w;
+    ASSERT_NEAR(u4 / (u2 * u2) - 3, (*Output)[0][w * 4 + 3], 0.0001) << w;
+  }
+}
+
+TEST_F(StatsTest, DoSplitBuffer) {
+  std::vector<float> single(4);
+  Do((*Input)[0], single.data());
+  set_threads_number(4);
+  Do(*Input, Output.get());
+  for (int i = 0; i < 4; i++) {
+    ASSERT_NEAR(single[i], (*Output)[0][i], 0.0001) << i;
+  }
+  set_interval(1000);
+  set_overlap(500);
+  RecreateOutputBuffers();
+  single.resize(output_format_->Size());
+  Do((*Input)[0], single.data());
+  Do(*Input, Output.get());
+  for (size_t i = 0; i < single.size(); i++) {
+    ASSERT_NEAR(single[i], (*Output)[0][i], 0.0001) << i;
+  }
+}
+
+TEST_F(StatsTest, DoIntervalDrift) {
+  // The large DC ramp moves the intervals far away from the first one
+  std::mt19937 gen(1);
+  std::normal_distribution<float> d(0, 2);
+  size_t size = input_format_->Size();
+  for (size_t i = 0; i < size; i++) {
+    (*Input)[0][i] = 1e6f * i / size + d(gen);
+  }
+  set_interval(1000);
+  set_overlap(900);
+  RecreateOutputBuffers();
+  Do((*Input)[0], (*Output)[0]);
+  size_t count = output_format_->Size() / 4;
+  for (size_t w = 0; w < count; w++) {
+    size_t start = std::min(w * 100, size - 1000);
+    double mean = 0;
+    for (size_t i = start; i < start + 1000; i++) {
+      mean += (*Input)[0][i];
+    }
+    mean /= 1000;
+    double u2 = 0, u3 = 0, u4 = 0;
+    for (size_t i = start; i < start + 1000; i++) {
+      double v = (*Input)[0][i] - mean;
+      u2 += v * v;
+      u3 += v * v * v;
+      u4 += v * v * v * v;
+    }
+    u2 /= 1000;
+    u3 /= 1000;
+    u4 /= 1000;
+    ASSERT_NEAR(mean, (*Output)[0][w * 4], mean * 1e-6) << w;
+    ASSERT_NEAR(sqrt(u2), (*Output)[0][w * 4 + 1], sqrt(u2) * 1e-4) << w;
+    ASSERT_NEAR(u3 / (u2 * sqrt(u2)), (*Output)[0][w * 4 + 2], 0.001) << w;
+    ASSERT_NEAR(u4 / (u2 * u2) - 3, (*Output)[0][w * 4 + 3], 0.001) << w;
+  }
+}
+
 const float nan_data[] = {
   4204.085449, 4375.681152, 4161.187012, 4075.389160, 4075.389160, 4161.187012,
   4161.187012, 4075.389160, 4075.389160, 4161.187012,